@@ -0,0 +1,77 @@
+#ifndef APPREGISTRY_HPP
+#define APPREGISTRY_HPP
+
+#include <string>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <stdint.h>
+#include <sys/types.h>
+
+// AppRegistry remembers which applications the server has opened.
+//
+// Every app ("facebook", "youtube", ...) has one entry with its status, the
+// pid of the launched process, its profile directory and when it started.
+// Entries are updated by the open / close commands and by the launcher's
+// child-exit notification, so "status" and repeated "open" commands are
+// answered from memory without scanning /proc.
+//
+// The app name is also the ProcessLauncher session name.
+// All methods may be called from any reactor thread.
+class AppRegistry {
+public:
+    enum Status {
+        APP_STOPPED,    // not running (never opened, closed or exited)
+        APP_STARTING,   // an open command is launching it right now
+        APP_RUNNING,
+        APP_CLOSING     // SIGTERM sent, waiting for the process to exit
+    };
+
+    struct AppState {
+        std::string name;
+        std::string title;          // "YouTube"
+        std::string profileDir;     // browser --user-data-dir
+        Status status = APP_STOPPED;
+        pid_t pid = -1;             // launched process (0 = dry run / not a process we track)
+        int64_t startedMs = 0;      // monotonic clock
+        int exitStatus = -1;        // wait status of the last exit, -1 = none
+    };
+
+    // Declares an app so "status" lists it before it is ever opened
+    // (updates title and profile of a known one)
+    void add(const std::string& name, const std::string& title, const std::string& profileDir);
+
+    // Forgets stopped apps that are not in "names" (removed by a config reload)
+    void retainOnly(const std::set<std::string>& names);
+
+    // Reserves "name" for launching (status becomes APP_STARTING). Returns
+    // false if it is already starting / running; "current" receives the entry.
+    bool beginOpen(const std::string& name, AppState& current);
+
+    // Result of the launch started by beginOpen(): pid < 0 means it failed
+    void opened(const std::string& name, pid_t pid);
+
+    // A close command ran; "signalled" = processes were sent SIGTERM and their
+    // exit is still to come, otherwise the app counts as stopped right away
+    void closing(const std::string& name, bool signalled);
+
+    // Child-exit notification from the ProcessLauncher
+    void exited(pid_t pid, const std::string& session, int status);
+
+    // Copy of one entry (false if unknown) / of all entries
+    bool get(const std::string& name, AppState& state) const;
+    std::vector<AppState> snapshot() const;
+
+    // "facebook: running (pid 1234, up 1m 05s, profile /tmp/fb_session)"
+    static std::string describe(const AppState& state);
+
+    static int64_t nowMs();
+
+private:
+    mutable std::mutex lock;
+    std::vector<AppState> apps;     // a handful of entries: a linear search is fastest
+
+    AppState* find(const std::string& name);
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef BENCHCLIENT_HPP
+#define BENCHCLIENT_HPP
+
+#include <string>
+#include <string_view>
+#include <stdint.h>
+#include <sys/epoll.h>
+
+// BenchClient holds what the measuring tools (tcp_bench, tcp_replay) share:
+// the clock, the connection to the server, the non-blocking send of a
+// connection's outbox, the sub-millisecond wait, and how a text reply line
+// answers a command.
+class BenchClient {
+public:
+    // What a text reply line means for the oldest command in flight
+    enum Answer { ANSWER_NONE, ANSWER_ACK, ANSWER_BUSY };
+
+    // Monotonic timestamp in nanoseconds
+    static uint64_t nowNs();
+
+    // Reads the server port from a tcp_server --config file (as tcp_client
+    // does); false, with the error printed, if the file cannot be used
+    static bool portFromConfig(const std::string& path, int& port);
+
+    // Connects to "host":"port" with TCP_NODELAY. The socket is blocking
+    // until setNonBlocking(). Returns -1 (errno set) on failure.
+    static int connectTo(const std::string& host, int port);
+    static void setNonBlocking(int fd);
+
+    // Sends as much of "outbox" as the socket takes and erases it; false if
+    // the connection failed (errno set)
+    static bool flush(int fd, std::string& outbox);
+
+    // epoll_wait() with a timeout of "nanos"
+    static int waitEvents(int epfd, struct epoll_event* events, int maxEvents, uint64_t nanos);
+
+    // Classifies one reply line: "Command received." or "Busy: ..." answer
+    // a command, anything else (status text, "Binary protocol enabled.") does not
+    static Answer answerOf(std::string_view line);
+};
+
+#endif
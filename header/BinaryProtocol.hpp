@@ -0,0 +1,97 @@
+#ifndef BINARYPROTOCOL_HPP
+#define BINARYPROTOCOL_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+// BinaryProtocol is the compact wire format a connection can switch to by
+// sending the text command "binary" (answered with "Binary protocol enabled.\n";
+// the bytes after that line are already binary, so a client need not wait).
+//
+// From then on every frame, in both directions, is
+//
+//   varint length | payload                  (FrameParser::VARINT_PREFIXED)
+//
+// where a varint is an unsigned LEB128 number (7 bits per byte, low bits first).
+//
+//   request  payload: varint opcode | varint request id | varint argc | argc x argument
+//                     (at most MAX_ARGS arguments)
+//   argument        : type byte | value
+//                       ARG_UINT   varint
+//                       ARG_SINT   zigzag varint (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...)
+//                       ARG_BYTES  varint length | bytes
+//   response payload: varint request id | status byte | reply text (rest of the frame)
+//
+// A long reply (a screenshot) comes as several frames with the same id: the
+// ones with STATUS_MORE carry the first parts of the reply text, the last one
+// has the final status and the rest. The client concatenates them.
+//
+// Opcode OP_LIST returns the command table as "opcode name\n" lines. Every
+// other opcode is a command's position in the registry
+// (CommandRegistry::Command::opcode). The fixed commands are registered before
+// the configured apps, so their opcodes do not change when the configuration
+// does.
+//
+// Every request gets exactly one final response, with the request's id. Worker
+// commands answer when they finish, so responses can arrive out of order.
+class BinaryProtocol {
+public:
+    enum Opcode { OP_LIST = 0 };
+
+    enum ArgType { ARG_UINT = 0, ARG_SINT = 1, ARG_BYTES = 2 };
+
+    enum Status {
+        STATUS_OK = 0,
+        STATUS_UNKNOWN = 1,       // no command has this opcode
+        STATUS_BUSY = 2,          // worker limit reached or queue full, try again later
+        STATUS_BAD_REQUEST = 3,   // malformed payload
+        STATUS_MORE = 4           // part of a long reply, more frames with this id follow
+    };
+
+    // A decoded request. Arguments are handed to the handlers as text, like
+    // the arguments of a text command: "args" are views into "argText", which
+    // holds them separated by single spaces (numbers in decimal).
+    struct Request {
+        uint64_t opcode = 0;
+        uint64_t id = 0;
+        std::string argText;
+        std::vector<std::string_view> args;
+    };
+
+    // Longest varint we accept (64-bit values)
+    static const size_t MAX_VARINT = 10;
+
+    // Most arguments one request may carry
+    static const size_t MAX_ARGS = 16;
+
+    // Appends "value" as a varint
+    static void putVarint(std::string& out, uint64_t value);
+
+    // Reads a varint from the front of "in" and removes it.
+    // Returns false if "in" ends first or the varint is too long or does not
+    // fit in 64 bits.
+    static bool getVarint(std::string_view& in, uint64_t& value);
+
+    // Splits the first frame off "in" (client side; the server uses FrameParser).
+    // Returns false until the whole frame arrived; "used" is its size with the header.
+    static bool nextFrame(std::string_view in, std::string_view& payload, size_t& used);
+
+    // Parses a request payload. On false the request is malformed; request.id
+    // is still set if it could be read (0 otherwise).
+    static bool decodeRequest(std::string_view payload, Request& request);
+
+    // Appends a whole request frame with text arguments (numbers are sent as ARG_UINT)
+    static void appendRequest(std::string& out, uint64_t opcode, uint64_t id,
+                              const std::vector<std::string>& args);
+
+    // Appends a whole response frame
+    static void appendResponse(std::string& out, uint64_t id, Status status, std::string_view text);
+
+    // Parses a response payload
+    static bool decodeResponse(std::string_view payload, uint64_t& id, Status& status, std::string_view& text);
+};
+
+#endif
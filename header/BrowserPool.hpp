@@ -0,0 +1,79 @@
+#ifndef BROWSERPOOL_HPP
+#define BROWSERPOOL_HPP
+
+#include <string>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <stdint.h>
+#include <sys/types.h>
+#include "ProcessLauncher.hpp"
+
+// BrowserPool opens the browser app windows ("open facebook", ...).
+//
+// Cold mode (default): every open starts the browser with the app's profile
+// directory, which takes seconds.
+//
+// Warm mode: at startup every profile gets a browser instance without a window
+// (--no-startup-window). An open then runs the browser once more with the same
+// profile; that second process only hands the URL over to the running instance
+// through Chrome's profile lock and exits, so the window appears as soon as the
+// already-loaded browser can draw it. When a warm instance exits (closed by the
+// user or by "close <app>") a new spare one is started for the next open.
+//
+// The executable is configurable, so tests can use any stand-in program.
+// All methods may be called from any reactor thread.
+class BrowserPool {
+public:
+    // One browser app: window contents and the profile it runs in
+    struct Profile {
+        std::string session;     // ProcessLauncher session, same as the app name
+        std::string profileDir;  // --user-data-dir
+        std::string url;         // --app=
+        std::vector<std::string> flags;  // --kiosk or --start-fullscreen, ...
+        std::string title;
+    };
+
+    BrowserPool(ProcessLauncher& launcher);
+
+    // Browser executable (searched in PATH), default "google-chrome"
+    void setExecutable(const std::string& path);
+
+    void setWarm(bool enabled) { warm = enabled; }
+    bool isWarm() const { return warm; }
+
+    // Replaces the known apps (configuration load / reload). Warm instances of
+    // apps that were removed keep running until they exit.
+    void setProfiles(const std::vector<Profile>& list);
+
+    // Warm mode: starts the hidden instance of every profile that has none
+    void warmAll();
+
+    // Opens the app window of "session". Returns the pid of the browser that
+    // shows it (the warm instance if there is one), 0 in dry run, -1 on failure.
+    pid_t open(const std::string& session);
+
+    // Child-exit notification from the ProcessLauncher
+    void onExit(pid_t pid, const std::string& session, int status);
+
+private:
+    struct WarmInstance {
+        pid_t pid;
+        int64_t startedMs;
+    };
+
+    ProcessLauncher& launcher;
+    std::string browser;
+    bool warm;
+
+    std::mutex lock;                                // guards browser, profiles and instances
+    std::map<std::string, Profile> profiles;
+    std::map<std::string, WarmInstance> instances;  // session -> running warm instance
+
+    // A warm instance that exits sooner than this is not replaced (crash loop guard)
+    static const int64_t MIN_WARM_LIFETIME_MS = 2000;
+
+    void warmUp(const Profile& profile);
+};
+
+#endif
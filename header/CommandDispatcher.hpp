@@ -0,0 +1,193 @@
+#ifndef COMMANDDISPATCHER_HPP
+#define COMMANDDISPATCHER_HPP
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "TCPServer.hpp"
+#include "BinaryProtocol.hpp"
+#include "InputChannel.hpp"
+#include "CommandRegistry.hpp"
+#include "ConfigStore.hpp"
+#include "ThreadPool.hpp"
+
+// CommandDispatcher turns received frames into handler calls.
+//
+// Quick commands run directly on the event loop thread. Commands registered
+// with CommandOptions::worker run on the ThreadPool; their reply is posted back
+// to the event loop and sent from there, so the loop keeps reading other
+// clients while a slow handler runs.
+//
+// When a worker command is already running maxConcurrent times, or the pool
+// queue is full, the client gets a "Busy: ..." reply right away instead of
+// waiting in an unbounded queue.
+//
+// Before anything else a command passes admission control, by its priority
+// class (CommandOptions::priority): interactive commands always go through;
+// normal and heavy ones take a token from the client's bucket for their
+// class, and commands with their own rate limit one from a bucket shared by
+// all clients. Heavy worker commands may only fill half of the pool queue,
+// which leaves the rest to normal ones. A command that is not admitted gets a
+// "Busy: ..." reply at once and costs nothing more, so a client flooding
+// "open youtube" or "screenshot" does not slow down another one's "vol-".
+//
+// Frames that arrive in one read form a batch. Consecutive commands with the
+// same coalesce key are merged before they run (twenty "vol+" become one
+// handler call with count 20), and the replies of the whole batch go out in
+// a single write when the batch ends.
+//
+// Every reactor thread has its own dispatcher; they share the ConfigStore, the
+// pool, one InFlightTable and one RateTable, so maxConcurrent and the command
+// rate limits hold for the whole process. Client buckets are per dispatcher,
+// like the clients.
+//
+// Connections that switched to the binary protocol (see BinaryProtocol.hpp)
+// go through the same steps, but the command is found by its opcode and every
+// request is answered with one response frame carrying its request id instead
+// of the text reply and "Command received.".
+//
+// A reply with an attachment (screenshot image) is streamed: chunks are sent
+// while the client's outbox has room and the rest waits for
+// TcpServer::notifyWhenDrained(). On a text connection the image bytes must
+// not be split by other replies, so replies produced meanwhile are held and
+// sent after it; binary response frames are self-delimiting and interleave.
+//
+// Connections that switched to remote input ("input") send InputChannel
+// messages: they are added to this thread's channel and written to the input
+// sink once per batch, with no replies.
+//
+// Commands are looked up in the configuration snapshot of the calling thread
+// (ConfigStore::current()). The dispatcher moves to a newer snapshot only
+// between batches, when it holds no Command pointers; worker jobs keep their
+// snapshot alive until they finish.
+class CommandDispatcher {
+public:
+    // Worker commands currently queued or running, per command name (any thread).
+    // Keyed by name so the count survives a configuration reload.
+    class InFlightTable {
+    public:
+        // Takes a slot unless "limit" (> 0) slots are already taken
+        bool tryAcquire(const CommandRegistry::Command* cmd, int limit);
+        void release(const CommandRegistry::Command* cmd);
+
+    private:
+        std::mutex lock;
+        std::unordered_map<std::string, int> running;
+    };
+
+    // Token buckets of commands with their own rate limit (CommandOptions::rate),
+    // per command name (any thread)
+    class RateTable {
+    public:
+        // Takes a token for one run of "cmd"; see TokenBucket::take()
+        bool take(const CommandRegistry::Command* cmd, uint64_t nowNs, uint64_t& waitNs);
+
+    private:
+        std::mutex lock;
+        std::unordered_map<std::string, TokenBucket> buckets;
+    };
+
+    CommandDispatcher(TcpServer& server, ConfigStore& config, ThreadPool& pool, InFlightTable& inFlight,
+                      RateTable& rates);
+
+    // Injects the messages of "input" connections through "sink" (without a
+    // sink they are ignored)
+    void setInputSink(InputSink& sink);
+
+    // Message handler for TcpServer (event loop thread only)
+    void onFrame(TcpServer::ConnectionId client, std::string_view frame);
+
+    // Batch-end handler for TcpServer: runs the pending merged commands and sends all replies
+    void onBatchEnd(TcpServer::ConnectionId client);
+
+    // Disconnect handler for TcpServer: drops the client's unsent attachments
+    void onDisconnect(TcpServer::ConnectionId client);
+
+    // Sends a reply that is not the answer to a frame of the current batch
+    // (stream frames), in the client's protocol and behind its pending
+    // attachments. Event loop thread only.
+    void push(TcpServer::ConnectionId client, const CommandContext& reply);
+
+    // Attachments queued or being sent to a client
+    size_t queuedAttachments(TcpServer::ConnectionId client) const;
+
+    // True when no worker command of this loop's clients is running and no
+    // attachment is being sent (graceful shutdown waits for this)
+    bool idle() const { return workerJobs == 0 && streams.empty(); }
+
+private:
+    TcpServer& server;
+    ConfigStore& config;
+    ThreadPool& pool;
+    InFlightTable& inFlight;
+    RateTable& rates;
+
+    // Worker commands submitted and not answered yet
+    size_t workerJobs;
+
+    // Batch being collected. Only one connection is dispatched at a time, so
+    // a single batch is enough.
+    struct Batch {
+        TcpServer::ConnectionId client = 0;
+        std::string output;                          // replies of the whole batch
+
+        // Run of mergeable commands not executed yet
+        const CommandRegistry::Command* runLast = NULL;   // last command of the run
+        const CommandRegistry::Command* runUp = NULL;     // last command with step > 0
+        const CommandRegistry::Command* runDown = NULL;   // last command with step < 0
+        int runNet = 0;                                   // COALESCE_ADD: summed steps
+        int runLength = 0;                                // commands merged so far
+        std::vector<uint64_t> runIds;                     // binary: request ids of the merged commands
+        bool input = false;                               // input messages queued in the channel
+    };
+    Batch batch;
+
+    // Decoded binary request, reused for every frame
+    BinaryProtocol::Request request;
+
+    // Remote input of this thread's "input" connections; the keys they hold
+    // are released when the last of them disconnects
+    std::unique_ptr<InputChannel> input;
+    std::unordered_set<TcpServer::ConnectionId> inputClients;
+
+    // Per-client token buckets of the normal and heavy classes, made on the
+    // client's first limited command
+    struct ClientLimits {
+        TokenBucket normal;
+        TokenBucket heavy;
+    };
+    std::unordered_map<TcpServer::ConnectionId, ClientLimits> limits;
+
+    // Attachment being sent to one client
+    struct Stream {
+        std::shared_ptr<const std::string> data;
+        size_t offset = 0;
+        bool binary = false;
+        uint64_t requestId = 0;
+        bool acknowledge = true;
+        bool partial = false;    // binary: the last chunk is STATUS_MORE too
+        std::string held;        // text: replies that must follow the attachment
+    };
+    std::unordered_map<TcpServer::ConnectionId, std::deque<Stream> > streams;
+
+    // Bytes per chunk of an attachment
+    static const size_t STREAM_CHUNK = 64 * 1024;
+
+    void onBinaryFrame(TcpServer::ConnectionId client, std::string_view frame);
+    void onInputFrame(TcpServer::ConnectionId client, std::string_view frame);
+    bool admit(const CommandRegistry::Command* cmd, CommandContext& ctx);
+    void execute(const CommandRegistry::Command* cmd, CommandContext& ctx);
+    void flushRun();
+    void runOnWorker(const CommandRegistry::Command* cmd, CommandContext& ctx);
+    void finish(TcpServer::ConnectionId client, const CommandContext& ctx);
+    void deliver(TcpServer::ConnectionId client, std::string_view data);
+    void startStream(TcpServer::ConnectionId client, const CommandContext& ctx);
+    void pumpStreams(TcpServer::ConnectionId client);
+};
+
+#endif
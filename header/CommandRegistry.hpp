@@ -0,0 +1,143 @@
+#ifndef COMMANDREGISTRY_HPP
+#define COMMANDREGISTRY_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include "TCPServer.hpp"
+#include "TokenBucket.hpp"
+
+// Everything a command handler needs to know about one received command
+struct CommandContext {
+    // Context for "line" from "client"; the other fields start empty and are
+    // set by name (CommandRegistry::match() fills name / argLine / args)
+    CommandContext(TcpServer& server, TcpServer::ConnectionId client, std::string_view line = std::string_view())
+        : server(server), client(client), line(line) {}
+
+    TcpServer& server;
+    TcpServer::ConnectionId client;
+
+    std::string_view line;              // the whole frame as received (binary: the argument text)
+    std::string_view name;              // the registered command name that matched
+    std::string_view argLine;           // text after the command words ("" if none)
+    std::vector<std::string_view> args; // argLine split on whitespace
+
+    int count = 1;                      // repetitions to apply (merged additive commands)
+
+    std::string output;                 // reply text collected by reply()
+    bool acknowledge = true;            // send "Command received." after the output
+
+    bool binary = false;                // received over the binary protocol (see BinaryProtocol.hpp):
+    uint64_t requestId = 0;             // the reply is one response frame carrying this id
+
+    // Large binary reply (an image) sent after the output. The dispatcher
+    // streams it in chunks as the client reads, holding back later replies.
+    std::shared_ptr<const std::string> attachment;
+    bool partial = false;               // binary: more replies follow for requestId (STATUS_MORE)
+
+    // Queues reply text for the client that issued the command. The dispatcher
+    // sends it in one write when the handler returns (also for worker handlers,
+    // which must not call server methods themselves).
+    void reply(const std::string& text) { output += text; }
+};
+
+typedef std::function<void(CommandContext&)> CommandHandler;
+
+// How consecutive commands of one client may be merged by the dispatcher
+enum CoalesceMode {
+    COALESCE_NONE,  // every command runs
+    COALESCE_ADD,   // a run is summed: "vol+" x3, "vol-" -> one call with count 2
+    COALESCE_LAST   // only the last command of a run counts: open, close, open -> open
+};
+
+// How urgent a command is. The dispatcher admits commands by class before
+// running them, so a flood of slow commands cannot hold up the quick ones.
+enum CommandPriority {
+    PRIORITY_INTERACTIVE,   // cheap and latency-sensitive (vol+, mute, status): never limited
+    PRIORITY_NORMAL,        // limited by the per-client client_rate
+    PRIORITY_HEAVY,         // starts processes or captures the screen: client_heavy_rate, and
+                            // only the first half of the worker queue
+};
+
+// How the dispatcher runs a command
+struct CommandOptions {
+    bool worker = false;     // run on the thread pool instead of the event loop thread
+    int maxConcurrent = 0;   // simultaneous runs allowed (0 = unlimited), worker commands only
+
+    CoalesceMode coalesce = COALESCE_NONE;
+    std::string coalesceKey; // commands with the same key are merged with each other
+    int step = 0;            // COALESCE_ADD: signed amount one command contributes
+
+    CommandPriority priority = PRIORITY_NORMAL;
+    RateLimit rate;          // runs of this command from all clients together (count 0 = unlimited)
+};
+
+// CommandRegistry maps case-insensitive command names ("open facebook", "vol+")
+// to handlers.
+//
+// Names may have several words; a received line matches the longest registered
+// name made of its leading words, and the remaining words become arguments.
+// Lookups go through a minimal perfect hash (hash-and-displace), so dispatch
+// costs one hash of the line plus one probe per candidate word count, no matter
+// how many commands are registered. Neither the line nor the names are copied
+// or lowercased on the dispatch path.
+//
+// Every command also has an opcode, its registration position (1, 2, ...),
+// which binary-protocol requests use instead of the name.
+class CommandRegistry {
+public:
+    struct Command {
+        std::string name;               // normalised: lowercase, single spaces
+        int words;                      // number of words in name
+        uint64_t hash;
+        CommandHandler handler;
+        std::string help;
+        CommandOptions options;
+        int metricId;                   // handler latency histogram (see Metrics)
+        uint32_t opcode;                // binary protocol: 1 + registration position
+    };
+
+    CommandRegistry();
+
+    // Registers (or replaces) a command. Rebuilds the hash table.
+    void add(const std::string& name, const CommandHandler& handler, const std::string& help = "",
+             const CommandOptions& options = CommandOptions());
+
+    // Looks up ctx.line and fills ctx.name / argLine / args.
+    // Returns NULL if no command matched (ctx is left untouched).
+    const Command* match(CommandContext& ctx) const;
+
+    // Command with the given binary-protocol opcode (NULL if none)
+    const Command* byOpcode(uint64_t opcode) const {
+        return opcode >= 1 && opcode <= commands.size() ? &commands[opcode - 1] : NULL;
+    }
+
+    // Number of registered commands
+    size_t size() const { return commands.size(); }
+
+    // "name - help" lines of every registered command, in registration order
+    std::string helpText() const;
+
+    // "opcode name" lines of every registered command (binary OP_LIST reply)
+    std::string opcodeTable() const;
+
+private:
+    std::vector<Command> commands;
+
+    // Perfect hash: the first hash half selects a bucket, the bucket's
+    // displacement picks the final slot. slots[] holds an index into commands.
+    std::vector<uint32_t> displacement;
+    std::vector<int32_t> slots;
+    int maxWords;
+
+    void rebuild();
+    size_t slotFor(uint64_t hash) const;
+    const Command* lookup(const std::string_view* words, int count) const;
+
+    static std::string normalise(const std::string& name, int* words);
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef COMMANDS_HPP
+#define COMMANDS_HPP
+
+#include <functional>
+#include "CommandRegistry.hpp"
+#include "ProcessLauncher.hpp"
+#include "ProcessControl.hpp"
+#include "VolumeBackend.hpp"
+#include "AppRegistry.hpp"
+#include "BrowserPool.hpp"
+#include "ScreenshotService.hpp"
+#include "ScreenStreamer.hpp"
+#include "InputSink.hpp"
+#include "Config.hpp"
+
+// Subsystems the built-in commands act on
+struct CommandServices {
+    ProcessLauncher& launcher;
+    ProcessControl& control;
+    VolumeBackend& volume;
+    AppRegistry& apps;          // what is open, updated on launch / close / exit
+    BrowserPool& browsers;      // opens the browser app windows (cold or warm)
+    ScreenshotService& screenshots;
+    ScreenStreamer& streamer;   // live "stream" sessions
+    InputSink* input;           // remote mouse / keyboard, NULL = off
+    bool mock;                  // mock handlers: do not run external tools
+    std::function<void()> shutdown;   // drains and stops every reactor thread ("exit")
+};
+
+// Registers the built-in PC control commands ("open youtube", "vol+", ...) for
+// the apps and limits in "config", and hands the app profiles to the services
+void registerBuiltinCommands(CommandRegistry& registry, CommandServices& services, const Config& config);
+
+#endif
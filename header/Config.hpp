@@ -0,0 +1,80 @@
+#ifndef CONFIG_HPP
+#define CONFIG_HPP
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include "TokenBucket.hpp"
+
+// Config holds the settings read from the configuration file (pcctl.conf).
+//
+// The file is a list of "key = value" lines; "[app <name>]" starts the
+// definition of one browser app, which gets "open <name>" / "close <name>"
+// commands. '#' starts a comment. Example:
+//
+//   port = 8080
+//   browser = google-chrome
+//   screenshot_limit = 1
+//
+//   [app youtube]
+//   title = YouTube
+//   profile = /tmp/youtube_session
+//   url = https://www.youtube.com/
+//   flags = --kiosk --disable-gpu
+//   reply = YouTube opened. You can now search songs using: play <song name>
+//
+// Without a file the built-in defaults below are used (the four original apps).
+struct AppConfig {
+    std::string name;                   // command word and launcher session ("youtube")
+    std::string title;                  // shown in logs / replies ("YouTube")
+    std::string profileDir;             // browser --user-data-dir
+    std::string url;
+    std::vector<std::string> flags;     // extra browser arguments
+    std::string reply;                  // optional text sent after a successful open
+};
+
+struct Config {
+    // Used at startup only (a reload that changes them logs a warning)
+    int port = 8080;
+    int metricsPort = 9100;
+    int threads = 1;                    // reactor threads, 0 = one per CPU
+    bool pinCpus = false;
+    bool warmBrowsers = false;
+    size_t workerQueue = 64;            // jobs waiting for a worker thread
+    size_t outboxLimit = 256 * 1024;    // per-client queued reply bytes
+    int idleTimeout = 300;              // seconds without traffic before a client is closed, 0 = never
+    bool tcpNoDelay = true;
+    int keepAlive = 60;                 // seconds of silence before keepalive probes, 0 = off
+    std::string handoffSocket;          // Unix socket for restarts without refused connections, "" = off
+    std::string ioBackend = "epoll";    // client socket I/O: "epoll" or "io_uring"
+    std::string screenshotSource;       // "x11", "file:PATH", "test", "" = best available
+    std::string inputBackend;           // remote input: "uinput", "mock", "off", "" = uinput when available
+    int inputUdpPort = 0;               // UDP port for remote input messages, 0 = off
+    std::string captureFile;            // record client traffic for tcp_replay, "" = off
+    int captureLimitMb = 256;           // the capture stops growing at this size
+
+    // Applied again on every reload
+    std::string browser = "google-chrome";
+    int screenshotLimit = 1;            // screenshots running at the same time
+    int screenshotCacheMs = 200;        // a newer screenshot of the same size is sent again
+    int streamFps = 10;                 // "stream" frame rate when none is given
+    int drainTimeout = 5;               // seconds to finish running commands on shutdown
+    bool remoteExit = false;            // accept "exit" from other machines, not only localhost
+    RateLimit clientRate = { 50, 1 };       // normal commands per client ("50/s")
+    RateLimit clientHeavyRate = { 5, 1 };   // heavy commands (screenshot, open / close) per client
+    RateLimit appRate = { 10, 60 };         // each open / close command, all clients together
+    std::vector<AppConfig> apps;
+
+    // Built-in configuration: the original Facebook / YouTube / GitHub / Gmail apps
+    static Config defaults();
+
+    // Parses a configuration file. On error returns false and describes the
+    // problem (with its line number) in "error"; "config" is then unchanged.
+    static bool load(const std::string& path, Config& config, std::string& error);
+    static bool parse(const std::string& text, Config& config, std::string& error);
+
+    // Pointer to the app called "name" (NULL if not configured)
+    const AppConfig* findApp(const std::string& name) const;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef CONFIGSTORE_HPP
+#define CONFIGSTORE_HPP
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+#include "Config.hpp"
+#include "CommandRegistry.hpp"
+#include "TCPServer.hpp"
+
+// Everything a reload replaces, built once and never modified afterwards
+struct RuntimeConfig {
+    Config config;
+    CommandRegistry commands;   // built from config (one open / close pair per app)
+};
+
+// ConfigStore publishes the current RuntimeConfig to the reactor and worker
+// threads, RCU-style.
+//
+// A reload builds a complete new RuntimeConfig and swaps it in with publish();
+// nothing is ever changed in place. Every thread keeps its own reference to
+// the snapshot it uses and only moves to a newer one at a point where it holds
+// no pointers into the old one (refresh(), called by the dispatcher between
+// batches). Readers therefore take no lock: current() is a thread-local
+// pointer, refresh() one atomic load unless a new version was published.
+// A snapshot is freed when the last thread has moved past it.
+//
+// The per-thread references are thread_local, so a process has one store.
+//
+// Reloads are triggered by SIGHUP and by changes to the configuration file
+// (inotify on its directory, so editors that save by rename are seen too).
+class ConfigStore {
+public:
+    typedef std::shared_ptr<const RuntimeConfig> Snapshot;
+
+    // Called on the event loop thread when a reload is requested
+    typedef std::function<void()> ReloadHandler;
+
+    ConfigStore();
+    ~ConfigStore();
+
+    // Makes "next" the current configuration (any thread)
+    void publish(Snapshot next);
+
+    // The calling thread's snapshot (the newest one on first use)
+    const RuntimeConfig& current();
+
+    // Shared reference to the calling thread's snapshot, for work that outlives
+    // the current batch (worker jobs)
+    Snapshot currentShared();
+
+    // Moves the calling thread to the newest snapshot if there is one.
+    // References obtained from current() before are invalid afterwards.
+    void refresh();
+
+    // Version of the newest snapshot (incremented by publish())
+    uint64_t version() const { return published.load(std::memory_order_acquire); }
+
+    // Watches SIGHUP and "path" (if not empty) on the server's event loop and
+    // calls "reload" for each. SIGHUP must be blocked before threads are created.
+    bool attach(TcpServer& server, const std::string& path, const ReloadHandler& reload);
+
+private:
+    std::mutex lock;                    // guards "latest" (publish / refresh only)
+    Snapshot latest;
+    std::atomic<uint64_t> published;
+
+    int signal_fd;
+    int inotify_fd;
+    std::string fileName;               // file watched in its directory
+    ReloadHandler onReload;
+
+    void onSignal();
+    void onFileEvent();
+};
+
+#endif
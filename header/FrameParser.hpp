@@ -0,0 +1,57 @@
+#ifndef FRAMEPARSER_HPP
+#define FRAMEPARSER_HPP
+
+#include <cstddef>
+#include <string_view>
+#include "RingBuffer.hpp"
+
+// FrameParser splits the byte stream of one connection into complete frames.
+//
+//   NEWLINE         : "vol+\n" or "vol+\r\n"  (the delimiter is not part of the frame)
+//   LENGTH_PREFIXED : 4-byte big-endian payload length followed by the payload
+//                     (text commands after "framed")
+//   VARINT_PREFIXED : LEB128 varint payload length followed by the payload
+//                     (binary protocol, see BinaryProtocol.hpp)
+//   FIXED_SIZE      : FIXED_FRAME bytes per frame, no header or delimiter
+//                     (remote input messages, see InputChannel.hpp)
+//
+// Frames are returned as views into the connection's RingBuffer. A view stays
+// valid until the next call to next() on the same buffer.
+class FrameParser {
+public:
+    enum Mode { NEWLINE, LENGTH_PREFIXED, VARINT_PREFIXED, FIXED_SIZE };
+    enum Result { FRAME, NEED_MORE, TOO_LARGE };
+
+    // Size of a FIXED_SIZE frame
+    static const size_t FIXED_FRAME = 8;
+
+    // Constructor to choose the framing mode and the largest accepted frame (bytes)
+    FrameParser(Mode mode = NEWLINE, size_t maxFrame = 64 * 1024);
+
+    Mode mode() const { return framing; }
+
+    // Switches the framing for the bytes after the last returned frame
+    // (protocol negotiation; may be called between two next() calls)
+    void setMode(Mode mode);
+
+    // Extracts the next complete frame from "in".
+    // The bytes of the previously returned frame are consumed first.
+    Result next(RingBuffer& in, std::string_view& frame);
+
+private:
+    Mode framing;
+    size_t maxFrame;
+
+    // Bytes (frame + delimiter / header) to drop before parsing the next frame
+    size_t pendingConsume;
+
+    // NEWLINE mode: how far the buffer was already searched for '\n'
+    size_t scanned;
+
+    Result nextLine(RingBuffer& in, std::string_view& frame);
+    Result nextLengthPrefixed(RingBuffer& in, std::string_view& frame);
+    Result nextVarintPrefixed(RingBuffer& in, std::string_view& frame);
+    Result nextFixedSize(RingBuffer& in, std::string_view& frame);
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef FRAMESOURCE_HPP
+#define FRAMESOURCE_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// One captured screen image: tightly packed 8-bit RGB rows, top row first
+struct Frame {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> rgb;       // width * height * 3 bytes (capacity is reused)
+};
+
+// FrameSource delivers screen contents for the screenshot / stream commands.
+//
+// Implementations:
+//   "x11"       : the X server's root window through XGetImage, in-process
+//                 (built when Xlib is available; works with Xvfb too)
+//   "file:PATH" : reads a binary PPM (P6) image from PATH on every capture, so
+//                 a test or another program can provide the frames
+//   "test"      : a generated moving test pattern, for headless machines and
+//                 benchmarks
+//
+// capture() is called from worker threads; the sources returned by
+// createFrameSource() may be used from several threads at once.
+class FrameSource {
+public:
+    virtual ~FrameSource() {}
+
+    virtual const char* name() const = 0;
+
+    // Fills "frame" with the current screen contents (reusing its buffer).
+    // Returns false if nothing could be captured.
+    virtual bool capture(Frame& frame) = 0;
+};
+
+// Creates the source described by "kind" ("x11", "file:PATH", "test" or "" for
+// the best available one). Returns NULL if it cannot be opened.
+std::unique_ptr<FrameSource> createFrameSource(const std::string& kind);
+
+#ifdef HAVE_X11
+// Defined in X11FrameSource.cpp (NULL if the display cannot be opened)
+std::unique_ptr<FrameSource> createX11FrameSource();
+#endif
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef IMAGEENCODER_HPP
+#define IMAGEENCODER_HPP
+
+#include <string>
+#include "FrameSource.hpp"
+
+// ImageEncoder turns captured frames into image files in memory.
+//
+// With zlib available the output is PNG (fast compression level: screenshots
+// are sent right away, a few percent of size are not worth the CPU time);
+// otherwise an uncompressed binary PPM. Everything runs on the calling (worker)
+// thread and writes into caller-provided buffers, so pooled buffers can be reused.
+class ImageEncoder {
+public:
+    // "png" or "ppm": what encode() produces in this build
+    static const char* format();
+
+    // Shrinks "in" by the smallest integer factor that makes it at most
+    // "maxWidth" pixels wide, averaging each factor x factor block.
+    // Returns false (and leaves "out" alone) if no scaling is needed.
+    static bool downscale(const Frame& in, int maxWidth, Frame& out);
+
+    // Appends the encoded image to "out"
+    static bool encode(const Frame& frame, std::string& out);
+
+    // Replaces "data" with its deflate (zlib format) compression at the fast
+    // level. Returns false, leaving "data" alone, without zlib or on failure.
+    static bool compress(std::string& data, std::string& scratch);
+};
+
+#endif
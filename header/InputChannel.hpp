@@ -0,0 +1,90 @@
+#ifndef INPUTCHANNEL_HPP
+#define INPUTCHANNEL_HPP
+
+#include <bitset>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+#include "InputSink.hpp"
+#include "TCPServer.hpp"
+
+// InputChannel turns remote input messages (a phone used as trackpad and
+// keyboard) into input reports for an InputSink.
+//
+// A message is MESSAGE_SIZE bytes, numbers big-endian:
+//
+//   kind (1 byte) | 0 (1 byte) | code (2 bytes) | value (4 bytes)
+//
+//   KIND_MOVE    value = dx (int16) | dy (int16)    pointer motion, code 0
+//   KIND_WHEEL   value = vertical (int16) | horizontal (int16), code 0
+//   KIND_BUTTON  code = 0 left, 1 right, 2 middle, 3 side, 4 extra;
+//                value = 1 press, 0 release
+//   KIND_KEY     code = Linux key code (KEY_A = 30, ...; 1..InputSink::MAX_KEY);
+//                value = 1 press, 0 release, 2 autorepeat
+//
+// Messages arrive on a TCP connection that sent the text command "input"
+// (FrameParser::FIXED_SIZE framing, no replies) or as UDP datagrams of one or
+// more messages on the input port.
+//
+// Events are collected and written together by flush(), once per read batch
+// or datagram batch: consecutive moves and wheel turns are summed into one
+// report, so a client sending at a higher rate than the frames we read costs
+// one write() per batch, not one per event. A button or key ends the running
+// motion first, so a drag still moves, presses, moves, releases in order.
+//
+// One channel per thread; they can share the sink.
+class InputChannel {
+public:
+    enum Kind { KIND_MOVE = 1, KIND_WHEEL = 2, KIND_BUTTON = 3, KIND_KEY = 4 };
+
+    static const size_t MESSAGE_SIZE = FrameParser::FIXED_FRAME;
+
+    InputChannel(InputSink& sink);
+    ~InputChannel();
+
+    // Queues the events of one message; false if it is malformed
+    bool add(std::string_view message);
+
+    // Writes the queued events to the sink with one call
+    void flush();
+
+    // Releases the keys and buttons this channel pressed and did not release
+    // (the last client sending them went away)
+    void releaseAll();
+
+    // Opens the UDP input socket on "port" and registers it with the event loop
+    bool attach(TcpServer& loop, int port);
+
+    // Appends an encoded message (clients, tests)
+    static void encode(std::string& out, Kind kind, uint16_t code, int32_t value);
+
+private:
+    InputSink& sink;
+    std::vector<struct input_event> pending;
+
+    // Motion not written yet
+    int64_t moveX;
+    int64_t moveY;
+    int64_t wheelV;
+    int64_t wheelH;
+    bool moved;
+
+    // Keys (by code) and buttons (MAX_KEY + 1 + button) held down
+    std::bitset<InputSink::MAX_KEY + 1 + (InputSink::LAST_BUTTON - BTN_LEFT + 1)> held;
+
+    int udp_fd;
+
+    // Events queued at most before they are written without waiting for flush()
+    static const size_t MAX_PENDING = 256;
+
+    // Datagrams read per wakeup of the UDP socket
+    static const int UDP_BATCH = 32;
+
+    void push(uint16_t type, uint16_t code, int32_t value);
+    void endMotion();
+    void press(uint16_t code, size_t slot, int32_t value);
+    void onDatagrams();
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef INPUTSINK_HPP
+#define INPUTSINK_HPP
+
+#include <memory>
+#include <string>
+#include <stddef.h>
+#include <linux/input.h>
+
+// InputSink injects mouse and keyboard events into the desktop.
+//
+// Implementations:
+//   "uinput" : one virtual device created through /dev/uinput when the sink is
+//              made and kept until it is destroyed, so injecting a report is a
+//              single write() of the whole event array
+//   "mock"   : counts the events and tracks the pointer in memory, for
+//              headless machines and benchmarks
+//
+// write() may be called from several reactor threads at once.
+class InputSink {
+public:
+    // Event codes a device is created with: keyboard keys 1..MAX_KEY,
+    // mouse buttons BTN_LEFT..BTN_EXTRA, axes REL_X, REL_Y, REL_WHEEL, REL_HWHEEL
+    static const int MAX_KEY = 255;
+    static const int LAST_BUTTON = BTN_EXTRA;
+
+    virtual ~InputSink() {}
+
+    virtual const char* name() const = 0;
+
+    // Injects "count" events (the last one a SYN_REPORT) in one go
+    virtual bool write(const struct input_event* events, size_t count) = 0;
+
+    // One line for "input status"
+    virtual std::string status() = 0;
+};
+
+// Creates the sink called "kind" ("uinput", "mock", or "" for uinput when the
+// device can be created). Returns NULL if it cannot be opened.
+std::unique_ptr<InputSink> createInputSink(const std::string& kind);
+
+#endif
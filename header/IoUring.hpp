@@ -0,0 +1,97 @@
+#ifndef IOURING_HPP
+#define IOURING_HPP
+
+#include <cstddef>
+#include <functional>
+#include <stdint.h>
+#include <linux/io_uring.h>
+
+// IoUring is a minimal io_uring instance driven through the raw system calls
+// (no liburing): a submission queue the loop fills with requests, a
+// completion queue it reads the results from, and one ring of provided
+// receive buffers the kernel picks from for multishot recv.
+//
+// Both queues are shared memory: queuing a request or reading a result is a
+// plain memory access, and one io_uring_enter() call submits every request
+// queued since the last one. Used from one thread only.
+class IoUring {
+public:
+    IoUring();
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Creates the rings; false (logged) if the kernel lacks something the
+    // TcpServer backend needs: multishot accept / recv, provided buffer rings
+    bool init(unsigned entries);
+
+    bool active() const { return ring_fd >= 0; }
+
+    // Descriptor that polls readable while completions are waiting
+    int fd() const { return ring_fd; }
+
+    // Next free submission entry, zeroed. A full queue is submitted first;
+    // NULL only if that fails.
+    struct io_uring_sqe* nextSqe();
+
+    // Hands every queued entry to the kernel with one io_uring_enter()
+    bool submit();
+    bool hasQueued() const { return sqeTail != submittedTail; }
+
+    // Calls "handler" for every completion waiting; returns how many.
+    // Requests IoUring queues itself (buffer recycling) have user_data 0.
+    size_t reap(const std::function<void(const struct io_uring_cqe&)>& handler);
+
+    // Registers "count" (power of two) buffers of "size" bytes as buffer group
+    // "group", for requests with IOSQE_BUFFER_SELECT, as a buffer ring or,
+    // where that does not work, as classic provided buffers. On failure the
+    // ring is closed too.
+    bool setupBuffers(uint16_t group, unsigned count, unsigned size);
+
+    // Buffer the kernel filled (id from the completion flags) and giving it back
+    const char* buffer(uint16_t id) const { return buffers + static_cast<size_t>(id) * bufferSize; }
+    void recycleBuffer(uint16_t id);
+
+private:
+    int ring_fd;
+
+    // Mapped rings: submission queue ring, completion queue ring (the same
+    // mapping with IORING_FEAT_SINGLE_MMAP) and the submission entries
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+    struct io_uring_sqe* sqes;
+    size_t sqesSize;
+
+    // Pointers into the mapped rings
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqFlags;
+    unsigned sqMask;
+    unsigned sqEntries;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    struct io_uring_cqe* cqes;
+
+    // Entries handed out by nextSqe() / already passed to io_uring_enter()
+    unsigned sqeTail;
+    unsigned submittedTail;
+
+    // Provided buffers: the ring the kernel takes them from (NULL for
+    // classic provided buffers) and their memory
+    struct io_uring_buf_ring* bufRing;
+    size_t bufRingSize;
+    char* buffers;
+    size_t buffersSize;
+    unsigned bufferSize;
+    unsigned bufferMask;
+    uint16_t bufferGroup;
+
+    void destroy();
+    bool receiveWorks();
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef LATENCYHISTOGRAM_HPP
+#define LATENCYHISTOGRAM_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// LatencyHistogram records durations (nanoseconds) in log-linear buckets:
+// every power of two is split into 16 sub-buckets, so any value is stored
+// with at most ~6% error while the whole range up to 2^64 ns fits in
+// fewer than 1000 counters. Recording is one index computation and one add.
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKETS = 16;
+    static const int BUCKETS = 16 + 60 * SUB_BUCKETS;
+
+    LatencyHistogram();
+
+    void record(uint64_t nanos);
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maxValue; }
+    uint64_t min() const { return total == 0 ? 0 : minValue; }
+    double mean() const { return total == 0 ? 0.0 : static_cast<double>(sum) / total; }
+
+    // Value below which "percentile" (0..100) of the recordings fall
+    uint64_t percentile(double percentile) const;
+
+    // Bucket helpers, also used by other recorders that share the layout
+    static int bucketOf(uint64_t nanos);
+    static uint64_t bucketUpperBound(int bucket);
+
+    // Raw counters (BUCKETS entries)
+    const std::vector<uint64_t>& buckets() const { return counts; }
+
+    // Adds "n" recordings to one bucket (for merging external counters)
+    void addToBucket(int bucket, uint64_t n, uint64_t sumNanos);
+
+    // One line summary: "n=... p50=...us p99=...us p999=...us max=...us"
+    std::string summary() const;
+
+private:
+    std::vector<uint64_t> counts;
+    uint64_t total;
+    uint64_t sum;
+    uint64_t minValue;
+    uint64_t maxValue;
+};
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <atomic>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+// Logger is an asynchronous logger for the server.
+//
+// The calling thread only formats the message into a fixed-size record of a
+// lock-free ring buffer (no allocation, no lock, no system call); a background
+// thread turns the records into text or JSON lines and writes them to stdout
+// or a file. If the ring is full the record is dropped and counted instead of
+// blocking the request path.
+//
+// Every LOG_* statement is its own call site with a per-second budget
+// (setRateLimit), so a command flood cannot turn into a logging flood; the
+// next line that gets through reports how many were suppressed.
+//
+//   LOG_INFO("Client connected: ", peer, " (", count, " open)");
+class Logger {
+public:
+    enum Level { LEVEL_DEBUG, LEVEL_INFO, LEVEL_WARN, LEVEL_ERROR };
+    enum Format { FORMAT_TEXT, FORMAT_JSON };
+
+    // One LOG_* statement: source location and its rate limit window
+    struct Site {
+        constexpr Site(const char* file, int line)
+            : file(file), line(line), window(0), used(0), suppressed(0) {}
+
+        const char* file;
+        int line;
+        std::atomic<uint64_t> window;       // second the "used" budget belongs to
+        std::atomic<uint32_t> used;         // records logged in that second
+        std::atomic<uint32_t> suppressed;   // records refused since the last one logged
+    };
+
+    static const size_t CAPACITY = 4096;    // records in the ring (power of two)
+    static const size_t TEXT_MAX = 216;     // message bytes per record, longer ones are cut
+
+    static Logger& instance();
+
+    // Starts the writer thread. "path" empty = stdout, otherwise the file is appended to.
+    bool start(const std::string& path, Format format);
+
+    // Writes everything still queued and stops the writer thread
+    void stop();
+
+    void setLevel(Level level) { minLevel.store(level, std::memory_order_relaxed); }
+    bool enabled(Level level) const { return level >= minLevel.load(std::memory_order_relaxed); }
+
+    // Records per second each call site may log (0 = unlimited, default 100)
+    void setRateLimit(uint32_t perSecond) { rateLimit.store(perSecond, std::memory_order_relaxed); }
+
+    // Records lost because the ring was full
+    uint64_t dropped() const { return droppedRecords.load(std::memory_order_relaxed); }
+
+    // Parses "debug" / "info" / "warn" / "error" and "text" / "json"
+    static bool parseLevel(const std::string& text, Level& level);
+    static bool parseFormat(const std::string& text, Format& format);
+
+    // Formats the arguments into a record and queues it (use the LOG_* macros)
+    template <typename... Args>
+    void log(Level level, Site& site, const Args&... args) {
+        uint64_t time = wallClock();
+        uint32_t suppressed = 0;
+        if (!admit(site, time, suppressed)) return;
+
+        size_t pos;
+        Record* record = claim(pos);
+        if (record == NULL) {
+            droppedRecords.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        record->time = time;
+        record->site = &site;
+        record->level = static_cast<uint8_t>(level);
+        record->suppressed = suppressed;
+        record->length = 0;
+        (append(*record, args), ...);
+        record->seq.store(pos + 1, std::memory_order_release);
+    }
+
+private:
+    // One queued log line. "seq" tells producers and the writer who owns the slot
+    // (Vyukov bounded queue): pos = free for the producer claiming position pos,
+    // pos + 1 = filled and ready for the writer.
+    struct alignas(64) Record {
+        std::atomic<size_t> seq;
+        uint64_t time;              // CLOCK_REALTIME in nanoseconds
+        const Site* site;
+        uint32_t suppressed;
+        uint16_t length;
+        uint8_t level;
+        char text[TEXT_MAX];
+    };
+
+    Logger();
+    ~Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    static uint64_t wallClock() {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+    }
+
+    bool admit(Site& site, uint64_t time, uint32_t& suppressed);
+    Record* claim(size_t& pos);
+
+    // Appenders used by log(): strings are copied, numbers formatted with to_chars
+    static void appendText(Record& record, const char* data, size_t size);
+    static void append(Record& record, std::string_view text) { appendText(record, text.data(), text.size()); }
+    static void append(Record& record, const std::string& text) { appendText(record, text.data(), text.size()); }
+    static void append(Record& record, const char* text) { append(record, std::string_view(text ? text : "(null)")); }
+    static void append(Record& record, char c) { appendText(record, &c, 1); }
+    static void append(Record& record, bool value) { append(record, value ? "true" : "false"); }
+
+    template <typename T>
+    static typename std::enable_if<std::is_arithmetic<T>::value>::type append(Record& record, T value) {
+        char digits[32];
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+        appendText(record, digits, result.ptr - digits);
+    }
+
+    void writerLoop();
+    size_t drain();
+    void format(const Record& record, std::string& out) const;
+
+    Record* ring;
+    alignas(64) std::atomic<size_t> head;   // next position producers claim
+    alignas(64) size_t tail;                // next position the writer reads (writer only)
+
+    std::atomic<int> minLevel;
+    std::atomic<uint32_t> rateLimit;
+    std::atomic<uint64_t> droppedRecords;
+    uint64_t reportedDrops;
+
+    FILE* out;
+    bool ownsFile;
+    Format outputFormat;
+    std::atomic<bool> running;
+    std::thread writer;
+};
+
+#define LOG_AT(level, ...)                                                      \
+    do {                                                                        \
+        static Logger::Site logSite_(__FILE__, __LINE__);                       \
+        if (Logger::instance().enabled(level))                                  \
+            Logger::instance().log(level, logSite_, __VA_ARGS__);               \
+    } while (0)
+
+#define LOG_DEBUG(...) LOG_AT(Logger::LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)  LOG_AT(Logger::LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...)  LOG_AT(Logger::LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(Logger::LEVEL_ERROR, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <time.h>
+
+// Metrics collects counters and latency histograms from the hot path.
+//
+// Every thread writes only to its own slot (created on first use), so
+// recording never takes a lock and never bounces a cache line between cores:
+// the owner does a relaxed load + store on its own counters. render() sums
+// all slots when the admin endpoint is scraped.
+//
+// Histograms use power-of-two nanosecond buckets (bucket i counts values
+// below 2^i ns), which is enough for percentiles and cheap to update.
+class Metrics {
+public:
+    // Fixed stages of the request path
+    enum Stage { STAGE_ACCEPT, STAGE_READ, STAGE_PARSE, STAGE_DISPATCH, STAGE_SEND, STAGE_COUNT };
+
+    // Plain counters
+    enum Counter {
+        CONNECTIONS_ACCEPTED,
+        CONNECTIONS_CLOSED,
+        CONNECTIONS_IDLE_CLOSED,
+        BYTES_READ,
+        BYTES_SENT,
+        FRAMES_RECEIVED,
+        COMMANDS_UNKNOWN,
+        COMMANDS_MERGED,
+        COMMANDS_BUSY,
+        COMMANDS_THROTTLED,
+        INPUT_EVENTS,
+        INPUT_MERGED,
+        COUNTER_COUNT
+    };
+
+    static const int BUCKETS = 40;       // up to 2^39 ns ~ 9 minutes
+    static const int MAX_HANDLERS = 128; // distinct command names with their own histogram
+
+    static Metrics& instance();
+
+    // Monotonic time in nanoseconds (vDSO, no system call)
+    static uint64_t now() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+    }
+
+    void add(Counter counter, uint64_t n = 1);
+    void recordStage(Stage stage, uint64_t nanos);
+
+    // Returns the histogram id for a command name (registering it on first use),
+    // or -1 when MAX_HANDLERS names are already in use
+    int handlerId(const std::string& name);
+    void recordHandler(int id, uint64_t nanos);
+
+    // Prometheus text exposition format
+    std::string render();
+
+private:
+    struct Histogram {
+        std::atomic<uint64_t> buckets[BUCKETS];
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum;
+    };
+
+    struct ThreadSlot {
+        std::atomic<uint64_t> counters[COUNTER_COUNT];
+        Histogram stages[STAGE_COUNT];
+        Histogram handlers[MAX_HANDLERS];
+    };
+
+    Metrics();
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    ThreadSlot& slot();
+    static void bump(std::atomic<uint64_t>& value, uint64_t n);
+    static void record(Histogram& h, uint64_t nanos);
+
+    std::mutex lock;                    // guards slots and handlerNames (cold paths only)
+    std::vector<ThreadSlot*> slots;
+    std::vector<std::string> handlerNames;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef METRICSSERVER_HPP
+#define METRICSSERVER_HPP
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include "TCPServer.hpp"
+#include "TimerWheel.hpp"
+
+// MetricsServer answers HTTP requests on a separate admin port with the
+// Prometheus text rendering of Metrics (any path, e.g. GET /metrics).
+//
+// It shares the TcpServer event loop through watchFd(), so no extra thread is
+// needed. The admin port is separate from the command port so scrapers never
+// mix with client traffic.
+//
+// The port shares the process's descriptors with the command port, so it is
+// bounded: at most MAX_SCRAPERS connections at once (more are closed on
+// accept), and each one is closed SCRAPE_TIMEOUT_MS after it connected,
+// answered or not. Deadlines sit in a TimerWheel ticked by a timerfd that
+// runs only while scrapers are connected.
+class MetricsServer {
+public:
+    MetricsServer(int port);
+    ~MetricsServer();
+
+    // Opens the admin socket and registers it with the event loop
+    bool attach(TcpServer& server);
+
+private:
+    int port;
+    int listen_fd;
+    int timer_fd;
+    TcpServer* loop;
+
+    // Scrape connection: response bytes not yet written ("" = request not read
+    // yet), and its key in the wheel (accept counter and fd, so a reused fd
+    // is not closed by the previous connection's deadline)
+    struct Scraper {
+        std::string response;
+        uint64_t key;
+        int64_t deadlineMs;
+    };
+    std::unordered_map<int, Scraper> clients;
+    uint32_t accepted;
+
+    TimerWheel deadlines;
+    std::vector<uint64_t> due;
+
+    static const size_t MAX_SCRAPERS = 16;
+    static const int64_t SCRAPE_TIMEOUT_MS = 5000;
+    static const int64_t TICK_MS = 500;
+
+    void acceptScrapers();
+    void onClient(int fd, uint32_t events);
+    void closeClient(int fd);
+    void armTimer(bool on);
+    void onTimer();
+};
+
+#endif
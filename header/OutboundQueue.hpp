@@ -0,0 +1,83 @@
+#ifndef OUTBOUNDQUEUE_HPP
+#define OUTBOUNDQUEUE_HPP
+
+#include <cstddef>
+#include <deque>
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// BufferPool hands out fixed-size chunks and keeps released ones for reuse,
+// so steady-state sending does not allocate. Used from one thread only.
+class BufferPool {
+public:
+    static const size_t CHUNK_SIZE = 4096;
+
+    struct Chunk {
+        size_t begin;              // first unsent byte
+        size_t end;                // one past the last queued byte
+        char data[CHUNK_SIZE];
+    };
+
+    // Constructor to keep at most "maxFree" released chunks around
+    BufferPool(size_t maxFree = 256);
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    Chunk* acquire();
+    void release(Chunk* chunk);
+
+private:
+    std::vector<Chunk*> freeChunks;
+    size_t maxFree;
+};
+
+// OutboundQueue holds the bytes waiting to be written to one socket.
+//
+// Data is copied into pooled chunks and written with one sendmsg() per up to
+// 64 chunks (writev() semantics plus MSG_NOSIGNAL). Partial writes just advance the first chunk; EAGAIN leaves
+// everything queued for the next EPOLLOUT.
+class OutboundQueue {
+public:
+    enum FlushResult { FLUSHED, WOULD_BLOCK, FAILED };
+
+    // Chunks gathered into one sendmsg() call
+    static const int MAX_IOV = 64;
+
+    OutboundQueue(BufferPool& pool);
+    ~OutboundQueue();
+
+    OutboundQueue(OutboundQueue&& other) noexcept;
+    OutboundQueue(const OutboundQueue&) = delete;
+    OutboundQueue& operator=(const OutboundQueue&) = delete;
+    OutboundQueue& operator=(OutboundQueue&&) = delete;
+
+    // Queues a copy of "data"
+    void append(std::string_view data);
+
+    // Writes as much as the socket accepts
+    FlushResult flush(int fd);
+
+    // For writers that send asynchronously (io_uring): fills "iov" with the
+    // first queued bytes (up to "maxIov" chunks) and returns the count. The
+    // chunks stay queued and in place until consume() drops the bytes the
+    // socket took; append() meanwhile only adds bytes behind them.
+    int gather(struct iovec* iov, int maxIov) const;
+    void consume(size_t sent);
+
+    // Bytes queued and not yet written
+    size_t size() const { return queued; }
+    bool empty() const { return queued == 0; }
+
+private:
+    BufferPool* pool;
+    std::deque<BufferPool::Chunk*> chunks;
+    size_t queued;
+
+    void clear();
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef PROCESSCONTROL_HPP
+#define PROCESSCONTROL_HPP
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <stdint.h>
+#include <sys/types.h>
+#include "TCPServer.hpp"
+#include "ProcessLauncher.hpp"
+
+// ProcessControl terminates programs directly with kill(), without running a
+// shell or pkill.
+//
+// Processes started through the ProcessLauncher are known by pid and process
+// group, so closing them is one killpg() per group. Processes we did not start
+// (for example left over from a previous server run) are found through a cached
+// index of /proc/<pid>/cmdline that is refreshed incrementally: only pids that
+// appeared since the last refresh are read.
+//
+// Pids can be reused, so nothing is signalled on the strength of the index
+// alone: a match is pinned with a pidfd and its command line read again
+// before it gets SIGTERM, and the SIGKILL escalation goes through that pidfd.
+//
+// Groups that ignore SIGTERM get SIGKILL after a grace period; the deadline is
+// tracked with a timerfd on the event loop, so nothing ever sleeps.
+// terminateSession() may be called from any thread; it reads /proc, so the
+// "close" commands run it on a worker.
+class ProcessControl {
+public:
+    ProcessControl(ProcessLauncher& launcher);
+    ~ProcessControl();
+
+    // Creates the escalation timer and registers it with the event loop
+    bool attach(TcpServer& server);
+
+    // Sends SIGTERM to every process group of "session" that we launched. If we
+    // launched none, signals the processes whose command line contains
+    // "cmdlinePattern" instead (skipped when the pattern is empty).
+    // Returns the number of processes / groups signalled.
+    int terminateSession(const std::string& session, const std::string& cmdlinePattern);
+
+    // Pids whose command line contains "pattern" (uses the cached /proc index)
+    std::vector<pid_t> findByCmdline(const std::string& pattern);
+
+private:
+    ProcessLauncher& launcher;
+    int timer_fd;
+
+    // Guards procIndex, indexTimeMs and pendingKills
+    std::mutex lock;
+
+    // /proc index: pid -> command line (arguments joined with spaces)
+    std::unordered_map<pid_t, std::string> procIndex;
+    int64_t indexTimeMs;
+
+    // Targets waiting for SIGKILL escalation: negative = process group. The
+    // pidfd pins the process (the group leader), -1 if it could not be taken.
+    struct PendingKill {
+        pid_t target;
+        int pidfd;
+        std::string pattern;    // pid targets without pidfd: checked again before SIGKILL
+        int64_t deadlineMs;
+    };
+    std::vector<PendingKill> pendingKills;
+
+    void refreshIndex();
+    void scheduleKill(pid_t target, int pidfd, const std::string& pattern);
+    void armTimer();
+    void onTimer();
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef PROCESSLAUNCHER_HPP
+#define PROCESSLAUNCHER_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <functional>
+#include <mutex>
+#include <sys/types.h>
+#include "TCPServer.hpp"
+
+// ProcessLauncher starts external programs (browsers, tools) without fork()ing
+// the server and reaps them when they exit.
+//
+// Children are created with posix_spawnp(), which glibc implements with
+// clone(CLONE_VM | CLONE_VFORK): the server's memory is never copied, so the
+// cost does not grow with the number of sockets and buffers we hold.
+// SIGCHLD is received through a signalfd watched by the TcpServer event loop,
+// so exited children are reaped immediately and never become zombies.
+// Children started by other means (system() on a worker) are left to their owner.
+//
+// Every child belongs to a named session ("facebook", "youtube", ...) and is
+// started in its own process group.
+//
+// launch(), pidsOf() and sessionOf() may be called from any reactor thread;
+// the child tables are guarded by a mutex.
+class ProcessLauncher {
+public:
+    // Called on the event loop thread after a child was reaped
+    typedef std::function<void(pid_t pid, const std::string& session, int status)> ExitHandler;
+
+    ProcessLauncher();
+    ~ProcessLauncher();
+
+    // Blocks SIGCHLD and starts watching it through the server's event loop.
+    // Must be called before any other thread is created.
+    bool attach(TcpServer& server);
+
+    // Starts argv[0] (searched in PATH) with the given arguments.
+    // Returns the child pid, or -1 on failure.
+    pid_t launch(const std::string& session, const std::vector<std::string>& argv);
+
+    // Pids of the still running children of a session
+    std::set<pid_t> pidsOf(const std::string& session) const;
+
+    // Session a running child belongs to ("" if unknown)
+    std::string sessionOf(pid_t pid) const;
+
+    void setExitHandler(const ExitHandler& handler);
+
+    // Dry run (mock handlers): launch() only logs and returns 0, nothing is started
+    void setDryRun(bool enabled) { dryRun = enabled; }
+    bool isDryRun() const { return dryRun; }
+
+private:
+    int signal_fd;
+    bool dryRun;
+    mutable std::mutex lock;                          // guards children and sessions
+    std::map<pid_t, std::string> children;            // pid -> session
+    std::map<std::string, std::set<pid_t> > sessions; // session -> pids
+    ExitHandler onExit;
+
+    void reapChildren();
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef REACTORGROUP_HPP
+#define REACTORGROUP_HPP
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "TCPServer.hpp"
+
+// ReactorGroup runs several TcpServer event loops ("shards") on the same port.
+//
+// Every shard has its own SO_REUSEPORT listening socket, epoll instance and
+// connections, and runs on its own thread. The kernel spreads new connections
+// over the listening sockets, so a connection lives on one shard for its whole
+// life and shards never share connection state. Accepting, reading, parsing
+// and dispatching therefore scale with the number of cores.
+//
+// Shard 0 runs on the thread that calls run(); it also hosts the descriptors
+// that exist once per process (signalfd, timers, metrics endpoint).
+class ReactorGroup {
+public:
+    // threads = number of shards; 0 = one per online CPU
+    ReactorGroup(int port, int threads);
+
+    // Pins shard i to CPU i (modulo the CPUs the process may use). Call before run().
+    void setPinning(bool enabled) { pinning = enabled; }
+
+    // Sets up every shard's socket and event loop. Listening sockets handed
+    // over by a previous server process are used for the first shards
+    // ("inherited" is consumed: surplus ones are closed).
+    bool start(const std::vector<int>& inherited = std::vector<int>());
+
+    // Listening socket of every shard, as set up by start(), for handing them
+    // to the next process (before drain(), which closes them). Safe to call
+    // from any shard's thread.
+    std::vector<int> listenFds() const;
+
+    size_t size() const { return shards.size(); }
+    TcpServer& shard(size_t index) { return *shards[index]; }
+
+    // Runs all shards and returns once every one of them has stopped
+    void run();
+
+    // Asks every shard to stop. Safe to call from any thread.
+    void stop();
+
+    // Graceful stop of every shard (see TcpServer::drain()); run() returns
+    // once the last one is done. Safe to call from any thread.
+    void drain(int timeoutMs);
+
+private:
+    std::vector<std::unique_ptr<TcpServer> > shards;
+    std::vector<std::thread> threads;
+    std::vector<int> listeners;     // written by start() before the shards run
+    bool pinning;
+    std::atomic<bool> draining;
+
+    void pinCurrentThread(size_t index);
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef RINGBUFFER_HPP
+#define RINGBUFFER_HPP
+
+#include <cstddef>
+#include <memory>
+
+// RingBuffer is a growable byte ring used as the receive buffer of one connection.
+// The socket reads straight into writableSpan(), and complete frames are handed
+// out as pointers into the ring, so no bytes are copied on the normal path.
+// Capacity is always a power of two so wrapping is a single mask operation.
+class RingBuffer {
+public:
+    // Constructor to allocate the ring with an initial and a maximum capacity (bytes)
+    RingBuffer(size_t initialCapacity = 1024, size_t maxCapacity = 1024 * 1024);
+
+    RingBuffer(RingBuffer&& other) noexcept;
+    RingBuffer& operator=(RingBuffer&& other) noexcept;
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    // Number of buffered bytes / free bytes / allocated bytes
+    size_t size() const { return tail - head; }
+    size_t freeSpace() const { return capacity - size(); }
+    size_t allocated() const { return capacity; }
+
+    // Largest contiguous free region after the buffered bytes.
+    // Grows the ring first when it is full; returns 0 once maxCapacity is reached.
+    size_t writableSpan(char** out);
+
+    // Marks "n" bytes written into the span returned by writableSpan() as buffered
+    void commit(size_t n) { tail += n; }
+
+    // Drops "n" bytes from the front of the ring
+    void consume(size_t n);
+
+    // Byte at "offset" from the front (offset < size())
+    char at(size_t offset) const { return data[(head + offset) & (capacity - 1)]; }
+
+    // Offset of the first "c" at or after "from", or npos
+    size_t find(char c, size_t from) const;
+
+    // Pointer to "len" contiguous bytes starting at "offset".
+    // Only when the range wraps around the end is the ring rotated (one memmove).
+    const char* contiguous(size_t offset, size_t len);
+
+    static const size_t npos = static_cast<size_t>(-1);
+
+private:
+    std::unique_ptr<char[]> data;
+    size_t capacity;
+    size_t maxCapacity;
+
+    // Monotonic read / write positions; the index in "data" is pos & (capacity - 1)
+    size_t head;
+    size_t tail;
+
+    bool grow();
+    void linearize();
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef SCREENSTREAMER_HPP
+#define SCREENSTREAMER_HPP
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include "TCPServer.hpp"
+#include "ThreadPool.hpp"
+#include "FrameSource.hpp"
+
+class CommandDispatcher;
+
+// ScreenStreamer sends a live view of the screen to clients that ran "stream".
+//
+// Every streaming client has a session with its own timerfd on the client's
+// reactor. On each tick a worker captures the screen, compares it with the
+// previous frame in 64x64 tiles (SSE2 compare of the tile rows, stopping at
+// the first difference) and encodes only the tiles that changed. Nothing is
+// sent while the screen does not change, so bandwidth and encoding time follow
+// the changed area, not the resolution. The first frame (and any size change)
+// is a key frame holding every tile.
+//
+// Frames go out as reply attachments through the client's dispatcher:
+//
+//   text  : "Frame: <seq> <width>x<height>, <tiles> tiles, <deflate|raw> <bytes> bytes\n"
+//           followed by the payload
+//   binary: STATUS_MORE frames on the id of the "stream" request; "stream stop"
+//           ends them with a STATUS_OK frame
+//
+//   payload (deflated when zlib is available): one record per changed tile,
+//     uint16 x | uint16 y | uint16 width | uint16 height   (pixels, big-endian)
+//     width * height * 3 bytes RGB, rows top to bottom
+//
+// Frame rate adapts to the client: a tick is skipped while the previous frame
+// is still being encoded or sent, and the interval doubles when the client's
+// outbox backs up, then shrinks back to the requested rate once it drains.
+//
+// start() / stop() / onDisconnect() are called on the client's reactor thread.
+class ScreenStreamer {
+public:
+    ScreenStreamer(FrameSource& source, ThreadPool& pool);
+    ~ScreenStreamer();
+
+    // The dispatcher that sends frames to the clients of "server"
+    void addShard(TcpServer& server, CommandDispatcher& dispatcher);
+
+    // Starts streaming to a client, or changes the rate / size of its stream
+    // (frames keep the id of the request that started it). maxWidth 0 = full
+    // size. Returns false if no timer could be set up.
+    bool start(TcpServer& server, TcpServer::ConnectionId client, bool binary, uint64_t requestId,
+               int fps, int maxWidth);
+
+    // Whether a client is streaming
+    bool active(TcpServer& server, TcpServer::ConnectionId client);
+
+    // Ends a client's stream; false if it had none
+    bool stop(TcpServer& server, TcpServer::ConnectionId client);
+
+    void onDisconnect(TcpServer& server, TcpServer::ConnectionId client);
+
+    // Ends every stream of one reactor's clients (shutdown)
+    void stopAll(TcpServer& server);
+
+    // Highest accepted frame rate
+    static const int MAX_FPS = 60;
+
+    // Longest interval the backpressure adaptation goes to
+    static const int MAX_INTERVAL_MS = 2000;
+
+private:
+    struct Session;
+    typedef std::pair<TcpServer*, TcpServer::ConnectionId> Key;
+
+    FrameSource& source;
+    ThreadPool& pool;
+
+    std::mutex lock;                                    // guards the maps (several reactors)
+    std::map<TcpServer*, CommandDispatcher*> dispatchers;
+    std::map<Key, std::shared_ptr<Session> > sessions;
+
+    void onTick(const std::shared_ptr<Session>& session);
+    void onFrame(const std::shared_ptr<Session>& session, const std::shared_ptr<std::string>& payload,
+                 const std::string& header);
+    void remove(const std::shared_ptr<Session>& session);
+    static void setInterval(Session& session, int intervalMs);
+    static int encodeChanges(FrameSource& source, Session& session, int maxWidth, std::string& payload);
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef SCREENSHOTSERVICE_HPP
+#define SCREENSHOTSERVICE_HPP
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "FrameSource.hpp"
+
+// ScreenshotService captures and encodes screenshots for the "screenshot"
+// command (on worker threads).
+//
+// Captures are single-flight: one capture runs at a time, and a request that
+// arrives within the cache time of the last capture with the same size gets
+// that image again instead of a new capture, so a client polling in a tight
+// loop cannot keep the X server and a CPU busy.
+//
+// Frame and image buffers come from a small pool and go back to it when the
+// last reference is dropped (after the image was sent), so steady use
+// allocates nothing.
+class ScreenshotService {
+public:
+    // One encoded image; the bytes stay valid while the Shot is referenced
+    struct Shot {
+        std::shared_ptr<const std::string> data;
+        int width = 0;
+        int height = 0;
+        const char* format = "";     // "png" or "ppm"
+        bool cached = false;         // served from the cache
+    };
+
+    ScreenshotService(std::unique_ptr<FrameSource> source);
+
+    const char* sourceName() const { return source->name(); }
+
+    // The capture source, shared with the screen streamer
+    FrameSource& frameSource() { return *source; }
+
+    // Images newer than this are reused (0 = always capture)
+    void setCacheTime(int milliseconds);
+
+    // Captures the screen, downscaled to at most "maxWidth" pixels (0 = full
+    // size), and encodes it. Returns false if capture or encoding failed.
+    bool take(int maxWidth, Shot& shot);
+
+private:
+    // Free buffers, shared with the buffer deleters so late releases are safe
+    struct BufferPool {
+        std::mutex lock;
+        std::vector<std::string*> images;
+
+        ~BufferPool() {
+            for (size_t i = 0; i < images.size(); ++i) delete images[i];
+        }
+    };
+
+    std::unique_ptr<FrameSource> source;
+    std::shared_ptr<BufferPool> pool;
+
+    std::mutex captureLock;          // single flight; guards everything below
+    Frame captured;
+    Frame scaled;
+    Shot last;
+    int lastMaxWidth;
+    int64_t lastCaptureMs;
+    int cacheMs;
+
+    std::shared_ptr<std::string> acquireBuffer();
+
+    // Buffers kept for reuse at most
+    static const size_t POOL_SIZE = 4;
+};
+
+#endif
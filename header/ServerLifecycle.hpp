@@ -0,0 +1,65 @@
+#ifndef SERVERLIFECYCLE_HPP
+#define SERVERLIFECYCLE_HPP
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include "TCPServer.hpp"
+#include "ReactorGroup.hpp"
+
+// ServerLifecycle ends the server gracefully and hands its listening sockets
+// to a replacement process.
+//
+// Shutdown (SIGTERM, SIGINT or the "exit" command) drains every reactor:
+// the listening sockets are closed, connected clients keep being served
+// until the running commands finished and their replies were written (at
+// most the drain timeout), then the event loops return.
+//
+// Restart without refused connections: with a handoff socket configured,
+// the running server listens on that Unix socket. A new server process
+// started with the same setting connects to it first and receives the
+// listening sockets over SCM_RIGHTS, so the port never stops accepting:
+// connections waiting in the accept queue are simply accepted by the new
+// process. The old process then drains and exits.
+//
+//   tcp_server --config=pcctl.conf &      (handoff_socket = /run/pcctl.sock)
+//   ...install the new binary...
+//   tcp_server --config=pcctl.conf &      (takes over, the old one exits)
+class ServerLifecycle {
+public:
+    ServerLifecycle(ReactorGroup& reactors);
+    ~ServerLifecycle();
+
+    // Time the reactors get to finish their clients' work on shutdown
+    void setDrainTimeout(int seconds);
+
+    // Routes SIGTERM / SIGINT into "loop" and, if "handoffPath" is not
+    // empty, listens there for a replacement process. The signals must be
+    // blocked in every thread (done at the top of main()).
+    bool attach(TcpServer& loop, const std::string& handoffPath);
+
+    // Starts the graceful shutdown. Safe to call from any thread; only the
+    // first call counts.
+    void shutdown(const char* reason);
+
+    // Asks the server running at "handoffPath" for its listening sockets.
+    // Returns false (and no descriptors) if no server answers there.
+    static bool inherit(const std::string& handoffPath, std::vector<int>& fds);
+
+private:
+    ReactorGroup& reactors;
+    std::string handoffPath;
+    int signal_fd;
+    int handoff_fd;
+    bool handedOff;                  // the socket file belongs to the new process now
+    std::atomic<int> drainSeconds;
+    std::atomic<bool> stopping;
+
+    void onSignal();
+    void onHandoff();
+
+    // Most listening sockets passed in one message
+    static const int MAX_HANDOFF_FDS = 64;
+};
+
+#endif
@@ -2,49 +2,349 @@
 #define TCPSERVER_HPP
 
 #include <string>
+#include <string_view>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <sys/socket.h>
 #include <netinet/in.h>
+#include "RingBuffer.hpp"
+#include "FrameParser.hpp"
+#include "OutboundQueue.hpp"
+#include "TimerWheel.hpp"
+#include "IoUring.hpp"
+#include "TrafficCapture.hpp"
 
-// TcpServer class defines the server-side functionality for a TCP connection
+// TcpServer class defines the server-side functionality for a TCP connection.
+// It runs an edge-triggered epoll event loop, so any number of clients can be
+// connected at the same time and one slow client never blocks the others.
+//
+// With the io_uring backend the client sockets leave epoll: one multishot
+// accept and one multishot recv per client stay armed in an io_uring, the
+// kernel picks receive buffers from a shared ring, and the sends queued in
+// one loop iteration go out with a single io_uring_enter(). epoll still
+// drives timers, signals and the other watched descriptors, and wakes the
+// loop when the ring has completions. Kernels before 6.0 fall back to epoll.
 class TcpServer {
 public:
-    // Constructor to initialize server with a specified port
-    TcpServer(int port);
+    // How client sockets are read and written
+    enum IoBackend { IO_EPOLL, IO_URING };
+
+    // Identifies one accepted connection. The low 32 bits hold the socket fd,
+    // the high 32 bits a generation counter so a reused fd gets a new id.
+    typedef uint64_t ConnectionId;
+
+    // Called on the event loop thread for every complete frame a client sends.
+    // The view points into the connection's receive buffer and is only valid
+    // during the call; copy it if it must outlive the handler.
+    typedef std::function<void(ConnectionId, std::string_view)> MessageHandler;
+
+    // Called on the event loop thread when a client connects / disconnects
+    typedef std::function<void(ConnectionId)> ConnectionHandler;
+
+    // Called on the event loop thread when a watched descriptor is ready
+    typedef std::function<void(uint32_t events)> FdHandler;
+
+    // Constructor to initialize server with a specified port and listen backlog
+    TcpServer(int port, int backlog = SOMAXCONN);
 
     // Destructor to clean up any open resources (like sockets)
     ~TcpServer();
 
-    // Public method to start the server, including setup and client connection
+    // Public method to set up the listening socket and the epoll instance
     bool start();
 
-    // Method to send data to the client
-    bool sendData(const std::string& data);
+    // Selects the I/O backend; call before start(). IO_URING falls back to
+    // IO_EPOLL (logged) where the kernel cannot run it.
+    void setIoBackend(IoBackend backend);
+    IoBackend ioBackend() const { return ring.active() ? IO_URING : IO_EPOLL; }
+
+    // Uses an already listening socket (inherited from the previous server
+    // process) instead of creating one in start(). Call before start(); false
+    // if "fd" is not a socket listening on this server's port.
+    bool adoptListener(int fd);
+
+    // Listening socket (-1 before start() and after draining began)
+    int listenFd() const { return server_fd; }
+
+    // Runs the event loop until stop() is called
+    void run();
+
+    // Asks the event loop to return after the current iteration
+    void stop();
+
+    // Graceful stop: closes the listening socket at once, keeps serving the
+    // connected clients, and stops the loop once the drain handler reports
+    // nothing in progress and every reply was written, or after "timeoutMs".
+    // Event loop thread only.
+    void drain(int timeoutMs);
+
+    // Register the callbacks invoked by the event loop
+    void setMessageHandler(const MessageHandler& handler);
+    void setConnectHandler(const ConnectionHandler& handler);
+    void setDisconnectHandler(const ConnectionHandler& handler);
+
+    // Called after all frames that arrived in one read were passed to the
+    // message handler, so it can execute / reply to them as one batch
+    void setBatchEndHandler(const ConnectionHandler& handler);
+
+    // Called while draining (a few times per second): returns true once the
+    // application has no work in progress left for this loop's clients
+    void setDrainHandler(const std::function<bool()>& handler);
+
+    // Adds any other descriptor (signalfd, timerfd, pipe, ...) to the event loop.
+    // "events" are epoll flags such as EPOLLIN; the descriptor should be non-blocking.
+    bool watchFd(int fd, uint32_t events, const FdHandler& handler);
+    void unwatchFd(int fd);
+
+    // Runs "task" on the event loop thread. Safe to call from any thread;
+    // this is how worker threads hand results back (e.g. to call sendData()).
+    void post(std::function<void()> task);
+
+    // Framing of one connection (newline-delimited until a command switches it). Switching it from the message handler applies
+    // to the bytes after the current frame (protocol negotiation).
+    bool setFraming(ConnectionId client, FrameParser::Mode mode);
+    FrameParser::Mode framing(ConnectionId client) const;
+
+    // Method to send data to a client (queued if the socket is not writable yet).
+    // Returns false if the client is gone or had to be dropped for not reading.
+    bool sendData(ConnectionId client, std::string_view data);
+
+    // Per-client limit of queued outgoing bytes. Above it the server stops
+    // reading from that client until half of it has been written; a client
+    // whose queue reaches 4x the limit is disconnected. Default 256 KiB.
+    void setOutboxLimit(size_t highWater);
+
+    size_t outboxLimit() const { return outboxHighWater; }
+
+    // Closes clients that neither sent nor received anything for "seconds"
+    // (0 = never). Checked once a second with a timer wheel. Default off.
+    void setIdleTimeout(int seconds);
+
+    // Socket options for connections accepted from now on: TCP_NODELAY (send
+    // small replies at once instead of waiting for the previous ACK) and TCP
+    // keepalive probes after "idleSeconds" of silence (0 = off), which detect
+    // peers that vanished without closing (phone out of Wi-Fi range).
+    void setNoDelay(bool enabled);
+    void setKeepAlive(int idleSeconds);
+
+    // Records what clients send into "capture", which may be shared by
+    // several servers. Call before run().
+    void setCapture(TrafficCapture* capture);
+
+    // Outgoing bytes queued for a client (0 if unknown)
+    size_t pendingBytes(ConnectionId client) const;
+
+    // Bytes the kernel holds for a client: written but not yet acknowledged
+    // by the peer (0 if unknown). With pendingBytes() this is how far the
+    // client is behind; the kernel buffer alone can hold megabytes.
+    size_t unackedBytes(ConnectionId client) const;
+
+    // Calls "callback" once on the event loop thread when the client's queued
+    // bytes have dropped to half the outbox limit, so a large reply can be
+    // sent in chunks without hitting the limit. Only one callback per client
+    // is kept; it is discarded if the client disconnects first.
+    bool notifyWhenDrained(ConnectionId client, std::function<void()> callback);
+
+    // Method to close one client connection
+    void closeConnection(ConnectionId client);
+
+    // True while the connection is open
+    bool isConnected(ConnectionId client) const;
+
+    // Number of currently connected clients
+    size_t connectionCount() const;
 
-    // Method to receive data from the client
-    std::string receiveData();
+    // Peer address of a connected client as "ip:port" (empty if unknown)
+    std::string peerName(ConnectionId client) const;
+
+    // True if the client connected from this machine (127.0.0.0/8)
+    bool isLoopback(ConnectionId client) const;
 
 private:
-    // File descriptors for server and client
+    // io_uring send in flight for one connection; the iovecs point into its
+    // outbox chunks, which stay queued until the completion says what was sent
+    struct UringSend {
+        struct msghdr msg;
+        struct iovec iov[OutboundQueue::MAX_IOV];
+        size_t bytes;
+    };
+
+    // Outbox of a closed connection whose send is still in flight: the kernel
+    // may read the chunks until the completion arrives
+    struct RetiredSend {
+        OutboundQueue outbox;
+        std::unique_ptr<UringSend> send;
+    };
+
+    // Per-connection state kept by the event loop
+    struct Connection {
+        int fd;
+        ConnectionId id;
+        struct sockaddr_in peer;
+        RingBuffer inbox;       // received bytes not yet consumed by the parser
+        FrameParser parser;     // splits inbox into frames
+        OutboundQueue outbox;   // bytes accepted by sendData() but not written yet
+        bool wantWrite;         // EPOLLOUT currently requested
+        bool readPaused;        // EPOLLIN dropped because outbox is above the high-water mark
+        bool closing;           // close requested while its frames were being dispatched
+        int64_t lastActiveMs;   // loop time of the last byte read or written
+        std::function<void()> onDrained;  // notifyWhenDrained() callback
+        bool recvArmed;         // io_uring: multishot recv active (or its cancel pending)
+        bool sendQueued;        // io_uring: in sendQueue, submitted at the end of the iteration
+        std::unique_ptr<UringSend> send;  // io_uring: send in flight
+        uint64_t captureStream;  // stream number in the capture file, 0 = not recorded
+        bool readQueued;        // used up its read turn, in readAgain
+    };
+
+    // File descriptors for the listening socket, the epoll instance, the post()
+    // wakeup eventfd and the idle check timerfd
     int server_fd;
-    int client_fd;
+    int epoll_fd;
+    int wake_fd;
+    int idle_fd;
+    int drain_fd;
+
+    // drain() was called; the loop stops at drainDeadlineMs at the latest
+    bool draining;
+    int64_t drainDeadlineMs;
 
     // Port number for the server to listen on
     int port;
 
+    // Maximum number of pending connections queued by the kernel
+    int backlog;
+
     // Address structure to store server address info
     struct sockaddr_in address;
 
-    // Size of the address structure
-    int addrlen;
+    // Loop control flag
+    bool running;
+
+    // Generation counter mixed into ConnectionId
+    uint32_t generation;
+
+    // Chunks shared by all outboxes (declared before connections: destroyed after them)
+    BufferPool sendPool;
+
+    // Outbox high-water mark in bytes
+    size_t outboxHighWater;
+
+    // Idle timeout (0 = off) and the wheel holding one timer per connection
+    int64_t idleTimeoutMs;
+    TimerWheel idleTimers;
+
+    // Options applied to accepted sockets
+    bool noDelay;
+    int keepAliveSeconds;
+
+    // Records the received bytes when set
+    TrafficCapture* capture;
+
+    // Monotonic time in ms, read once per event loop iteration
+    int64_t loopTimeMs;
+
+    // Connected clients keyed by socket fd
+    std::unordered_map<int, Connection> connections;
 
-    // Buffer size for receiving data
-    static const int BUFFER_SIZE = 1024;
-    char buffer[BUFFER_SIZE];
+    // Clients with unread data left after their read turn; read again once
+    // every other ready descriptor was handled
+    std::vector<ConnectionId> readAgain;
+
+    // Tasks handed over by post(), guarded by postedLock
+    std::mutex postedLock;
+    std::vector<std::function<void()> > posted;
+
+    // io_uring backend (inactive with epoll), the connections with bytes to
+    // submit this iteration and the sends of closed connections still in flight
+    IoUring ring;
+    bool useRing;
+    bool acceptArmed;
+    std::vector<ConnectionId> sendQueue;
+    std::unordered_map<uint64_t, RetiredSend> retiredSends;
+
+    // Extra descriptors added with watchFd()
+    std::unordered_map<int, FdHandler> watchers;
+
+    MessageHandler onMessage;
+    ConnectionHandler onConnect;
+    ConnectionHandler onDisconnect;
+    ConnectionHandler onBatchEnd;
+    std::function<bool()> onDrain;
+
+    // Framing mode given to new connections
+
+    // Socket whose frames are being dispatched right now (-1 if none)
+    int dispatchingFd;
+
+    // Initial / maximum receive buffer size per connection
+    static const size_t INBOX_INITIAL = 1024;
+    static const size_t INBOX_MAX = 1024 * 1024;
+
+    // Maximum number of events handled per epoll_wait() call
+    static const int MAX_EVENTS = 64;
+
+    // Bytes read from one client before the others get their turn (a few
+    // hundred commands: a flooding client delays the others by well under 1 ms)
+    static const size_t READ_TURN = 4 * 1024;
+
+    // io_uring queue depth and provided receive buffers (count x size, one
+    // group). All buffers together stay below INBOX_MAX: that is the most a
+    // paused client's recv can deliver before its cancel lands.
+    static const unsigned URING_ENTRIES = 256;
+    static const unsigned URING_BUFFERS = 128;
+    static const unsigned URING_BUFFER_SIZE = 4096;
+    static const uint16_t URING_BUFFER_GROUP = 0;
+
+    // How often a draining loop checks whether it is done
+    static const int DRAIN_CHECK_MS = 50;
+
+    // Idle check period and wheel size (one turn = 512 s, so typical timeouts
+    // are found on their first visit), and unanswered keepalive probes before
+    // a peer counts as gone
+    static const int IDLE_TICK_MS = 1000;
+    static const size_t IDLE_WHEEL_SLOTS = 512;
+    static const int KEEPALIVE_PROBES = 3;
 
     // Private helper methods for setting up the server
     bool setupSocket();
     bool bindSocket();
     bool listenSocket();
-    bool acceptClient();
+    bool setupEpoll();
+
+    // Private helper methods used by the event loop
+    void acceptClients();
+    bool addConnection(int fd, const struct sockaddr_in& peer, uint64_t started);
+    void afterWrite(int fd);
+    void handleReadable(Connection& conn);
+    void resumeReads();
+    bool dispatchFrames(Connection& conn);
+    bool flushOutbox(Connection& conn);
+    void updateInterest(Connection& conn, bool wantWrite, bool readPaused);
+    void dropConnection(int fd);
+    void runPosted();
+    void configureSocket(int fd);
+    void armIdleTimer();
+    void closeIdleClients();
+    void checkDrained();
+    Connection* findConnection(ConnectionId client);
+    const Connection* findConnection(ConnectionId client) const;
+
+    // io_uring backend
+    bool setupRing();
+    void armAccept();
+    void armRecv(Connection& conn);
+    void cancelRing(uint64_t userData);
+    void queueSend(Connection& conn);
+    void submitRing();
+    void reapRing();
+    void onAccepted(const struct io_uring_cqe& cqe);
+    void onReceived(const struct io_uring_cqe& cqe);
+    void onSent(const struct io_uring_cqe& cqe);
+    Connection* ringConnection(uint64_t userData);
 };
 
 #endif
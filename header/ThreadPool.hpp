@@ -0,0 +1,65 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ThreadPool runs slow command handlers away from the event loop thread.
+//
+// Every worker owns a deque. submit() spreads jobs over the deques round-robin.
+// A worker takes jobs from the front of its own deque and, when it runs dry,
+// steals from the back of the others, so one long job never leaves queued work
+// stranded behind it. The total number of queued jobs is bounded: submit()
+// refuses work instead of letting the queues grow without limit.
+class ThreadPool {
+public:
+    typedef std::function<void()> Job;
+
+    // Constructor to start "threads" workers accepting at most "maxQueued" waiting jobs
+    ThreadPool(size_t threads, size_t maxQueued);
+
+    // Finishes the queued jobs, then joins the workers
+    ~ThreadPool();
+
+    // Drops the queued jobs, waits for the running ones and joins the workers
+    // (the destructor then has nothing left to do)
+    void shutdown();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queues a job. Returns false (and drops the job) when the queue is full.
+    bool submit(Job job);
+
+    // Jobs waiting for a worker, and how many may wait at most
+    size_t queuedJobs() const { return queued.load(std::memory_order_relaxed); }
+    size_t queueLimit() const { return maxQueued; }
+
+private:
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue> > queues;
+    std::vector<std::thread> workers;
+    size_t maxQueued;
+    std::atomic<size_t> nextQueue;   // submit() may be called from several reactor threads
+
+    std::atomic<size_t> queued;
+
+    std::mutex sleepLock;
+    std::condition_variable wakeup;
+    bool stopping;
+
+    void workerLoop(size_t index);
+    bool take(size_t index, Job& job);
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef TIMERWHEEL_HPP
+#define TIMERWHEEL_HPP
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+
+// TimerWheel is a hashed timing wheel of deadlines, used for the idle
+// timeouts of connections. Used from one thread only.
+//
+// Time is cut into ticks; a deadline is stored in slot (tick % slots), so
+// adding a timer and expiring one tick are O(1) per timer no matter how many
+// are pending. A deadline more than one turn of the wheel away simply stays
+// in its slot until the turn it is due in.
+//
+// Timers are never cancelled. The owner keeps the real state (e.g. when the
+// connection was last active) and, when a key comes due, decides whether it
+// really expired or just schedules it again. Activity then costs nothing but
+// a timestamp update.
+class TimerWheel {
+public:
+    // "slots" buckets of "tickMs" milliseconds each
+    TimerWheel(size_t slots = 64, int64_t tickMs = 1000);
+
+    // Adds a timer for "key" that is due at "deadlineMs"
+    void schedule(uint64_t key, int64_t deadlineMs);
+
+    // Moves the wheel to "nowMs" and appends the keys whose deadline passed to "due"
+    void advance(int64_t nowMs, std::vector<uint64_t>& due);
+
+    // Pending timers
+    size_t size() const { return count; }
+
+    void clear();
+
+    int64_t tickMs() const { return tick; }
+
+private:
+    struct Entry {
+        uint64_t key;
+        int64_t deadlineMs;
+    };
+
+    std::vector<std::vector<Entry> > slots;
+    int64_t tick;
+    int64_t currentTick;    // last tick advance() processed (-1 = never)
+    size_t count;
+};
+
+#endif
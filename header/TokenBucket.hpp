@@ -0,0 +1,41 @@
+#ifndef TOKENBUCKET_HPP
+#define TOKENBUCKET_HPP
+
+#include <string>
+#include <stdint.h>
+
+// A rate limit as written in the configuration ("20/s", "10/min", "100/h"):
+// "count" commands per "seconds", refilled evenly, at most "count" at once.
+// count 0 = no limit.
+struct RateLimit {
+    int count = 0;
+    int seconds = 1;
+
+    bool operator==(const RateLimit& other) const { return count == other.count && seconds == other.seconds; }
+    bool operator!=(const RateLimit& other) const { return !(*this == other); }
+};
+
+// TokenBucket enforces one RateLimit: every command takes a token, tokens
+// come back at count / seconds per second. Not thread-safe; the shared
+// buckets are guarded by their owner (CommandDispatcher::RateTable).
+class TokenBucket {
+public:
+    TokenBucket();
+
+    // Sets the limit; the bucket starts full when the limit changes
+    void setLimit(const RateLimit& limit);
+
+    // Takes a token at "nowNs" (Metrics::now()). When none is left returns
+    // false and sets "waitNs" to the time until the next one.
+    bool take(uint64_t nowNs, uint64_t& waitNs);
+
+    // "10/min"-style text of a limit, for replies and logs
+    static std::string describe(const RateLimit& limit);
+
+private:
+    RateLimit limit;
+    double tokens;
+    uint64_t updated;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef TRAFFICCAPTURE_HPP
+#define TRAFFICCAPTURE_HPP
+
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+// TrafficCapture records what clients send to the server, with timestamps,
+// so the traffic can be fed to another build later (tcp_replay, see
+// src/replay.cpp).
+//
+// File format: the 8 bytes MAGIC, then one record after the other,
+// numbers as varints (BinaryProtocol::putVarint):
+//
+//   type byte | microseconds since the previous record | stream number | ...
+//
+//   RECORD_OPEN   a client connected; streams are numbered from 1 in order
+//   RECORD_DATA   ... | length | bytes     bytes the client sent, as read
+//   RECORD_CLOSE  the connection was closed (by either side)
+//
+// Bytes are recorded as they were read, before framing, so a capture holds
+// text, binary-protocol and input connections alike.
+//
+// The recording side may be called from every reactor thread: records are
+// appended to one buffer under a lock and written out in blocks (the last
+// one when the server stops).
+class TrafficCapture {
+public:
+    enum RecordType { RECORD_OPEN = 0, RECORD_DATA = 1, RECORD_CLOSE = 2 };
+
+    // One record of a loaded capture; "data" points into the loaded file
+    struct Record {
+        RecordType type;
+        uint64_t timeUs;     // since the first record
+        uint64_t stream;
+        std::string_view data;
+    };
+
+    static const char MAGIC[8];
+
+    TrafficCapture();
+    ~TrafficCapture();
+
+    TrafficCapture(const TrafficCapture&) = delete;
+    TrafficCapture& operator=(const TrafficCapture&) = delete;
+
+    // Creates (truncates) the capture file. Recording stops once the file
+    // reaches "limitBytes" (0 = no limit). False (with "error") if it cannot
+    // be opened.
+    bool open(const std::string& path, uint64_t limitBytes, std::string& error);
+
+    bool active() const { return fd >= 0; }
+
+    // A client connected: returns its stream number for the calls below
+    uint64_t opened();
+    void received(uint64_t stream, const char* data, size_t size);
+    void closed(uint64_t stream);
+
+    // Writes the buffered records
+    void flush();
+
+    // Reads a whole capture file into "contents" and splits it into records.
+    // False (with "error") if it is not a capture or is cut short.
+    static bool load(const std::string& path, std::string& contents, std::vector<Record>& records,
+                     std::string& error);
+
+private:
+    std::mutex lock;
+    int fd;
+    std::string buffer;
+    uint64_t written;
+    uint64_t limit;
+    uint64_t nextStream;
+    uint64_t lastUs;
+    bool full;
+
+    // Buffered bytes written out at once
+    static const size_t BLOCK = 64 * 1024;
+
+    void append(RecordType type, uint64_t stream);
+    void writeBuffer();
+};
+
+#endif
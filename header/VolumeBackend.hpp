@@ -0,0 +1,48 @@
+#ifndef VOLUMEBACKEND_HPP
+#define VOLUMEBACKEND_HPP
+
+#include <memory>
+#include <string>
+#include "ProcessLauncher.hpp"
+
+// VolumeBackend controls the master playback volume.
+//
+// Implementations:
+//   "alsa"    : talks to the ALSA mixer directly; the mixer handle stays open,
+//               so a change is a single ioctl (built when ALSA is available)
+//   "xdotool" : emulates the media keys (relative steps only)
+//   "mock"    : keeps the level in memory, for headless machines and benchmarks
+//
+// The backends returned by createVolumeBackend() may be used from several
+// reactor threads at once.
+class VolumeBackend {
+public:
+    virtual ~VolumeBackend() {}
+
+    virtual const char* name() const = 0;
+
+    // Changes the volume by "percent" points (may be negative)
+    virtual bool adjust(int percent) = 0;
+
+    // Sets the volume to 0..100 percent
+    virtual bool set(int percent) = 0;
+
+    // Current volume in percent, or -1 if the backend cannot tell
+    virtual int get() = 0;
+
+    virtual bool setMuted(bool muted) = 0;
+
+    // 1 = muted, 0 = not muted, -1 = unknown
+    virtual int muted() = 0;
+};
+
+// Creates the backend called "kind" ("alsa", "xdotool", "mock" or "" for the
+// best available one). Returns NULL if it cannot be opened.
+std::unique_ptr<VolumeBackend> createVolumeBackend(const std::string& kind, ProcessLauncher& launcher);
+
+#ifdef HAVE_ALSA
+// Defined in AlsaVolumeBackend.cpp
+std::unique_ptr<VolumeBackend> createAlsaVolumeBackend();
+#endif
+
+#endif
@@ -0,0 +1,89 @@
+#include "../header/VolumeBackend.hpp"
+#include "../header/Logger.hpp"
+#include <alsa/asoundlib.h>
+
+// Controls the "Master" element of the default ALSA mixer.
+/*
+    The mixer is opened once in the constructor and kept open, so a volume change
+    is a single snd_mixer_selem_set_playback_volume_all() call (one ioctl on the
+    control device) instead of a process spawn per step.
+
+    snd_mixer_handle_events() is called before reading so changes made by other
+    programs (desktop volume applet, keyboard) are seen.
+*/
+class AlsaVolumeBackend : public VolumeBackend {
+public:
+    AlsaVolumeBackend() : mixer(NULL), element(NULL), minVolume(0), maxVolume(0) {}
+
+    ~AlsaVolumeBackend() {
+        if (mixer != NULL) snd_mixer_close(mixer);
+    }
+
+    bool open(const char* card, const char* control) {
+        if (snd_mixer_open(&mixer, 0) < 0) return false;
+        if (snd_mixer_attach(mixer, card) < 0) return false;
+        if (snd_mixer_selem_register(mixer, NULL, NULL) < 0) return false;
+        if (snd_mixer_load(mixer) < 0) return false;
+
+        snd_mixer_selem_id_t* sid;
+        snd_mixer_selem_id_alloca(&sid);
+        snd_mixer_selem_id_set_index(sid, 0);
+        snd_mixer_selem_id_set_name(sid, control);
+        element = snd_mixer_find_selem(mixer, sid);
+        if (element == NULL) return false;
+
+        snd_mixer_selem_get_playback_volume_range(element, &minVolume, &maxVolume);
+        return maxVolume > minVolume;
+    }
+
+    const char* name() const { return "alsa"; }
+
+    bool adjust(int percent) {
+        int current = get();
+        if (current < 0) return false;
+        return set(current + percent);
+    }
+
+    bool set(int percent) {
+        if (percent < 0) percent = 0;
+        if (percent > 100) percent = 100;
+        long value = minVolume + (maxVolume - minVolume) * percent / 100;
+        return snd_mixer_selem_set_playback_volume_all(element, value) == 0;
+    }
+
+    int get() {
+        snd_mixer_handle_events(mixer);
+        long value = 0;
+        if (snd_mixer_selem_get_playback_volume(element, SND_MIXER_SCHN_FRONT_LEFT, &value) < 0) return -1;
+        return static_cast<int>(((value - minVolume) * 100 + (maxVolume - minVolume) / 2) / (maxVolume - minVolume));
+    }
+
+    bool setMuted(bool muted) {
+        if (!snd_mixer_selem_has_playback_switch(element)) return false;
+        // The playback switch is "on" when sound plays, so mute = switch off
+        return snd_mixer_selem_set_playback_switch_all(element, muted ? 0 : 1) == 0;
+    }
+
+    int muted() {
+        if (!snd_mixer_selem_has_playback_switch(element)) return -1;
+        snd_mixer_handle_events(mixer);
+        int on = 1;
+        if (snd_mixer_selem_get_playback_switch(element, SND_MIXER_SCHN_FRONT_LEFT, &on) < 0) return -1;
+        return on ? 0 : 1;
+    }
+
+private:
+    snd_mixer_t* mixer;
+    snd_mixer_elem_t* element;
+    long minVolume;
+    long maxVolume;
+};
+
+std::unique_ptr<VolumeBackend> createAlsaVolumeBackend() {
+    std::unique_ptr<AlsaVolumeBackend> backend(new AlsaVolumeBackend());
+    if (!backend->open("default", "Master")) {
+        LOG_WARN("Could not open the ALSA \"Master\" mixer control.");
+        return std::unique_ptr<VolumeBackend>();
+    }
+    return std::unique_ptr<VolumeBackend>(backend.release());
+}
@@ -0,0 +1,124 @@
+#include "../header/AppRegistry.hpp"
+#include <cstdio>
+#include <sys/wait.h>
+#include <time.h>
+
+static const char* STATUS_NAMES[] = { "stopped", "starting", "running", "closing" };
+
+int64_t AppRegistry::nowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+void AppRegistry::add(const std::string& name, const std::string& title, const std::string& profileDir) {
+    std::lock_guard<std::mutex> guard(lock);
+    AppState* known = find(name);
+    if (known != NULL) {
+        known->title = title;
+        known->profileDir = profileDir;
+        return;
+    }
+    AppState state;
+    state.name = name;
+    state.title = title;
+    state.profileDir = profileDir;
+    apps.push_back(state);
+}
+
+void AppRegistry::retainOnly(const std::set<std::string>& names) {
+    std::lock_guard<std::mutex> guard(lock);
+    size_t kept = 0;
+    for (size_t i = 0; i < apps.size(); ++i) {
+        if (apps[i].status != APP_STOPPED || names.count(apps[i].name) > 0) apps[kept++] = apps[i];
+    }
+    apps.resize(kept);
+}
+
+bool AppRegistry::beginOpen(const std::string& name, AppState& current) {
+    std::lock_guard<std::mutex> guard(lock);
+    AppState* app = find(name);
+    if (app == NULL) {
+        apps.push_back(AppState());
+        app = &apps.back();
+        app->name = name;
+        app->title = name;
+    }
+    current = *app;
+    if (app->status == APP_STARTING || app->status == APP_RUNNING) return false;
+
+    app->status = APP_STARTING;
+    return true;
+}
+
+void AppRegistry::opened(const std::string& name, pid_t pid) {
+    std::lock_guard<std::mutex> guard(lock);
+    AppState* app = find(name);
+    if (app == NULL) return;
+    app->status = pid < 0 ? APP_STOPPED : APP_RUNNING;
+    app->pid = pid;
+    app->startedMs = nowMs();
+}
+
+void AppRegistry::closing(const std::string& name, bool signalled) {
+    std::lock_guard<std::mutex> guard(lock);
+    AppState* app = find(name);
+    if (app == NULL || app->status == APP_STOPPED) return;
+    app->status = signalled ? APP_CLOSING : APP_STOPPED;
+}
+
+// Public method called when a launched child was reaped
+/*
+    Browsers often start helper processes, but only the pid we launched is
+    recorded; when that one is reaped the app is stopped. Exits of older
+    launches of the same app (pid no longer current) are ignored.
+*/
+void AppRegistry::exited(pid_t pid, const std::string& session, int status) {
+    std::lock_guard<std::mutex> guard(lock);
+    AppState* app = find(session);
+    if (app == NULL || app->pid != pid) return;
+    app->status = APP_STOPPED;
+    app->exitStatus = status;
+}
+
+bool AppRegistry::get(const std::string& name, AppState& state) const {
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t i = 0; i < apps.size(); ++i) {
+        if (apps[i].name == name) {
+            state = apps[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<AppRegistry::AppState> AppRegistry::snapshot() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return apps;
+}
+
+std::string AppRegistry::describe(const AppState& state) {
+    std::string text = state.name + ": " + STATUS_NAMES[state.status];
+    if (state.status == APP_RUNNING || state.status == APP_CLOSING) {
+        int64_t up = (nowMs() - state.startedMs) / 1000;
+        char uptime[32];
+        snprintf(uptime, sizeof(uptime), "%lldm %02llds", static_cast<long long>(up / 60), static_cast<long long>(up % 60));
+        text += " (";
+        if (state.pid > 0) text += "pid " + std::to_string(state.pid) + ", ";
+        text += std::string("up ") + uptime;
+        if (!state.profileDir.empty()) text += ", profile " + state.profileDir;
+        text += ")";
+    } else if (state.status == APP_STOPPED && state.exitStatus >= 0) {
+        if (WIFEXITED(state.exitStatus)) text += " (exited with code " + std::to_string(WEXITSTATUS(state.exitStatus)) + ")";
+        else if (WIFSIGNALED(state.exitStatus)) text += " (killed by signal " + std::to_string(WTERMSIG(state.exitStatus)) + ")";
+    }
+    return text;
+}
+
+// Private method returning the entry of "name" (NULL if unknown); lock must be held
+AppRegistry::AppState* AppRegistry::find(const std::string& name) {
+    for (size_t i = 0; i < apps.size(); ++i) {
+        if (apps[i].name == name) return &apps[i];
+    }
+    return NULL;
+}
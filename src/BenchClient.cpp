@@ -0,0 +1,92 @@
+#include "../header/BenchClient.hpp"
+#include "../header/Config.hpp"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+uint64_t BenchClient::nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+bool BenchClient::portFromConfig(const std::string& path, int& port) {
+    Config config;
+    std::string error;
+    if (!Config::load(path, config, error)) {
+        std::cerr << "Configuration error: " << error << "\n";
+        return false;
+    }
+    port = config.port;
+    return true;
+}
+
+int BenchClient::connectTo(const std::string& host, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) <= 0 ||
+        connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+void BenchClient::setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+bool BenchClient::flush(int fd, std::string& outbox) {
+    while (!outbox.empty()) {
+        ssize_t n = send(fd, outbox.data(), outbox.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            outbox.erase(0, n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (n < 0 && errno == EINTR) continue;
+        return false;
+    }
+    return true;
+}
+
+// Public method waiting up to "nanos" for socket events
+/*
+    int epoll_pwait2(int epfd, struct epoll_event* events, int maxevents,
+                     const struct timespec* timeout, const sigset_t* sigmask);
+        Like epoll_wait() with a nanosecond timeout (Linux 5.11). Scheduled
+        sends are often less than a millisecond apart: with epoll_wait() the
+        tool would have to spin through those gaps, taking the CPU from the
+        server it measures. Older kernels round up to a millisecond instead.
+*/
+int BenchClient::waitEvents(int epfd, struct epoll_event* events, int maxEvents, uint64_t nanos) {
+    struct timespec timeout;
+    timeout.tv_sec = static_cast<time_t>(nanos / 1000000000ULL);
+    timeout.tv_nsec = static_cast<long>(nanos % 1000000000ULL);
+    int n = epoll_pwait2(epfd, events, maxEvents, &timeout, NULL);
+    if (n >= 0 || errno != ENOSYS) return n;
+    return epoll_wait(epfd, events, maxEvents, static_cast<int>((nanos + 999999) / 1000000));
+}
+
+BenchClient::Answer BenchClient::answerOf(std::string_view line) {
+    if (line.compare(0, 17, "Command received.") == 0) return ANSWER_ACK;
+    if (line.compare(0, 5, "Busy:") == 0) return ANSWER_BUSY;
+    return ANSWER_NONE;
+}
@@ -0,0 +1,147 @@
+#include "../header/BinaryProtocol.hpp"
+#include <charconv>
+#include <utility>
+
+void BinaryProtocol::putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+// The tenth byte holds bit 63 only: anything more would not fit in 64 bits
+bool BinaryProtocol::getVarint(std::string_view& in, uint64_t& value) {
+    value = 0;
+    for (size_t i = 0; i < in.size() && i < MAX_VARINT; ++i) {
+        unsigned char byte = static_cast<unsigned char>(in[i]);
+        if (i == MAX_VARINT - 1 && byte > 1) return false;
+        value |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+        if ((byte & 0x80) == 0) {
+            in.remove_prefix(i + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BinaryProtocol::nextFrame(std::string_view in, std::string_view& payload, size_t& used) {
+    std::string_view rest = in;
+    uint64_t len = 0;
+    if (!getVarint(rest, len) || rest.size() < len) return false;
+    payload = rest.substr(0, len);
+    used = (in.size() - rest.size()) + len;
+    return true;
+}
+
+// Public method parsing a request payload
+/*
+    The argument text is built first and the views are taken afterwards, so
+    growing argText while decoding cannot leave a view dangling. Request is
+    reused by the dispatcher for every frame: after the first few requests
+    decoding does not allocate.
+*/
+bool BinaryProtocol::decodeRequest(std::string_view payload, Request& request) {
+    request.opcode = 0;
+    request.id = 0;
+    request.argText.clear();
+    request.args.clear();
+
+    uint64_t opcode = 0, argc = 0;
+    if (!getVarint(payload, opcode) || !getVarint(payload, request.id)) return false;
+    request.opcode = opcode;
+    if (!getVarint(payload, argc) || argc > payload.size()) return false;  // every argument takes >= 2 bytes
+
+    // (offset, length) of every argument in argText
+    std::pair<size_t, size_t> spans[MAX_ARGS];
+    if (argc > MAX_ARGS) return false;
+
+    for (uint64_t i = 0; i < argc; ++i) {
+        if (payload.empty()) return false;
+        unsigned char type = static_cast<unsigned char>(payload[0]);
+        payload.remove_prefix(1);
+
+        if (i > 0) request.argText += ' ';
+        size_t start = request.argText.size();
+        uint64_t value = 0;
+        char digits[24];
+        std::to_chars_result printed;
+
+        switch (type) {
+        case ARG_UINT:
+            if (!getVarint(payload, value)) return false;
+            printed = std::to_chars(digits, digits + sizeof(digits), value);
+            request.argText.append(digits, printed.ptr);
+            break;
+        case ARG_SINT:
+            if (!getVarint(payload, value)) return false;
+            printed = std::to_chars(digits, digits + sizeof(digits),
+                                    static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1));
+            request.argText.append(digits, printed.ptr);
+            break;
+        case ARG_BYTES:
+            if (!getVarint(payload, value) || value > payload.size()) return false;
+            request.argText.append(payload.data(), value);
+            payload.remove_prefix(value);
+            break;
+        default:
+            return false;
+        }
+        spans[i] = std::make_pair(start, request.argText.size() - start);
+    }
+    if (!payload.empty()) return false;  // trailing bytes
+
+    for (uint64_t i = 0; i < argc; ++i) {
+        request.args.push_back(std::string_view(request.argText.data() + spans[i].first, spans[i].second));
+    }
+    return true;
+}
+
+void BinaryProtocol::appendRequest(std::string& out, uint64_t opcode, uint64_t id,
+                                   const std::vector<std::string>& args) {
+    std::string payload;
+    putVarint(payload, opcode);
+    putVarint(payload, id);
+    putVarint(payload, args.size());
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        uint64_t number = 0;
+        std::from_chars_result parsed = std::from_chars(arg.data(), arg.data() + arg.size(), number);
+        bool numeric = !arg.empty() && parsed.ec == std::errc() && parsed.ptr == arg.data() + arg.size() &&
+                       (arg.size() == 1 || arg[0] != '0');  // "007" stays text
+        if (numeric) {
+            payload += static_cast<char>(ARG_UINT);
+            putVarint(payload, number);
+        } else {
+            payload += static_cast<char>(ARG_BYTES);
+            putVarint(payload, arg.size());
+            payload += arg;
+        }
+    }
+    putVarint(out, payload.size());
+    out += payload;
+}
+
+// Helper returning the encoded size of a varint
+static size_t varintSize(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+void BinaryProtocol::appendResponse(std::string& out, uint64_t id, Status status, std::string_view text) {
+    putVarint(out, varintSize(id) + 1 + text.size());
+    putVarint(out, id);
+    out += static_cast<char>(status);
+    out.append(text.data(), text.size());
+}
+
+bool BinaryProtocol::decodeResponse(std::string_view payload, uint64_t& id, Status& status, std::string_view& text) {
+    if (!getVarint(payload, id) || payload.empty()) return false;
+    status = static_cast<Status>(static_cast<unsigned char>(payload[0]));
+    text = payload.substr(1);
+    return true;
+}
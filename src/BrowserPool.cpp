@@ -0,0 +1,102 @@
+#include "../header/BrowserPool.hpp"
+#include "../header/AppRegistry.hpp"
+#include "../header/Logger.hpp"
+#include <vector>
+
+BrowserPool::BrowserPool(ProcessLauncher& launcher)
+    : launcher(launcher), browser("google-chrome"), warm(false) {}
+
+void BrowserPool::setExecutable(const std::string& path) {
+    std::lock_guard<std::mutex> guard(lock);
+    browser = path;
+}
+
+void BrowserPool::setProfiles(const std::vector<Profile>& list) {
+    std::lock_guard<std::mutex> guard(lock);
+    profiles.clear();
+    for (size_t i = 0; i < list.size(); ++i) profiles[list[i].session] = list[i];
+}
+
+void BrowserPool::warmAll() {
+    if (!warm) return;
+    std::lock_guard<std::mutex> guard(lock);
+    for (std::map<std::string, Profile>::const_iterator it = profiles.begin(); it != profiles.end(); ++it) {
+        if (instances.find(it->first) == instances.end()) warmUp(it->second);
+    }
+}
+
+// Private method starting the hidden instance of one profile; lock must be held
+/*
+    --no-startup-window starts the browser process (profile loaded, renderer
+    ready) without opening any window. It stays running until a window it
+    opened later is closed.
+*/
+void BrowserPool::warmUp(const Profile& profile) {
+    std::vector<std::string> argv;
+    argv.push_back(browser);
+    argv.push_back("--user-data-dir=" + profile.profileDir);
+    argv.push_back("--no-startup-window");
+    argv.push_back("--disable-gpu");
+
+    pid_t pid = launcher.launch(profile.session, argv);
+    if (pid <= 0) return;  // failed, or dry run: nothing to keep warm
+
+    WarmInstance instance = { pid, AppRegistry::nowMs() };
+    instances[profile.session] = instance;
+    LOG_INFO("Warm ", profile.title, " browser ready (pid ", pid, ").");
+}
+
+// Public method opening an app window
+/*
+    The command line is the same in both modes: with a warm instance running on
+    the profile, the new process forwards it to that instance and exits at once.
+*/
+pid_t BrowserPool::open(const std::string& session) {
+    Profile profile;
+    std::string executable;
+    pid_t warmPid = -1;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        executable = browser;
+        std::map<std::string, Profile>::const_iterator it = profiles.find(session);
+        if (it == profiles.end()) return -1;
+        profile = it->second;
+        std::map<std::string, WarmInstance>::const_iterator w = instances.find(session);
+        if (w != instances.end()) warmPid = w->second.pid;
+    }
+
+    std::vector<std::string> argv;
+    argv.push_back(executable);
+    argv.push_back("--user-data-dir=" + profile.profileDir);  // separate session directory per app
+    argv.push_back("--app=" + profile.url);
+    argv.insert(argv.end(), profile.flags.begin(), profile.flags.end());
+
+    pid_t pid = launcher.launch(session, argv);
+    if (pid < 0) {
+        LOG_WARN("Failed to launch browser");
+        return -1;
+    }
+    if (warmPid > 0) {
+        LOG_INFO(profile.title, " opened in the warm browser (pid ", warmPid, ").");
+        return warmPid;
+    }
+    LOG_INFO(profile.title, " should be launching in the background (pid ", pid, ").");
+    return pid;
+}
+
+void BrowserPool::onExit(pid_t pid, const std::string& session, int) {
+    std::lock_guard<std::mutex> guard(lock);
+    std::map<std::string, WarmInstance>::iterator it = instances.find(session);
+    if (it == instances.end() || it->second.pid != pid) return;  // not a warm instance
+
+    int64_t lived = AppRegistry::nowMs() - it->second.startedMs;
+    instances.erase(it);
+    if (!warm) return;
+
+    if (lived < MIN_WARM_LIFETIME_MS) {
+        LOG_WARN("Warm ", session, " browser exited after ", lived, " ms, not restarting it.");
+        return;
+    }
+    std::map<std::string, Profile>::const_iterator profile = profiles.find(session);
+    if (profile != profiles.end()) warmUp(profile->second);
+}
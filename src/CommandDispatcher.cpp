@@ -0,0 +1,502 @@
+#include "../header/CommandDispatcher.hpp"
+#include "../header/Metrics.hpp"
+#include "../header/Logger.hpp"
+#include <memory>
+
+// Reply sent after every command, as the original single-client loop did
+static const char* ACK = "Command received.\n";
+
+// Helper appending the reply of a finished command in the client's protocol
+static void appendReply(std::string& out, const CommandContext& ctx) {
+    if (ctx.binary) {
+        BinaryProtocol::appendResponse(out, ctx.requestId, ctx.partial ? BinaryProtocol::STATUS_MORE :
+                                       BinaryProtocol::STATUS_OK, ctx.output);
+        return;
+    }
+    out += ctx.output;
+    if (ctx.acknowledge) out += ACK;
+}
+
+// Helper appending a refusal; text clients get just the message
+static void appendError(std::string& out, const CommandContext& ctx, BinaryProtocol::Status status,
+                        const std::string& text) {
+    if (ctx.binary) BinaryProtocol::appendResponse(out, ctx.requestId, status, text);
+    else out += text;
+}
+
+// Runs a handler and records its latency under the command's histogram
+static void runTimed(const CommandRegistry::Command* cmd, CommandContext& ctx) {
+    uint64_t started = Metrics::now();
+    cmd->handler(ctx);
+    Metrics::instance().recordHandler(cmd->metricId, Metrics::now() - started);
+}
+
+// Helper formatting a wait for a "try again" reply, rounded up to seconds
+static std::string waitText(uint64_t waitNs) {
+    return std::to_string((waitNs + 999999999ULL) / 1000000000ULL) + " s";
+}
+
+CommandDispatcher::CommandDispatcher(TcpServer& server, ConfigStore& config, ThreadPool& pool,
+                                     InFlightTable& inFlight, RateTable& rates)
+    : server(server), config(config), pool(pool), inFlight(inFlight), rates(rates), workerJobs(0) {}
+
+bool CommandDispatcher::InFlightTable::tryAcquire(const CommandRegistry::Command* cmd, int limit) {
+    std::lock_guard<std::mutex> guard(lock);
+    int& count = running[cmd->name];
+    if (limit > 0 && count >= limit) return false;
+    ++count;
+    return true;
+}
+
+void CommandDispatcher::InFlightTable::release(const CommandRegistry::Command* cmd) {
+    std::lock_guard<std::mutex> guard(lock);
+    --running[cmd->name];
+}
+
+bool CommandDispatcher::RateTable::take(const CommandRegistry::Command* cmd, uint64_t nowNs, uint64_t& waitNs) {
+    std::lock_guard<std::mutex> guard(lock);
+    TokenBucket& bucket = buckets[cmd->name];
+    bucket.setLimit(cmd->options.rate);
+    return bucket.take(nowNs, waitNs);
+}
+
+void CommandDispatcher::setInputSink(InputSink& sink) {
+    input.reset(new InputChannel(sink));
+}
+
+void CommandDispatcher::onFrame(TcpServer::ConnectionId client, std::string_view frame) {
+    if (batch.client != client) {
+        onBatchEnd(batch.client);  // never expected: batches do not interleave
+        batch.client = client;
+    }
+    FrameParser::Mode framing = server.framing(client);
+    if (framing == FrameParser::VARINT_PREFIXED) {
+        onBinaryFrame(client, frame);
+        return;
+    }
+    if (framing == FrameParser::FIXED_SIZE) {
+        onInputFrame(client, frame);
+        return;
+    }
+
+    LOG_DEBUG("Client ", server.peerName(client), ": ", frame);
+
+    // Look the command up (case-insensitive)
+    CommandContext ctx(server, client, frame);
+    const CommandRegistry::Command* cmd = config.current().commands.match(ctx);
+    if (cmd == NULL) {
+        flushRun();
+        LOG_INFO("Unknown command.");
+        Metrics::instance().add(Metrics::COMMANDS_UNKNOWN);
+        batch.output += ACK;
+        return;
+    }
+    execute(cmd, ctx);
+}
+
+// Private method for one binary-protocol request
+/*
+    The opcode indexes the command table directly, so nothing is lowercased,
+    split or hashed. Typed arguments arrive as the text views the handlers
+    already understand (see BinaryProtocol::Request).
+*/
+void CommandDispatcher::onBinaryFrame(TcpServer::ConnectionId client, std::string_view frame) {
+    CommandContext ctx(server, client);
+    ctx.binary = true;
+    bool valid = BinaryProtocol::decodeRequest(frame, request);
+    ctx.requestId = request.id;
+    LOG_DEBUG("Client ", server.peerName(client), ": opcode ", request.opcode, ", request ", request.id);
+
+    if (!valid) {
+        flushRun();
+        LOG_WARN("Malformed binary request from ", server.peerName(client));
+        appendError(batch.output, ctx, BinaryProtocol::STATUS_BAD_REQUEST, "Malformed request.\n");
+        return;
+    }
+
+    const CommandRegistry& commands = config.current().commands;
+    if (request.opcode == BinaryProtocol::OP_LIST) {
+        flushRun();
+        BinaryProtocol::appendResponse(batch.output, request.id, BinaryProtocol::STATUS_OK, commands.opcodeTable());
+        return;
+    }
+
+    const CommandRegistry::Command* cmd = commands.byOpcode(request.opcode);
+    if (cmd == NULL) {
+        flushRun();
+        LOG_INFO("Unknown command.");
+        Metrics::instance().add(Metrics::COMMANDS_UNKNOWN);
+        appendError(batch.output, ctx, BinaryProtocol::STATUS_UNKNOWN, "Unknown command.\n");
+        return;
+    }
+
+    ctx.line = request.argText;
+    ctx.name = cmd->name;
+    ctx.argLine = request.argText;
+    ctx.args = request.args;
+    execute(cmd, ctx);
+}
+
+// Private method for one remote input message
+/*
+    Nothing is written here: the channel sums the moves of the whole batch
+    and onBatchEnd() writes them with the rest of its events.
+*/
+void CommandDispatcher::onInputFrame(TcpServer::ConnectionId client, std::string_view frame) {
+    if (!input) return;  // "input" refuses to switch without a sink
+    batch.input = true;
+    if (!input->add(frame)) LOG_WARN("Malformed input message from ", server.peerName(client));
+}
+
+// Private method deciding whether a command that was found may run
+/*
+    Checked before merging, so every command a client sends takes its own
+    token, and before the worker copy of the line is made. The limits are
+    read from the current snapshot: a reload applies new rates to existing
+    clients (their buckets start full again).
+
+    Earlier commands of the batch are run first: a text client sees the
+    refusal in the order it sent the command.
+*/
+bool CommandDispatcher::admit(const CommandRegistry::Command* cmd, CommandContext& ctx) {
+    const CommandOptions& opt = cmd->options;
+    if (opt.priority == PRIORITY_INTERACTIVE) return true;
+
+    const Config& settings = config.current().config;
+    bool heavy = opt.priority == PRIORITY_HEAVY;
+    ClientLimits& client = limits[ctx.client];
+    TokenBucket& bucket = heavy ? client.heavy : client.normal;
+    bucket.setLimit(heavy ? settings.clientHeavyRate : settings.clientRate);
+
+    uint64_t now = Metrics::now();
+    uint64_t wait = 0;
+    std::string refusal;
+    if (!bucket.take(now, wait)) {
+        refusal = std::string("Busy: too many ") + (heavy ? "heavy " : "") + "commands from this client (limit " +
+                  TokenBucket::describe(heavy ? settings.clientHeavyRate : settings.clientRate) +
+                  "), try again in " + waitText(wait) + ".\n";
+    } else if (opt.rate.count > 0 && !rates.take(cmd, now, wait)) {
+        refusal = "Busy: " + cmd->name + " is limited to " + TokenBucket::describe(opt.rate) +
+                  ", try again in " + waitText(wait) + ".\n";
+    } else if (heavy && opt.worker && pool.queuedJobs() * 2 >= pool.queueLimit()) {
+        refusal = "Busy: server is loaded, try again later.\n";
+    } else {
+        return true;
+    }
+
+    flushRun();
+    LOG_DEBUG("Refused ", cmd->name, " from ", server.peerName(ctx.client), ": ",
+              std::string_view(refusal).substr(0, refusal.size() - 1));
+    Metrics::instance().add(Metrics::COMMANDS_THROTTLED);
+    appendError(batch.output, ctx, BinaryProtocol::STATUS_BUSY, refusal);
+    return false;
+}
+
+// Private method that merges, queues or runs a command that was found
+void CommandDispatcher::execute(const CommandRegistry::Command* cmd, CommandContext& ctx) {
+    if (!admit(cmd, ctx)) return;
+
+    // Mergeable command without arguments: extend the current run or start a new one
+    const CommandOptions& opt = cmd->options;
+    if (opt.coalesce != COALESCE_NONE && ctx.args.empty()) {
+        if (batch.runLast != NULL && batch.runLast->options.coalesceKey != opt.coalesceKey) flushRun();
+        batch.runLast = cmd;
+        if (opt.step > 0) batch.runUp = cmd;
+        if (opt.step < 0) batch.runDown = cmd;
+        batch.runNet += opt.step;
+        ++batch.runLength;
+        if (ctx.binary) batch.runIds.push_back(ctx.requestId);
+        return;
+    }
+
+    flushRun();
+    if (opt.worker) {
+        runOnWorker(cmd, ctx);
+        return;
+    }
+
+    runTimed(cmd, ctx);
+    if (ctx.attachment) startStream(ctx.client, ctx);
+    else appendReply(batch.output, ctx);
+}
+
+void CommandDispatcher::onBatchEnd(TcpServer::ConnectionId client) {
+    if (client != batch.client) return;
+
+    flushRun();
+    if (!batch.output.empty() && server.isConnected(client)) deliver(client, batch.output);
+    batch.output.clear();
+    if (batch.input) {
+        input->flush();
+        if (server.isConnected(client)) inputClients.insert(client);
+        else if (inputClients.empty()) input->releaseAll();
+        batch.input = false;
+    }
+
+    // No Command pointers are held now: safe to move to a reloaded configuration
+    config.refresh();
+}
+
+void CommandDispatcher::onDisconnect(TcpServer::ConnectionId client) {
+    streams.erase(client);
+    limits.erase(client);
+    if (inputClients.erase(client) > 0 && inputClients.empty()) input->releaseAll();
+}
+
+void CommandDispatcher::push(TcpServer::ConnectionId client, const CommandContext& reply) {
+    finish(client, reply);
+}
+
+size_t CommandDispatcher::queuedAttachments(TcpServer::ConnectionId client) const {
+    std::unordered_map<TcpServer::ConnectionId, std::deque<Stream> >::const_iterator it = streams.find(client);
+    return it == streams.end() ? 0 : it->second.size();
+}
+
+// Private method that sends the reply of a worker command once it finished
+void CommandDispatcher::finish(TcpServer::ConnectionId client, const CommandContext& ctx) {
+    if (!server.isConnected(client)) return;  // client left while the command ran
+    if (ctx.attachment) {
+        startStream(client, ctx);
+        return;
+    }
+    std::string reply;
+    appendReply(reply, ctx);
+    if (!reply.empty()) deliver(client, reply);
+}
+
+// Private method sending reply bytes, or holding them behind a text attachment
+// (still queued or being sent) until it is complete
+void CommandDispatcher::deliver(TcpServer::ConnectionId client, std::string_view data) {
+    std::unordered_map<TcpServer::ConnectionId, std::deque<Stream> >::iterator it = streams.find(client);
+    if (it != streams.end()) {
+        std::deque<Stream>& queue = it->second;
+        for (size_t i = 0; i < queue.size(); ++i) {
+            if (!queue[i].binary) {
+                queue.back().held.append(data.data(), data.size());
+                return;
+            }
+        }
+    }
+    server.sendData(client, data);
+}
+
+// Private method queueing the attachment of a finished command
+/*
+    Replies already collected in this batch were produced first, so they are
+    sent (or held) before the attachment's own text. The attachment starts
+    right away unless an earlier one is still being sent to this client.
+*/
+void CommandDispatcher::startStream(TcpServer::ConnectionId client, const CommandContext& ctx) {
+    if (batch.client == client && !batch.output.empty()) {
+        deliver(client, batch.output);
+        batch.output.clear();
+    }
+
+    if (ctx.binary) {
+        std::string frame;
+        if (!ctx.output.empty()) BinaryProtocol::appendResponse(frame, ctx.requestId, BinaryProtocol::STATUS_MORE, ctx.output);
+        if (ctx.attachment->empty()) {
+            BinaryProtocol::appendResponse(frame, ctx.requestId, ctx.partial ? BinaryProtocol::STATUS_MORE :
+                                           BinaryProtocol::STATUS_OK, "");
+        }
+        if (!frame.empty()) deliver(client, frame);
+    } else {
+        std::string text = ctx.output;
+        if (ctx.attachment->empty() && ctx.acknowledge) text += ACK;
+        if (!text.empty()) deliver(client, text);
+    }
+    if (ctx.attachment->empty()) return;
+
+    Stream stream;
+    stream.data = ctx.attachment;
+    stream.binary = ctx.binary;
+    stream.requestId = ctx.requestId;
+    stream.acknowledge = ctx.acknowledge;
+    stream.partial = ctx.partial;
+    std::deque<Stream>& queue = streams[client];
+    queue.push_back(stream);
+    if (queue.size() == 1) pumpStreams(client);
+}
+
+// Private method sending attachment chunks while the client's outbox has room
+/*
+    Runs again from the drained notification until every queued attachment is
+    out. sendData() may drop the connection, which erases this client's queue
+    (onDisconnect), so nothing in it is touched after a failed send.
+*/
+void CommandDispatcher::pumpStreams(TcpServer::ConnectionId client) {
+    std::string frame;
+    for (;;) {
+        std::unordered_map<TcpServer::ConnectionId, std::deque<Stream> >::iterator it = streams.find(client);
+        if (it == streams.end()) return;
+        if (!server.isConnected(client)) {
+            streams.erase(it);
+            return;
+        }
+
+        Stream& stream = it->second.front();
+        const std::string& data = *stream.data;
+        while (stream.offset < data.size()) {
+            if (server.pendingBytes(client) >= server.outboxLimit()) {
+                server.notifyWhenDrained(client, [this, client]() { pumpStreams(client); });
+                return;
+            }
+            size_t length = data.size() - stream.offset;
+            if (length > STREAM_CHUNK) length = STREAM_CHUNK;
+            if (length > server.outboxLimit()) length = server.outboxLimit();  // stays far below the drop limit
+            std::string_view chunk(data.data() + stream.offset, length);
+            stream.offset += length;
+
+            bool sent;
+            if (stream.binary) {
+                frame.clear();
+                bool final = stream.offset == data.size() && !stream.partial;
+                BinaryProtocol::appendResponse(frame, stream.requestId, final ?
+                                               BinaryProtocol::STATUS_OK : BinaryProtocol::STATUS_MORE, chunk);
+                sent = server.sendData(client, frame);
+            } else {
+                sent = server.sendData(client, chunk);
+            }
+            if (!sent) return;
+        }
+
+        // Done: acknowledge, then release what was held behind it
+        std::string tail = !stream.binary && stream.acknowledge ? ACK : "";
+        tail += stream.held;
+        it->second.pop_front();
+        if (it->second.empty()) streams.erase(it);
+        if (!tail.empty() && !server.sendData(client, tail)) return;
+    }
+}
+
+// Private method that executes the pending run of merged commands once
+/*
+    COALESCE_ADD  : the steps are summed and the handler of the winning
+                    direction runs with ctx.count = |sum| (nothing runs for 0).
+    COALESCE_LAST : only the last command of the run runs.
+
+    Every merged command is still acknowledged, so clients that count replies
+    see one "Command received." per command they sent. Binary clients get one
+    response per request id; the handler's output goes with the last one.
+
+    A worker command ("close <app>") goes to the pool like an unmerged one:
+    the other merged commands are acknowledged now and the last one gets
+    the worker's reply.
+*/
+void CommandDispatcher::flushRun() {
+    if (batch.runLast == NULL) return;
+
+    const CommandRegistry::Command* cmd = batch.runLast;
+    int count = 1;
+    if (cmd->options.coalesce == COALESCE_ADD) {
+        cmd = batch.runNet > 0 ? batch.runUp : (batch.runNet < 0 ? batch.runDown : NULL);
+        count = batch.runNet > 0 ? batch.runNet : -batch.runNet;
+    }
+
+    std::string output;
+    if (cmd != NULL && cmd->options.worker) {
+        CommandContext ctx(server, batch.client, cmd->name);
+        ctx.name = cmd->name;
+        ctx.count = count;
+        if (!batch.runIds.empty()) {
+            ctx.binary = true;
+            ctx.requestId = batch.runIds.back();
+            batch.runIds.pop_back();
+        }
+        for (size_t i = 0; i < batch.runIds.size(); ++i) {
+            BinaryProtocol::appendResponse(batch.output, batch.runIds[i], BinaryProtocol::STATUS_OK, "");
+        }
+        if (!ctx.binary) {
+            for (int i = 1; i < batch.runLength; ++i) batch.output += ACK;
+        }
+        if (batch.runLength > 1) LOG_INFO("Merged ", batch.runLength, " commands into: ", cmd->name);
+        Metrics::instance().add(Metrics::COMMANDS_MERGED, batch.runLength - 1);
+
+        batch.runLast = batch.runUp = batch.runDown = NULL;
+        batch.runNet = 0;
+        batch.runLength = 0;
+        batch.runIds.clear();
+        runOnWorker(cmd, ctx);
+        return;
+    }
+    if (cmd != NULL) {
+        if (batch.runLength > 1) {
+            LOG_INFO("Merged ", batch.runLength, " commands into: ", cmd->name,
+                     count > 1 ? " x" + std::to_string(count) : std::string());
+        }
+        CommandContext ctx(server, batch.client, cmd->name);
+        ctx.name = cmd->name;
+        ctx.count = count;
+        runTimed(cmd, ctx);
+        output.swap(ctx.output);
+    }
+    if (batch.runIds.empty()) {
+        batch.output += output;
+        for (int i = 0; i < batch.runLength; ++i) batch.output += ACK;
+    } else {
+        for (size_t i = 0; i < batch.runIds.size(); ++i) {
+            bool last = i + 1 == batch.runIds.size();
+            BinaryProtocol::appendResponse(batch.output, batch.runIds[i], BinaryProtocol::STATUS_OK,
+                                           last ? std::string_view(output) : std::string_view());
+        }
+    }
+    Metrics::instance().add(Metrics::COMMANDS_MERGED, batch.runLength - (cmd != NULL ? 1 : 0));
+
+    batch.runLast = batch.runUp = batch.runDown = NULL;
+    batch.runNet = 0;
+    batch.runLength = 0;
+    batch.runIds.clear();
+}
+
+// Private method that hands a command to the thread pool
+/*
+    The frame lives in the connection's receive buffer, which is reused as soon
+    as we return. The job therefore owns a copy of the line, and the views in the
+    context are moved over to that copy before the job is queued.
+*/
+void CommandDispatcher::runOnWorker(const CommandRegistry::Command* cmd, CommandContext& ctx) {
+    if (!inFlight.tryAcquire(cmd, cmd->options.maxConcurrent)) {
+        Metrics::instance().add(Metrics::COMMANDS_BUSY);
+        appendError(batch.output, ctx, BinaryProtocol::STATUS_BUSY,
+                    "Busy: " + cmd->name + " is already running (limit " +
+                    std::to_string(cmd->options.maxConcurrent) + "), try again later.\n");
+        return;
+    }
+
+    std::shared_ptr<std::string> line = std::make_shared<std::string>(ctx.line);
+    std::shared_ptr<CommandContext> job = std::make_shared<CommandContext>(server, ctx.client, *line);
+    const char* oldBase = ctx.line.data();
+    const char* newBase = line->data();
+    job->name = cmd->name;
+    job->count = ctx.count;
+    job->binary = ctx.binary;
+    job->requestId = ctx.requestId;
+    if (!ctx.argLine.empty()) {
+        job->argLine = std::string_view(newBase + (ctx.argLine.data() - oldBase), ctx.argLine.size());
+    }
+    for (size_t i = 0; i < ctx.args.size(); ++i) {
+        job->args.push_back(std::string_view(newBase + (ctx.args[i].data() - oldBase), ctx.args[i].size()));
+    }
+
+    ConfigStore::Snapshot snapshot = config.currentShared();  // keeps *cmd alive until the reply is sent
+    bool queued = pool.submit([this, cmd, line, job, snapshot]() {
+        runTimed(cmd, *job);
+
+        // Back to the event loop thread to release the slot and reply
+        server.post([this, cmd, line, job, snapshot]() {
+            inFlight.release(cmd);
+            --workerJobs;
+            finish(job->client, *job);
+        });
+    });
+
+    if (queued) {
+        ++workerJobs;
+    } else {
+        inFlight.release(cmd);
+        Metrics::instance().add(Metrics::COMMANDS_BUSY);
+        appendError(batch.output, ctx, BinaryProtocol::STATUS_BUSY,
+                    "Busy: server queue is full (" + std::to_string(pool.queueLimit()) +
+                    " jobs waiting), try again later.\n");
+    }
+}
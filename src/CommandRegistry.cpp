@@ -0,0 +1,240 @@
+#include "../header/CommandRegistry.hpp"
+#include "../header/Metrics.hpp"
+#include <algorithm>
+
+// Helper that lowercases one ASCII character without locale lookups
+static inline unsigned char lowerAscii(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// FNV-1a over the lowercased words, with a single space between words.
+// "Open   FaceBook" and "open facebook" hash to the same value.
+static uint64_t hashWords(const std::string_view* words, int count) {
+    uint64_t h = 1469598103934665603ULL;
+    for (int w = 0; w < count; ++w) {
+        if (w > 0) {
+            h ^= ' ';
+            h *= 1099511628211ULL;
+        }
+        for (char c : words[w]) {
+            h ^= lowerAscii(static_cast<unsigned char>(c));
+            h *= 1099511628211ULL;
+        }
+    }
+    // Final avalanche so both 32-bit halves are well mixed
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Helper that splits "text" into whitespace separated words (at most "max")
+static int splitWords(std::string_view text, std::string_view* out, int max) {
+    int count = 0;
+    size_t i = 0;
+    while (i < text.size() && count < max) {
+        while (i < text.size() && isSpace(text[i])) ++i;
+        if (i == text.size()) break;
+        size_t start = i;
+        while (i < text.size() && !isSpace(text[i])) ++i;
+        out[count++] = text.substr(start, i - start);
+    }
+    return count;
+}
+
+// Largest number of words a command name may have
+static const int MAX_NAME_WORDS = 8;
+
+CommandRegistry::CommandRegistry() : maxWords(0) {}
+
+std::string CommandRegistry::normalise(const std::string& name, int* words) {
+    std::string_view parts[MAX_NAME_WORDS];
+    int count = splitWords(name, parts, MAX_NAME_WORDS);
+    std::string out;
+    for (int i = 0; i < count; ++i) {
+        if (i > 0) out += ' ';
+        for (char c : parts[i]) out += static_cast<char>(lowerAscii(static_cast<unsigned char>(c)));
+    }
+    *words = count;
+    return out;
+}
+
+void CommandRegistry::add(const std::string& name, const CommandHandler& handler, const std::string& help,
+                          const CommandOptions& options) {
+    Command cmd;
+    cmd.name = normalise(name, &cmd.words);
+    if (cmd.words == 0) return;
+
+    std::string_view parts[MAX_NAME_WORDS];
+    splitWords(cmd.name, parts, MAX_NAME_WORDS);
+    cmd.hash = hashWords(parts, cmd.words);
+    cmd.handler = handler;
+    cmd.help = help;
+    cmd.options = options;
+    cmd.metricId = Metrics::instance().handlerId(cmd.name);
+
+    for (size_t i = 0; i < commands.size(); ++i) {
+        if (commands[i].name == cmd.name) {
+            cmd.opcode = commands[i].opcode;
+            commands[i] = cmd;  // same name: replace the handler, table layout is unchanged
+            return;
+        }
+    }
+    cmd.opcode = static_cast<uint32_t>(commands.size() + 1);
+    commands.push_back(cmd);
+    rebuild();
+}
+
+// Private method that maps a hash to its table slot through the bucket displacement
+size_t CommandRegistry::slotFor(uint64_t hash) const {
+    uint32_t h1 = static_cast<uint32_t>(hash);
+    uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1u;
+    uint32_t d = displacement[h1 & (displacement.size() - 1)];
+    return (h1 + d * h2) & (slots.size() - 1);
+}
+
+// Private method that rebuilds the perfect hash table
+/*
+    Hash-and-displace:
+        1. Every name goes into a bucket chosen by the low hash bits.
+        2. Buckets are placed largest first. For each bucket we try displacements
+           d = 0, 1, 2, ... until every name of the bucket lands in a free slot.
+        3. A lookup then needs exactly one probe: bucket -> displacement -> slot.
+
+    The table has twice as many slots as commands, so a displacement is found
+    after a few tries. This only runs when commands are registered.
+*/
+void CommandRegistry::rebuild() {
+    size_t n = commands.size();
+    size_t tableSize = 1;
+    while (tableSize < n * 2) tableSize <<= 1;
+    size_t bucketCount = 1;
+    while (bucketCount * 2 < n) bucketCount <<= 1;
+
+    maxWords = 0;
+    std::vector<std::vector<uint32_t> > buckets(bucketCount);
+    for (size_t i = 0; i < n; ++i) {
+        buckets[static_cast<uint32_t>(commands[i].hash) & (bucketCount - 1)].push_back(static_cast<uint32_t>(i));
+        maxWords = std::max(maxWords, commands[i].words);
+    }
+
+    std::vector<size_t> order(bucketCount);
+    for (size_t b = 0; b < bucketCount; ++b) order[b] = b;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+    while (true) {
+        displacement.assign(bucketCount, 0);
+        slots.assign(tableSize, -1);
+        bool placedAll = true;
+
+        for (size_t b : order) {
+            const std::vector<uint32_t>& bucket = buckets[b];
+            if (bucket.empty()) break;
+
+            bool placed = false;
+            for (uint32_t d = 0; d < 4096 && !placed; ++d) {
+                displacement[b] = d;
+                std::vector<size_t> taken;
+                placed = true;
+                for (uint32_t idx : bucket) {
+                    size_t slot = slotFor(commands[idx].hash);
+                    if (slots[slot] != -1 || std::find(taken.begin(), taken.end(), slot) != taken.end()) {
+                        placed = false;
+                        break;
+                    }
+                    taken.push_back(slot);
+                }
+                if (placed) {
+                    for (size_t k = 0; k < bucket.size(); ++k) slots[taken[k]] = static_cast<int32_t>(bucket[k]);
+                }
+            }
+            if (!placed) {
+                placedAll = false;
+                break;
+            }
+        }
+
+        if (placedAll) return;
+        tableSize <<= 1;  // extremely unlikely: retry with more room
+    }
+}
+
+// Private method that finds the command named exactly by "words"
+const CommandRegistry::Command* CommandRegistry::lookup(const std::string_view* words, int count) const {
+    if (slots.empty()) return NULL;
+
+    uint64_t h = hashWords(words, count);
+    int32_t idx = slots[slotFor(h)];
+    if (idx < 0) return NULL;
+
+    const Command& cmd = commands[idx];
+    if (cmd.hash != h || cmd.words != count) return NULL;
+
+    // Confirm the match word by word (case-insensitive), no copy needed
+    size_t pos = 0;
+    for (int w = 0; w < count; ++w) {
+        if (w > 0) ++pos;  // the single space stored between words
+        const std::string_view& word = words[w];
+        if (pos + word.size() > cmd.name.size()) return NULL;
+        for (size_t i = 0; i < word.size(); ++i) {
+            if (lowerAscii(static_cast<unsigned char>(word[i])) != static_cast<unsigned char>(cmd.name[pos + i])) return NULL;
+        }
+        pos += word.size();
+    }
+    return pos == cmd.name.size() ? &cmd : NULL;
+}
+
+const CommandRegistry::Command* CommandRegistry::match(CommandContext& ctx) const {
+    std::string_view words[MAX_NAME_WORDS];
+    int count = splitWords(ctx.line, words, std::min(maxWords, MAX_NAME_WORDS));
+
+    // Longest registered name wins ("open youtube" before a hypothetical "open")
+    for (int k = count; k > 0; --k) {
+        const Command* cmd = lookup(words, k);
+        if (cmd == NULL) continue;
+
+        const char* rest = words[k - 1].data() + words[k - 1].size();
+        std::string_view argLine = ctx.line.substr(rest - ctx.line.data());
+        size_t first = 0;
+        while (first < argLine.size() && isSpace(argLine[first])) ++first;
+        size_t last = argLine.size();
+        while (last > first && isSpace(argLine[last - 1])) --last;
+        argLine = argLine.substr(first, last - first);
+
+        ctx.name = cmd->name;
+        ctx.argLine = argLine;
+        ctx.args.clear();
+        size_t i = 0;
+        while (i < argLine.size()) {
+            while (i < argLine.size() && isSpace(argLine[i])) ++i;
+            if (i == argLine.size()) break;
+            size_t start = i;
+            while (i < argLine.size() && !isSpace(argLine[i])) ++i;
+            ctx.args.push_back(argLine.substr(start, i - start));
+        }
+        return cmd;
+    }
+    return NULL;
+}
+
+std::string CommandRegistry::helpText() const {
+    std::string out;
+    for (size_t i = 0; i < commands.size(); ++i) {
+        out += commands[i].name;
+        if (!commands[i].help.empty()) out += " - " + commands[i].help;
+        out += '\n';
+    }
+    return out;
+}
+
+std::string CommandRegistry::opcodeTable() const {
+    std::string out;
+    for (size_t i = 0; i < commands.size(); ++i) {
+        out += std::to_string(commands[i].opcode) + " " + commands[i].name + "\n";
+    }
+    return out;
+}
@@ -0,0 +1,307 @@
+#include "../header/Commands.hpp"
+#include "../header/Logger.hpp"
+#include <cstdlib>  // For system(), strtol()
+#include <string>     // For std::string
+#include <vector>
+#include <set>
+
+// Volume change of one vol+ / vol- command, in percent
+static const int VOLUME_STEP = 5;
+
+// Function to increase the volume by steps x 5%
+void increaseVolume(VolumeBackend& volume, int steps) {
+    LOG_INFO("Increasing volume by ", steps * VOLUME_STEP, "%...");
+    volume.adjust(steps * VOLUME_STEP);
+}
+
+void decreaseVolume(VolumeBackend& volume, int steps) {
+    LOG_INFO("Decreasing volume by ", steps * VOLUME_STEP, "%...");
+    volume.adjust(-steps * VOLUME_STEP);
+}
+
+// Options for the volume steps: a burst of vol+ / vol- is summed into one change
+static CommandOptions volumeStep(int step) {
+    CommandOptions options;
+    options.coalesce = COALESCE_ADD;
+    options.coalesceKey = "volume";
+    options.step = step;
+    options.priority = PRIORITY_INTERACTIVE;
+    return options;
+}
+
+// Options for quick commands that must answer at once even while a client
+// floods the slow ones
+static CommandOptions interactive() {
+    CommandOptions options;
+    options.priority = PRIORITY_INTERACTIVE;
+    return options;
+}
+
+// Options for open / close of one app: in a burst only the final state matters.
+// Each start or stop of a browser is costly, so they are limited to "rate".
+static CommandOptions appState(const std::string& app, const RateLimit& rate) {
+    CommandOptions options;
+    options.coalesce = COALESCE_LAST;
+    options.coalesceKey = "app:" + app;
+    options.priority = PRIORITY_HEAVY;
+    options.rate = rate;
+    return options;
+}
+
+// Replies and returns true if "app" is already starting / running, so a repeated
+// "open" does not start a second browser on the same profile
+static bool alreadyOpen(AppRegistry& apps, const std::string& app, CommandContext& ctx) {
+    AppRegistry::AppState current;
+    if (apps.beginOpen(app, current)) return false;
+    ctx.reply(current.title + " is already open" +
+              (current.pid > 0 ? " (pid " + std::to_string(current.pid) + ").\n" : ".\n"));
+    return true;
+}
+
+// Registers "open <app>" / "close <app>" for one configured browser app.
+// The lambdas keep their own copy of the app settings: a reload builds new
+// commands instead of changing these.
+static void addBrowserApp(CommandRegistry& registry, CommandServices& services, const AppConfig& app,
+                          const RateLimit& rate) {
+    BrowserPool& browsers = services.browsers;
+    ProcessControl& control = services.control;
+    AppRegistry& apps = services.apps;
+    std::string name = app.name;
+    std::string title = app.title;
+    std::string url = app.url;
+    std::string profileDir = app.profileDir;
+    std::string reply = app.reply;
+
+    registry.add("open " + name, [&browsers, &apps, name, title, url, reply](CommandContext& ctx) {
+        if (alreadyOpen(apps, name, ctx)) return;
+        LOG_INFO("Opening ", title, "...");
+
+        pid_t pid = 0;
+        #ifdef _WIN32
+            system(("start " + url).c_str());
+        #elif __APPLE__
+            system(("open " + url).c_str());
+        #elif __linux__
+            pid = browsers.open(name);
+        #endif
+        apps.opened(name, pid);
+        if (!reply.empty()) ctx.reply(reply + "\n");
+    }, "launch " + title, appState(name, rate));
+
+    // Closing may scan /proc for processes of an earlier server run: on a worker
+    CommandOptions closeOptions = appState(name, rate);
+    closeOptions.worker = true;
+    registry.add("close " + name, [&control, &apps, name, title, profileDir](CommandContext&) {
+        LOG_INFO("Closing ", title, "...");
+
+        int signalled = 0;
+        #ifdef _WIN32
+            system("taskkill /F /IM chrome.exe");
+        #elif __APPLE__
+            system("pkill -f 'Google Chrome'");
+        #elif __linux__
+            // Processes we launched are found by session; leftovers by their profile directory
+            signalled = control.terminateSession(name, profileDir);
+        #endif
+        apps.closing(name, signalled > 0);
+    }, "close " + title, closeOptions);
+}
+
+// Registers every built-in command.
+/*
+    Each command is a small lambda. To add a command, register it here (or from any
+    other module holding the registry); the dispatcher never needs to change.
+
+    Handlers run on the reactor thread that received the command unless
+    registered with CommandOptions::worker. With several reactor threads the
+    same handler can run on two of them at once: the launcher, browser pool,
+    process control, app registry and volume backend are thread-safe,
+    ctx.server is the calling thread's own reactor. Worker handlers must only
+    use ctx.reply().
+
+    Called again for every configuration reload, with a fresh registry.
+    The fixed commands are registered first and the configured apps last, so
+    the binary-protocol opcodes of the fixed commands never change.
+*/
+void registerBuiltinCommands(CommandRegistry& registry, CommandServices& services, const Config& config) {
+    VolumeBackend& volume = services.volume;
+    AppRegistry& apps = services.apps;
+
+    registry.add("vol+", [&volume](CommandContext& ctx) {
+        increaseVolume(volume, ctx.count);
+    }, "raise the volume by 5%", volumeStep(+1));
+
+    registry.add("vol-", [&volume](CommandContext& ctx) {
+        decreaseVolume(volume, ctx.count);
+    }, "lower the volume by 5%", volumeStep(-1));
+
+    registry.add("vol set", [&volume](CommandContext& ctx) {
+        char* end = NULL;
+        std::string arg = ctx.args.empty() ? std::string() : std::string(ctx.args[0]);
+        long percent = strtol(arg.c_str(), &end, 10);
+        if (arg.empty() || *end != '\0' || percent < 0 || percent > 100) {
+            ctx.reply("Usage: vol set <0-100>\n");
+        } else if (!volume.set(static_cast<int>(percent))) {
+            ctx.reply(std::string("The ") + volume.name() + " volume backend cannot set an absolute level.\n");
+        } else {
+            ctx.reply("Volume: " + std::to_string(percent) + "%\n");
+        }
+    }, "set the volume to N percent", interactive());
+
+    registry.add("vol get", [&volume](CommandContext& ctx) {
+        int percent = volume.get();
+        int muted = volume.muted();
+        if (percent < 0) {
+            ctx.reply(std::string("The ") + volume.name() + " volume backend cannot report the level.\n");
+        } else {
+            ctx.reply("Volume: " + std::to_string(percent) + "%" + (muted == 1 ? " (muted)" : "") + "\n");
+        }
+    }, "report the current volume", interactive());
+
+    registry.add("mute", [&volume](CommandContext& ctx) {
+        if (!volume.setMuted(true)) ctx.reply(std::string("The ") + volume.name() + " volume backend cannot mute.\n");
+    }, "mute the sound", interactive());
+
+    registry.add("unmute", [&volume](CommandContext& ctx) {
+        if (!volume.setMuted(false)) ctx.reply(std::string("The ") + volume.name() + " volume backend cannot unmute.\n");
+    }, "unmute the sound", interactive());
+
+    // Capture and encoding take a while: run them on a worker. The image is
+    // sent after the header line ("Screenshot: png 1280x720, 53211 bytes"),
+    // streamed in chunks by the dispatcher.
+    CommandOptions screenshotOptions;
+    screenshotOptions.worker = true;
+    screenshotOptions.maxConcurrent = config.screenshotLimit;
+    screenshotOptions.priority = PRIORITY_HEAVY;
+
+    ScreenshotService& screenshots = services.screenshots;
+    screenshots.setCacheTime(config.screenshotCacheMs);
+    registry.add("screenshot", [&screenshots](CommandContext& ctx) {
+        char* end = NULL;
+        std::string arg = ctx.args.empty() ? std::string("0") : std::string(ctx.args[0]);
+        long maxWidth = strtol(arg.c_str(), &end, 10);
+        if (*end != '\0' || maxWidth < 0 || maxWidth > 16384) {
+            ctx.reply("Usage: screenshot [max width]\n");
+            return;
+        }
+
+        ScreenshotService::Shot shot;
+        if (!screenshots.take(static_cast<int>(maxWidth), shot)) {
+            ctx.reply("Screenshot failed.\n");
+            return;
+        }
+        LOG_INFO("Screenshot ", shot.width, "x", shot.height, shot.cached ? " (cached)" : "", ".");
+        ctx.reply(std::string("Screenshot: ") + shot.format + " " + std::to_string(shot.width) + "x" +
+                  std::to_string(shot.height) + ", " + std::to_string(shot.data->size()) + " bytes\n");
+        ctx.attachment = shot.data;
+    }, "capture the screen and send the image (screenshot [max width])", screenshotOptions);
+
+    // Live view: delta frames at a rate that follows what the client reads.
+    // Runs on the event loop (it only sets up a timer); frames are encoded on workers.
+    ScreenStreamer& streamer = services.streamer;
+    int defaultFps = config.streamFps;
+    registry.add("stream", [&streamer, defaultFps](CommandContext& ctx) {
+        long values[2] = { defaultFps, 0 };
+        for (size_t i = 0; i < ctx.args.size(); ++i) {
+            std::string arg(ctx.args[i]);
+            char* end = NULL;
+            if (i < 2) values[i] = strtol(arg.c_str(), &end, 10);
+            if (i >= 2 || *end != '\0' || values[i] < 0 || values[i] > 16384 || (i == 0 && values[0] == 0)) {
+                ctx.reply("Usage: stream [fps] [max width] | stream stop\n");
+                return;
+            }
+        }
+
+        int fps = values[0] > ScreenStreamer::MAX_FPS ? ScreenStreamer::MAX_FPS : static_cast<int>(values[0]);
+        bool restart = streamer.active(ctx.server, ctx.client);
+        if (!streamer.start(ctx.server, ctx.client, ctx.binary, ctx.requestId, fps, static_cast<int>(values[1]))) {
+            ctx.reply("Stream failed.\n");
+            return;
+        }
+        LOG_INFO("Streaming to client ", ctx.client, " at ", fps, " fps.");
+        ctx.reply("Streaming at " + std::to_string(fps) + " fps.\n");
+        ctx.partial = !restart;   // binary: the frames follow on this request id
+    }, "send the screen live until \"stream stop\" (stream [fps] [max width])");
+
+    registry.add("stream stop", [&streamer](CommandContext& ctx) {
+        ctx.reply(streamer.stop(ctx.server, ctx.client) ? "Stream stopped.\n" : "No stream running.\n");
+    }, "stop sending the live screen", interactive());
+
+    // Anyone on the network can reach the port: only local clients may stop
+    // the server unless remote_exit is set (SIGTERM works as well)
+    bool remoteExit = config.remoteExit;
+    registry.add("exit", [&services, remoteExit](CommandContext& ctx) {
+        if (!remoteExit && !ctx.server.isLoopback(ctx.client)) {
+            LOG_WARN("Refused exit from ", ctx.server.peerName(ctx.client), ".");
+            ctx.reply("exit is only accepted from this machine.\n");
+            return;
+        }
+        LOG_INFO("Shutting down server.");
+        if (services.shutdown) services.shutdown(); // Drain every event loop and end the server
+        else ctx.server.stop();
+        ctx.acknowledge = false;
+    }, "stop the server (local clients only)", interactive());
+
+    registry.add("status", [&apps](CommandContext& ctx) {
+        std::string filter = ctx.args.empty() ? std::string() : std::string(ctx.args[0]);
+        std::vector<AppRegistry::AppState> states = apps.snapshot();
+        std::string text;
+        for (size_t i = 0; i < states.size(); ++i) {
+            if (filter.empty() || states[i].name == filter) text += AppRegistry::describe(states[i]) + "\n";
+        }
+        if (text.empty()) text = filter.empty() ? "No apps configured.\n" : "Unknown app: " + filter + "\n";
+        ctx.reply(text);
+    }, "show which apps are open (status [app])", interactive());
+
+    registry.add("help", [&registry](CommandContext& ctx) {
+        ctx.reply(registry.helpText());
+    }, "list the available commands", interactive());
+
+    // Protocol negotiation: the next bytes of this connection are binary frames
+    registry.add("binary", [](CommandContext& ctx) {
+        ctx.server.setFraming(ctx.client, FrameParser::VARINT_PREFIXED);
+        ctx.reply("Binary protocol enabled.\n");
+        ctx.acknowledge = false;
+    }, "switch this connection to the binary protocol", interactive());
+
+    // Remote mouse / keyboard: the next bytes of this connection are input
+    // messages (see InputChannel.hpp), injected without replies
+    InputSink* input = services.input;
+    registry.add("input", [input](CommandContext& ctx) {
+        if (input == NULL) {
+            ctx.reply("Remote input is off.\n");
+            return;
+        }
+        ctx.server.setFraming(ctx.client, FrameParser::FIXED_SIZE);
+        ctx.reply("Input mode enabled.\n");
+        ctx.acknowledge = false;
+    }, "switch this connection to remote mouse / keyboard messages", interactive());
+
+    registry.add("input status", [input](CommandContext& ctx) {
+        ctx.reply(input == NULL ? std::string("Remote input is off.\n") : input->status());
+    }, "show the remote input backend and what it injected", interactive());
+
+    // Protocol negotiation: the next commands of this connection come as
+    // length-prefixed frames (4-byte big-endian length, then the command text),
+    // so a command may contain newlines; replies stay text
+    registry.add("framed", [](CommandContext& ctx) {
+        ctx.server.setFraming(ctx.client, FrameParser::LENGTH_PREFIXED);
+        ctx.reply("Length-prefixed framing enabled.\n");
+        ctx.acknowledge = false;
+    }, "switch this connection to length-prefixed commands", interactive());
+
+    // One open / close pair per configured browser app
+    std::vector<BrowserPool::Profile> profiles;
+    std::set<std::string> names;
+    for (size_t i = 0; i < config.apps.size(); ++i) {
+        const AppConfig& app = config.apps[i];
+        BrowserPool::Profile profile = { app.name, app.profileDir, app.url, app.flags, app.title };
+        profiles.push_back(profile);
+        names.insert(app.name);
+        apps.add(app.name, app.title, app.profileDir);
+        addBrowserApp(registry, services, app, config.appRate);
+    }
+    services.browsers.setExecutable(config.browser);
+    services.browsers.setProfiles(profiles);
+    apps.retainOnly(names);
+}
@@ -0,0 +1,241 @@
+#include "../header/Config.hpp"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+// Helper removing leading / trailing blanks
+static std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return std::string();
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+// Helper splitting a value on blanks ("--kiosk --disable-gpu")
+static std::vector<std::string> splitWords(const std::string& text) {
+    std::vector<std::string> words;
+    std::istringstream in(text);
+    std::string word;
+    while (in >> word) words.push_back(word);
+    return words;
+}
+
+// Helper parsing a non-negative integer value
+static bool parseNumber(const std::string& text, long& value) {
+    char* end = NULL;
+    value = strtol(text.c_str(), &end, 10);
+    return !text.empty() && *end == '\0' && value >= 0;
+}
+
+static bool parseFlag(const std::string& text, bool& value) {
+    if (text == "true" || text == "yes" || text == "1") value = true;
+    else if (text == "false" || text == "no" || text == "0") value = false;
+    else return false;
+    return true;
+}
+
+// Helper parsing a rate limit: "N/s", "N/min" or "N/h" ("0" = no limit)
+static bool parseRate(const std::string& text, RateLimit& rate) {
+    size_t slash = text.find('/');
+    long count = 0;
+    if (!parseNumber(text.substr(0, slash), count) || count > 1000000) return false;
+    rate.count = static_cast<int>(count);
+    rate.seconds = 1;
+    if (slash == std::string::npos) return count == 0;
+    std::string unit = text.substr(slash + 1);
+    if (unit == "min") rate.seconds = 60;
+    else if (unit == "h") rate.seconds = 3600;
+    else return unit == "s";
+    return true;
+}
+
+// Helper building one app definition
+static AppConfig makeApp(const char* name, const char* title, const char* profileDir, const char* url,
+                         const char* windowFlag, const char* reply) {
+    AppConfig app;
+    app.name = name;
+    app.title = title;
+    app.profileDir = profileDir;
+    app.url = url;
+    app.flags.push_back(windowFlag);        // --kiosk or --start-fullscreen
+    app.flags.push_back("--disable-gpu");   // Optional: helps reduce GPU warnings
+    app.reply = reply;
+    return app;
+}
+
+Config Config::defaults() {
+    Config config;
+    config.apps.push_back(makeApp("facebook", "Facebook", "/tmp/fb_session", "https://facebook.com", "--kiosk", ""));
+    config.apps.push_back(makeApp("youtube", "YouTube", "/tmp/youtube_session", "https://www.youtube.com/", "--kiosk",
+                                  "YouTube opened. You can now search songs using: play <song name>"));
+    config.apps.push_back(makeApp("github", "GitHub", "/tmp/github_session", "https://github.com", "--kiosk", ""));
+    // --start-fullscreen instead of --kiosk: allows fullscreen with minimize
+    config.apps.push_back(makeApp("gmail", "Gmail", "/tmp/gmail_session", "https://mail.google.com/mail",
+                                  "--start-fullscreen", ""));
+    return config;
+}
+
+bool Config::load(const std::string& path, Config& config, std::string& error) {
+    std::ifstream file(path.c_str());
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    return parse(text.str(), config, error);
+}
+
+// Public method parsing the configuration text
+/*
+    The result is built in a local Config and only copied out once the whole
+    file parsed, so a half-edited file never replaces a working configuration.
+    Keys that are not in the file keep their default values; a file without
+    any [app] section keeps the built-in apps.
+*/
+bool Config::parse(const std::string& text, Config& config, std::string& error) {
+    Config parsed = defaults();
+    bool hasApps = false;
+    AppConfig* app = NULL;
+    std::istringstream in(text);
+    std::string raw;
+    int lineNo = 0;
+
+    while (std::getline(in, raw)) {
+        ++lineNo;
+        std::string line = trim(raw.substr(0, raw.find('#')));
+        if (line.empty()) continue;
+        std::string where = "line " + std::to_string(lineNo) + ": ";
+
+        // Section header: [app <name>]
+        if (line[0] == '[') {
+            std::vector<std::string> words = splitWords(line.substr(1, line.size() - (line.back() == ']' ? 2 : 1)));
+            if (line.back() != ']' || words.size() != 2 || words[0] != "app") {
+                error = where + "expected [app <name>]";
+                return false;
+            }
+            if (!hasApps) parsed.apps.clear();  // the file defines its own apps
+            hasApps = true;
+            if (parsed.findApp(words[1]) != NULL) {
+                error = where + "app " + words[1] + " is defined twice";
+                return false;
+            }
+            parsed.apps.push_back(AppConfig());
+            app = &parsed.apps.back();
+            app->name = words[1];
+            app->title = words[1];
+            continue;
+        }
+
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            error = where + "expected key = value";
+            return false;
+        }
+        std::string key = trim(line.substr(0, eq));
+        std::string value = trim(line.substr(eq + 1));
+        long number = 0;
+        bool ok = true;
+
+        if (app != NULL) {
+            if (key == "title") app->title = value;
+            else if (key == "profile") app->profileDir = value;
+            else if (key == "url") app->url = value;
+            else if (key == "flags") app->flags = splitWords(value);
+            else if (key == "reply") app->reply = value;
+            else ok = false;
+        } else if (key == "port") {
+            ok = parseNumber(value, number) && number > 0 && number < 65536;
+            parsed.port = static_cast<int>(number);
+        } else if (key == "metrics_port") {
+            ok = parseNumber(value, number) && number < 65536;
+            parsed.metricsPort = static_cast<int>(number);
+        } else if (key == "threads") {
+            ok = parseNumber(value, number);
+            parsed.threads = static_cast<int>(number);
+        } else if (key == "pin_cpus") {
+            ok = parseFlag(value, parsed.pinCpus);
+        } else if (key == "warm_browsers") {
+            ok = parseFlag(value, parsed.warmBrowsers);
+        } else if (key == "worker_queue") {
+            ok = parseNumber(value, number) && number > 0;
+            parsed.workerQueue = static_cast<size_t>(number);
+        } else if (key == "outbox_limit") {
+            ok = parseNumber(value, number) && number > 0;
+            parsed.outboxLimit = static_cast<size_t>(number);
+        } else if (key == "idle_timeout") {
+            ok = parseNumber(value, number);
+            parsed.idleTimeout = static_cast<int>(number);
+        } else if (key == "tcp_nodelay") {
+            ok = parseFlag(value, parsed.tcpNoDelay);
+        } else if (key == "keepalive") {
+            ok = parseNumber(value, number);
+            parsed.keepAlive = static_cast<int>(number);
+        } else if (key == "handoff_socket") {
+            parsed.handoffSocket = value;
+        } else if (key == "io_backend") {
+            ok = value == "epoll" || value == "io_uring";
+            parsed.ioBackend = value;
+        } else if (key == "drain_timeout") {
+            ok = parseNumber(value, number);
+            parsed.drainTimeout = static_cast<int>(number);
+        } else if (key == "remote_exit") {
+            ok = parseFlag(value, parsed.remoteExit);
+        } else if (key == "client_rate") {
+            ok = parseRate(value, parsed.clientRate);
+        } else if (key == "client_heavy_rate") {
+            ok = parseRate(value, parsed.clientHeavyRate);
+        } else if (key == "app_rate") {
+            ok = parseRate(value, parsed.appRate);
+        } else if (key == "input_backend") {
+            ok = value.empty() || value == "uinput" || value == "mock" || value == "off";
+            parsed.inputBackend = value;
+        } else if (key == "input_udp_port") {
+            ok = parseNumber(value, number) && number < 65536;
+            parsed.inputUdpPort = static_cast<int>(number);
+        } else if (key == "capture_file") {
+            parsed.captureFile = value;
+        } else if (key == "capture_limit_mb") {
+            ok = parseNumber(value, number);
+            parsed.captureLimitMb = static_cast<int>(number);
+        } else if (key == "screenshot_source") {
+            parsed.screenshotSource = value;
+        } else if (key == "screenshot_cache_ms") {
+            ok = parseNumber(value, number);
+            parsed.screenshotCacheMs = static_cast<int>(number);
+        } else if (key == "stream_fps") {
+            ok = parseNumber(value, number) && number > 0;
+            parsed.streamFps = static_cast<int>(number);
+        } else if (key == "browser") {
+            ok = !value.empty();
+            parsed.browser = value;
+        } else if (key == "screenshot_limit") {
+            ok = parseNumber(value, number);
+            parsed.screenshotLimit = static_cast<int>(number);
+        } else {
+            error = where + "unknown setting \"" + key + "\"";
+            return false;
+        }
+        if (!ok) {
+            error = where + "bad value for " + key + ": \"" + value + "\"";
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < parsed.apps.size(); ++i) {
+        if (parsed.apps[i].url.empty() || parsed.apps[i].profileDir.empty()) {
+            error = "app " + parsed.apps[i].name + " needs a url and a profile";
+            return false;
+        }
+    }
+
+    config = parsed;
+    return true;
+}
+
+const AppConfig* Config::findApp(const std::string& name) const {
+    for (size_t i = 0; i < apps.size(); ++i) {
+        if (apps[i].name == name) return &apps[i];
+    }
+    return NULL;
+}
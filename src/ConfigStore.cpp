@@ -0,0 +1,128 @@
+#include "../header/ConfigStore.hpp"
+#include "../header/Logger.hpp"
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <sys/inotify.h>
+#include <sys/epoll.h>
+
+// Snapshot used by the calling thread and the version it was published as
+struct ThreadView {
+    ConfigStore::Snapshot snapshot;
+    uint64_t version = 0;
+};
+static thread_local ThreadView threadView;
+
+ConfigStore::ConfigStore() : published(0), signal_fd(-1), inotify_fd(-1) {}
+
+ConfigStore::~ConfigStore() {
+    if (signal_fd >= 0) close(signal_fd);
+    if (inotify_fd >= 0) close(inotify_fd);
+}
+
+// Public method installing a new configuration
+/*
+    The old snapshot is not freed here: threads still using it keep it alive
+    through their own reference until their next refresh().
+*/
+void ConfigStore::publish(Snapshot next) {
+    std::lock_guard<std::mutex> guard(lock);
+    latest = next;
+    published.fetch_add(1, std::memory_order_release);
+}
+
+const RuntimeConfig& ConfigStore::current() {
+    if (!threadView.snapshot) refresh();
+    return *threadView.snapshot;
+}
+
+ConfigStore::Snapshot ConfigStore::currentShared() {
+    if (!threadView.snapshot) refresh();
+    return threadView.snapshot;
+}
+
+// Public method moving the calling thread to the newest snapshot
+/*
+    The common case (nothing published since the last call) is a single
+    atomic load. The lock is only taken once per thread and reload.
+*/
+void ConfigStore::refresh() {
+    uint64_t newest = published.load(std::memory_order_acquire);
+    if (newest == threadView.version && threadView.snapshot) return;
+
+    std::lock_guard<std::mutex> guard(lock);
+    threadView.snapshot = latest;
+    threadView.version = published.load(std::memory_order_relaxed);
+}
+
+// Public method registering the reload triggers with the event loop
+/*
+    SIGHUP arrives through a signalfd, like SIGCHLD in ProcessLauncher. The file
+    is watched through its directory: editors often write a new file and rename
+    it over the old one, which replaces the inode a watch on the file would follow.
+*/
+bool ConfigStore::attach(TcpServer& server, const std::string& path, const ReloadHandler& reload) {
+    onReload = reload;
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGHUP);
+    if (pthread_sigmask(SIG_BLOCK, &mask, NULL) != 0) {
+        LOG_ERROR("sigprocmask failed: ", strerror(errno));
+        return false;
+    }
+    signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd < 0) {
+        LOG_ERROR("signalfd failed: ", strerror(errno));
+        return false;
+    }
+    if (!server.watchFd(signal_fd, EPOLLIN, [this](uint32_t) { onSignal(); })) return false;
+
+    if (path.empty()) return true;
+
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    fileName = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0 || inotify_add_watch(inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        LOG_WARN("Cannot watch ", dir, " for config changes: ", strerror(errno), " (SIGHUP still reloads)");
+        return true;
+    }
+    return server.watchFd(inotify_fd, EPOLLIN, [this](uint32_t) { onFileEvent(); });
+}
+
+// Private method called when the signalfd is readable
+void ConfigStore::onSignal() {
+    struct signalfd_siginfo info;
+    bool hangup = false;
+    while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) hangup = true;
+    if (hangup && onReload) {
+        LOG_INFO("SIGHUP received, reloading configuration.");
+        onReload();
+    }
+}
+
+// Private method called when the watched directory changed
+/*
+    read() returns a packed list of struct inotify_event, each followed by
+    "len" bytes holding the (NUL-padded) name of the file in the directory.
+*/
+void ConfigStore::onFileEvent() {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    ssize_t n;
+    while ((n = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+        for (char* p = buffer; p < buffer + n; ) {
+            struct inotify_event* event = reinterpret_cast<struct inotify_event*>(p);
+            if (event->len > 0 && fileName == event->name) changed = true;
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    if (changed && onReload) {
+        LOG_INFO("Configuration file changed, reloading.");
+        onReload();
+    }
+}
@@ -0,0 +1,99 @@
+#include "../header/FrameParser.hpp"
+#include <stdint.h>
+
+// Size of the big-endian length header used by LENGTH_PREFIXED frames
+static const size_t LENGTH_HEADER = 4;
+
+// Longest varint length header of VARINT_PREFIXED frames (32-bit lengths)
+static const size_t VARINT_HEADER_MAX = 5;
+
+FrameParser::FrameParser(Mode mode, size_t maxFrame)
+    : framing(mode), maxFrame(maxFrame), pendingConsume(0), scanned(0) {}
+
+FrameParser::Result FrameParser::next(RingBuffer& in, std::string_view& frame) {
+    if (pendingConsume > 0) {
+        in.consume(pendingConsume);
+        pendingConsume = 0;
+    }
+    switch (framing) {
+    case NEWLINE:         return nextLine(in, frame);
+    case LENGTH_PREFIXED: return nextLengthPrefixed(in, frame);
+    case FIXED_SIZE:      return nextFixedSize(in, frame);
+    default:              return nextVarintPrefixed(in, frame);
+    }
+}
+
+void FrameParser::setMode(Mode mode) {
+    framing = mode;
+    scanned = 0;
+}
+
+// Private method for newline-delimited frames
+/*
+    Only bytes that arrived since the last call are searched (scanned keeps the
+    position), so a long line delivered in many small reads is scanned once.
+*/
+FrameParser::Result FrameParser::nextLine(RingBuffer& in, std::string_view& frame) {
+    size_t nl = in.find('\n', scanned);
+    if (nl == RingBuffer::npos) {
+        scanned = in.size();
+        return scanned > maxFrame ? TOO_LARGE : NEED_MORE;
+    }
+    if (nl > maxFrame) return TOO_LARGE;
+
+    size_t len = nl;
+    if (len > 0 && in.at(len - 1) == '\r') --len;  // accept "\r\n" line endings
+
+    frame = std::string_view(in.contiguous(0, len), len);
+    pendingConsume = nl + 1;
+    scanned = 0;
+    return FRAME;
+}
+
+// Private method for length-prefixed frames
+FrameParser::Result FrameParser::nextLengthPrefixed(RingBuffer& in, std::string_view& frame) {
+    if (in.size() < LENGTH_HEADER) return NEED_MORE;
+
+    uint32_t len = 0;
+    for (size_t i = 0; i < LENGTH_HEADER; ++i) {
+        len = (len << 8) | static_cast<unsigned char>(in.at(i));
+    }
+    if (len > maxFrame) return TOO_LARGE;
+    if (in.size() < LENGTH_HEADER + len) return NEED_MORE;
+
+    frame = std::string_view(in.contiguous(LENGTH_HEADER, len), len);
+    pendingConsume = LENGTH_HEADER + len;
+    return FRAME;
+}
+
+// Private method for varint-prefixed frames
+/*
+    A header longer than VARINT_HEADER_MAX bytes cannot describe an acceptable
+    frame, so it is reported as TOO_LARGE (the connection is closed).
+*/
+FrameParser::Result FrameParser::nextVarintPrefixed(RingBuffer& in, std::string_view& frame) {
+    uint64_t len = 0;
+    size_t header = 0;
+    for (;;) {
+        if (header == in.size()) return NEED_MORE;
+        if (header == VARINT_HEADER_MAX) return TOO_LARGE;
+        unsigned char byte = static_cast<unsigned char>(in.at(header));
+        len |= static_cast<uint64_t>(byte & 0x7F) << (7 * header);
+        ++header;
+        if ((byte & 0x80) == 0) break;
+    }
+    if (len > maxFrame) return TOO_LARGE;
+    if (in.size() < header + len) return NEED_MORE;
+
+    frame = std::string_view(in.contiguous(header, len), len);
+    pendingConsume = header + len;
+    return FRAME;
+}
+
+// Private method for fixed-size frames
+FrameParser::Result FrameParser::nextFixedSize(RingBuffer& in, std::string_view& frame) {
+    if (in.size() < FIXED_FRAME) return NEED_MORE;
+    frame = std::string_view(in.contiguous(0, FIXED_FRAME), FIXED_FRAME);
+    pendingConsume = FIXED_FRAME;
+    return FRAME;
+}
@@ -0,0 +1,107 @@
+#include "../header/FrameSource.hpp"
+#include "../header/Logger.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+// Generated test pattern: colour gradients with a bar that moves on every capture.
+/*
+    Rows differ from each other and the picture changes a little between
+    captures, like a real desktop with a blinking cursor, so encoders and
+    delta streaming see realistic work without an X server.
+*/
+class TestPatternSource : public FrameSource {
+public:
+    TestPatternSource(int width, int height) : width(width), height(height), barX(0) {}
+
+    const char* name() const { return "test"; }
+
+    bool capture(Frame& frame) {
+        int position;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            position = barX;
+            barX = (barX + 8) % width;
+        }
+        frame.width = width;
+        frame.height = height;
+        frame.rgb.resize(static_cast<size_t>(width) * height * 3);
+
+        uint8_t* out = frame.rgb.data();
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                bool bar = x >= position && x < position + 16;
+                *out++ = bar ? 255 : static_cast<uint8_t>(x * 255 / width);
+                *out++ = bar ? 255 : static_cast<uint8_t>(y * 255 / height);
+                *out++ = bar ? 255 : static_cast<uint8_t>(((x / 32) ^ (y / 32)) & 1 ? 160 : 64);
+            }
+        }
+        return true;
+    }
+
+private:
+    int width, height;
+    std::mutex lock;
+    int barX;                   // where the bar is drawn next, kept below width
+};
+
+// Reads a binary PPM file on every capture.
+/*
+    PPM needs no decoder library: a short text header ("P6 <width> <height>
+    255") followed by the raw RGB bytes, which is also what Xvfb's -fbdir
+    tools and ImageMagick ("convert screen.png screen.ppm") produce.
+*/
+class FileFrameSource : public FrameSource {
+public:
+    FileFrameSource(const std::string& path) : path(path) {}
+
+    const char* name() const { return "file"; }
+
+    bool capture(Frame& frame) {
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file == NULL) {
+            LOG_WARN("Cannot open frame file ", path, ": ", strerror(errno));
+            return false;
+        }
+        int width = 0, height = 0, maxValue = 0;
+        bool ok = fscanf(file, "P6 %d %d %d", &width, &height, &maxValue) == 3 && fgetc(file) != EOF &&
+                  width > 0 && height > 0 && width <= 16384 && height <= 16384 && maxValue == 255;
+        if (ok) {
+            frame.width = width;
+            frame.height = height;
+            frame.rgb.resize(static_cast<size_t>(width) * height * 3);
+            ok = fread(frame.rgb.data(), 1, frame.rgb.size(), file) == frame.rgb.size();
+        }
+        fclose(file);
+        if (!ok) LOG_WARN("Frame file ", path, " is not an 8-bit binary PPM image.");
+        return ok;
+    }
+
+private:
+    std::string path;
+};
+
+std::unique_ptr<FrameSource> createFrameSource(const std::string& kind) {
+    if (kind == "test") return std::unique_ptr<FrameSource>(new TestPatternSource(1280, 720));
+    if (kind.compare(0, 5, "file:") == 0) return std::unique_ptr<FrameSource>(new FileFrameSource(kind.substr(5)));
+
+#ifdef HAVE_X11
+    if (kind == "x11" || kind.empty()) {
+        std::unique_ptr<FrameSource> x11 = createX11FrameSource();
+        if (x11 || kind == "x11") return x11;
+        LOG_WARN("No X display, screenshots show a test pattern.");
+    }
+#else
+    if (kind == "x11") {
+        LOG_WARN("Built without X11 support.");
+        return std::unique_ptr<FrameSource>();
+    }
+    if (kind.empty()) LOG_WARN("Built without X11 support, screenshots show a test pattern.");
+#endif
+
+    if (kind.empty()) return std::unique_ptr<FrameSource>(new TestPatternSource(1280, 720));
+
+    LOG_WARN("Unknown screenshot source: ", kind);
+    return std::unique_ptr<FrameSource>();
+}
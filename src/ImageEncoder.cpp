@@ -0,0 +1,161 @@
+#include "../header/ImageEncoder.hpp"
+#include "../header/Logger.hpp"
+#include <string.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+const char* ImageEncoder::format() {
+#ifdef HAVE_ZLIB
+    return "png";
+#else
+    return "ppm";
+#endif
+}
+
+// Public method reducing the resolution by an integer factor
+/*
+    A box filter over whole factor x factor blocks keeps the inner loop to
+    additions and one division per channel; text stays readable, which
+    nearest-neighbour sampling would not give. Edge pixels that do not fill a
+    whole block are dropped.
+*/
+bool ImageEncoder::downscale(const Frame& in, int maxWidth, Frame& out) {
+    if (maxWidth <= 0 || in.width <= maxWidth) return false;
+    int factor = (in.width + maxWidth - 1) / maxWidth;
+    out.width = in.width / factor;
+    out.height = in.height / factor;
+    if (out.width == 0 || out.height == 0) return false;
+    out.rgb.resize(static_cast<size_t>(out.width) * out.height * 3);
+
+    const size_t stride = static_cast<size_t>(in.width) * 3;
+    const unsigned area = factor * factor;
+    uint8_t* dst = out.rgb.data();
+    for (int y = 0; y < out.height; ++y) {
+        const uint8_t* top = in.rgb.data() + static_cast<size_t>(y) * factor * stride;
+        for (int x = 0; x < out.width; ++x) {
+            unsigned r = 0, g = 0, b = 0;
+            for (int dy = 0; dy < factor; ++dy) {
+                const uint8_t* p = top + dy * stride + static_cast<size_t>(x) * factor * 3;
+                for (int dx = 0; dx < factor; ++dx, p += 3) {
+                    r += p[0];
+                    g += p[1];
+                    b += p[2];
+                }
+            }
+            *dst++ = static_cast<uint8_t>(r / area);
+            *dst++ = static_cast<uint8_t>(g / area);
+            *dst++ = static_cast<uint8_t>(b / area);
+        }
+    }
+    return true;
+}
+
+#ifdef HAVE_ZLIB
+// Helper appending a 32-bit big-endian number
+static void putBigEndian(std::string& out, uint32_t value) {
+    out += static_cast<char>(value >> 24);
+    out += static_cast<char>(value >> 16);
+    out += static_cast<char>(value >> 8);
+    out += static_cast<char>(value);
+}
+
+// Helper closing a PNG chunk that starts at "start" (length field) in "out"
+static void finishChunk(std::string& out, size_t start) {
+    uint32_t length = static_cast<uint32_t>(out.size() - start - 8);
+    for (int i = 0; i < 4; ++i) out[start + i] = static_cast<char>(length >> (24 - 8 * i));
+    const Bytef* type = reinterpret_cast<const Bytef*>(out.data() + start + 4);
+    putBigEndian(out, static_cast<uint32_t>(crc32(0, type, length + 4)));
+}
+
+// Private method writing a PNG file
+/*
+    Every row is stored with the "Sub" filter (each byte minus the byte of the
+    pixel to its left): flat desktop areas become runs of zeros that deflate
+    well even at its fastest level. Rows are filtered into one small scratch
+    row and fed to deflate one at a time, writing straight into "out".
+*/
+static bool encodePng(const Frame& frame, std::string& out) {
+    static const char SIGNATURE[] = "\x89PNG\r\n\x1a\n";
+    out.append(SIGNATURE, 8);
+
+    size_t chunk = out.size();
+    out.append("\0\0\0\0IHDR", 8);
+    putBigEndian(out, frame.width);
+    putBigEndian(out, frame.height);
+    out += static_cast<char>(8);   // bits per channel
+    out += static_cast<char>(2);   // colour type: RGB
+    out.append(3, '\0');           // deflate, adaptive filtering, no interlace
+    finishChunk(out, chunk);
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit(&zs, Z_BEST_SPEED) != Z_OK) return false;
+
+    const size_t rowBytes = static_cast<size_t>(frame.width) * 3;
+    chunk = out.size();
+    out.append("\0\0\0\0IDAT", 8);
+    size_t dataStart = out.size();
+    out.resize(dataStart + deflateBound(&zs, (rowBytes + 1) * frame.height));
+
+    std::string row(rowBytes + 1, '\0');
+    row[0] = 1;  // filter type: Sub
+    zs.next_out = reinterpret_cast<Bytef*>(&out[dataStart]);
+    zs.avail_out = static_cast<uInt>(out.size() - dataStart);
+
+    bool ok = true;
+    for (int y = 0; y < frame.height && ok; ++y) {
+        const uint8_t* src = frame.rgb.data() + y * rowBytes;
+        uint8_t* dst = reinterpret_cast<uint8_t*>(&row[1]);
+        for (size_t i = 0; i < 3 && i < rowBytes; ++i) dst[i] = src[i];
+        for (size_t i = 3; i < rowBytes; ++i) dst[i] = static_cast<uint8_t>(src[i] - src[i - 3]);
+
+        zs.next_in = reinterpret_cast<Bytef*>(&row[0]);
+        zs.avail_in = static_cast<uInt>(row.size());
+        ok = deflate(&zs, y + 1 == frame.height ? Z_FINISH : Z_NO_FLUSH) != Z_STREAM_ERROR && zs.avail_in == 0;
+    }
+    ok = ok && zs.avail_in == 0 && zs.total_out > 0;
+    out.resize(dataStart + zs.total_out);
+    deflateEnd(&zs);
+    if (!ok) return false;
+    finishChunk(out, chunk);
+
+    chunk = out.size();
+    out.append("\0\0\0\0IEND", 8);
+    finishChunk(out, chunk);
+    return true;
+}
+#endif
+
+bool ImageEncoder::compress(std::string& data, std::string& scratch) {
+#ifdef HAVE_ZLIB
+    uLongf length = compressBound(static_cast<uLong>(data.size()));
+    scratch.resize(length);
+    if (compress2(reinterpret_cast<Bytef*>(&scratch[0]), &length, reinterpret_cast<const Bytef*>(data.data()),
+                  static_cast<uLong>(data.size()), Z_BEST_SPEED) != Z_OK) {
+        return false;
+    }
+    scratch.resize(length);
+    data.swap(scratch);
+    return true;
+#else
+    (void)data;
+    (void)scratch;
+    return false;
+#endif
+}
+
+bool ImageEncoder::encode(const Frame& frame, std::string& out) {
+    if (frame.width <= 0 || frame.height <= 0) return false;
+#ifdef HAVE_ZLIB
+    if (!encodePng(frame, out)) {
+        LOG_WARN("PNG encoding failed.");
+        return false;
+    }
+    return true;
+#else
+    out += "P6\n" + std::to_string(frame.width) + " " + std::to_string(frame.height) + "\n255\n";
+    out.append(reinterpret_cast<const char*>(frame.rgb.data()), frame.rgb.size());
+    return true;
+#endif
+}
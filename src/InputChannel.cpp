@@ -0,0 +1,200 @@
+#include "../header/InputChannel.hpp"
+#include "../header/Metrics.hpp"
+#include "../header/Logger.hpp"
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+
+// Largest datagram read: 64 messages (longer ones are dropped as malformed)
+static const size_t MAX_DATAGRAM = 64 * InputChannel::MESSAGE_SIZE;
+
+// Helper reading a big-endian 16 / 32 bit number
+static uint32_t bigEndian(const unsigned char* bytes, size_t size) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < size; ++i) value = (value << 8) | bytes[i];
+    return value;
+}
+
+// Helper limiting a summed motion to what one event can carry
+static int32_t clampMotion(int64_t value) {
+    if (value > INT32_MAX) return INT32_MAX;
+    if (value < INT32_MIN) return INT32_MIN;
+    return static_cast<int32_t>(value);
+}
+
+InputChannel::InputChannel(InputSink& sink)
+    : sink(sink), moveX(0), moveY(0), wheelV(0), wheelH(0), moved(false), udp_fd(-1) {
+    pending.reserve(MAX_PENDING + 8);
+}
+
+InputChannel::~InputChannel() {
+    if (udp_fd >= 0) close(udp_fd);
+}
+
+void InputChannel::encode(std::string& out, Kind kind, uint16_t code, int32_t value) {
+    uint32_t bits = static_cast<uint32_t>(value);
+    char message[MESSAGE_SIZE] = { static_cast<char>(kind), 0, static_cast<char>(code >> 8), static_cast<char>(code),
+                                   static_cast<char>(bits >> 24), static_cast<char>(bits >> 16),
+                                   static_cast<char>(bits >> 8), static_cast<char>(bits) };
+    out.append(message, MESSAGE_SIZE);
+}
+
+// Public method decoding one message
+/*
+    Moves and wheel turns only add to the running motion; the events for it
+    are queued when something else comes or the batch is flushed. Keys and
+    buttons are queued at once, each as its own report.
+*/
+bool InputChannel::add(std::string_view message) {
+    if (message.size() != MESSAGE_SIZE) return false;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(message.data());
+    if (bytes[1] != 0) return false;
+    uint16_t code = static_cast<uint16_t>(bigEndian(bytes + 2, 2));
+    int32_t value = static_cast<int32_t>(bigEndian(bytes + 4, 4));
+    int16_t first = static_cast<int16_t>(bigEndian(bytes + 4, 2));
+    int16_t second = static_cast<int16_t>(bigEndian(bytes + 6, 2));
+
+    switch (bytes[0]) {
+    case KIND_MOVE:
+    case KIND_WHEEL:
+        if (code != 0) return false;
+        if (moved) Metrics::instance().add(Metrics::INPUT_MERGED);
+        if (bytes[0] == KIND_MOVE) {
+            moveX += first;
+            moveY += second;
+        } else {
+            wheelV += first;
+            wheelH += second;
+        }
+        moved = true;
+        break;
+    case KIND_BUTTON:
+        if (code > InputSink::LAST_BUTTON - BTN_LEFT || (value != 0 && value != 1)) return false;
+        press(static_cast<uint16_t>(BTN_LEFT + code), InputSink::MAX_KEY + 1 + code, value);
+        break;
+    case KIND_KEY:
+        if (code < 1 || code > InputSink::MAX_KEY || value < 0 || value > 2) return false;
+        press(code, code, value);
+        break;
+    default:
+        return false;
+    }
+
+    Metrics::instance().add(Metrics::INPUT_EVENTS);
+    if (pending.size() >= MAX_PENDING) flush();
+    return true;
+}
+
+void InputChannel::flush() {
+    endMotion();
+    if (pending.empty()) return;
+    sink.write(pending.data(), pending.size());
+    pending.clear();
+}
+
+void InputChannel::releaseAll() {
+    endMotion();
+    bool released = false;
+    for (size_t slot = 0; slot < held.size(); ++slot) {
+        if (!held[slot]) continue;
+        size_t code = slot <= static_cast<size_t>(InputSink::MAX_KEY) ? slot : BTN_LEFT + (slot - InputSink::MAX_KEY - 1);
+        push(EV_KEY, static_cast<uint16_t>(code), 0);
+        released = true;
+    }
+    held.reset();
+    if (released) push(EV_SYN, SYN_REPORT, 0);
+    flush();
+}
+
+// Private method queuing one event
+void InputChannel::push(uint16_t type, uint16_t code, int32_t value) {
+    struct input_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.type = type;
+    ev.code = code;
+    ev.value = value;
+    pending.push_back(ev);
+}
+
+// Private method queuing the summed motion as one report
+void InputChannel::endMotion() {
+    if (!moved) return;
+    moved = false;
+    if (moveX == 0 && moveY == 0 && wheelV == 0 && wheelH == 0) return;
+    if (moveX != 0) push(EV_REL, REL_X, clampMotion(moveX));
+    if (moveY != 0) push(EV_REL, REL_Y, clampMotion(moveY));
+    if (wheelV != 0) push(EV_REL, REL_WHEEL, clampMotion(wheelV));
+    if (wheelH != 0) push(EV_REL, REL_HWHEEL, clampMotion(wheelH));
+    push(EV_SYN, SYN_REPORT, 0);
+    moveX = moveY = wheelV = wheelH = 0;
+}
+
+// Private method queuing a key or button change after the motion before it
+void InputChannel::press(uint16_t code, size_t slot, int32_t value) {
+    endMotion();
+    push(EV_KEY, code, value);
+    push(EV_SYN, SYN_REPORT, 0);
+    held[slot] = value != 0;
+}
+
+// Public method opening the UDP input socket
+/*
+    Datagrams need no connection and no "input" command, and a lost one is
+    just a skipped bit of motion, which suits a trackpad on Wi-Fi.
+*/
+bool InputChannel::attach(TcpServer& loop, int port) {
+    udp_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (udp_fd < 0) {
+        LOG_ERROR("Input socket creation failed: ", strerror(errno));
+        return false;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port);
+    if (bind(udp_fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        LOG_ERROR("Input socket bind failed: ", strerror(errno));
+        return false;
+    }
+
+    LOG_INFO("Remote input on UDP port ", port);
+    return loop.watchFd(udp_fd, EPOLLIN, [this](uint32_t) { onDatagrams(); });
+}
+
+// Private method reading the waiting datagrams
+/*
+    int recvmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags, struct timespec* timeout);
+        Reads up to "vlen" datagrams with one system call; msg_len is the
+        size of each. MSG_TRUNC in msg_flags marks one longer than its buffer.
+
+    The socket is level-triggered: what is not read now wakes the loop again,
+    so one busy sender cannot hold the loop. Each wakeup ends with one flush().
+*/
+void InputChannel::onDatagrams() {
+    char buffers[UDP_BATCH][MAX_DATAGRAM];
+    struct iovec iov[UDP_BATCH];
+    struct mmsghdr messages[UDP_BATCH];
+    memset(messages, 0, sizeof(messages));
+    for (int i = 0; i < UDP_BATCH; ++i) {
+        iov[i].iov_base = buffers[i];
+        iov[i].iov_len = MAX_DATAGRAM;
+        messages[i].msg_hdr.msg_iov = &iov[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int received = recvmmsg(udp_fd, messages, UDP_BATCH, MSG_DONTWAIT, NULL);
+    for (int i = 0; i < received; ++i) {
+        size_t length = messages[i].msg_len;
+        bool valid = (messages[i].msg_hdr.msg_flags & MSG_TRUNC) == 0 && length > 0 && length % MESSAGE_SIZE == 0;
+        for (size_t offset = 0; valid && offset < length; offset += MESSAGE_SIZE) {
+            valid = add(std::string_view(buffers[i] + offset, MESSAGE_SIZE));
+        }
+        if (!valid) LOG_WARN("Malformed input datagram (", length, " bytes).");
+    }
+    flush();
+}
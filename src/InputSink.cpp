@@ -0,0 +1,143 @@
+#include "../header/InputSink.hpp"
+#include "../header/Logger.hpp"
+#include <cstring>
+#include <cerrno>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/uinput.h>
+
+// Name the virtual device shows up with (xinput list, libinput list-devices)
+static const char* DEVICE_NAME = "pc_controller remote input";
+
+static const char* UINPUT_PATH = "/dev/uinput";
+
+// Counts the events and follows the pointer, injects nothing
+class MockInputSink : public InputSink {
+public:
+    MockInputSink() : events(0), reports(0), writes(0), x(0), y(0), wheel(0), pressed(0) {}
+
+    const char* name() const { return "mock"; }
+
+    bool write(const struct input_event* list, size_t count) {
+        std::lock_guard<std::mutex> guard(lock);
+        ++writes;
+        events += count;
+        for (size_t i = 0; i < count; ++i) {
+            const struct input_event& ev = list[i];
+            if (ev.type == EV_SYN) ++reports;
+            else if (ev.type == EV_REL && ev.code == REL_X) x += ev.value;
+            else if (ev.type == EV_REL && ev.code == REL_Y) y += ev.value;
+            else if (ev.type == EV_REL && ev.code == REL_WHEEL) wheel += ev.value;
+            else if (ev.type == EV_KEY && ev.value == 1) ++pressed;
+        }
+        return true;
+    }
+
+    std::string status() {
+        std::lock_guard<std::mutex> guard(lock);
+        return "Input: mock, " + std::to_string(events) + " events in " + std::to_string(reports) + " reports, " +
+               std::to_string(writes) + " writes, pointer " + std::to_string(x) + "," + std::to_string(y) +
+               ", wheel " + std::to_string(wheel) + ", " + std::to_string(pressed) + " presses\n";
+    }
+
+private:
+    std::mutex lock;
+    unsigned long events;
+    unsigned long reports;
+    unsigned long writes;
+    long long x;
+    long long y;
+    long long wheel;
+    unsigned long pressed;
+};
+
+// Virtual mouse + keyboard created through /dev/uinput
+/*
+    The kernel serialises writes to one uinput descriptor and injects the
+    events of a write() together, so several reactor threads can share the
+    device without a lock. The timestamps are filled in by the kernel.
+*/
+class UinputSink : public InputSink {
+public:
+    UinputSink(int fd) : fd(fd) {}
+
+    ~UinputSink() {
+        ioctl(fd, UI_DEV_DESTROY);
+        close(fd);
+    }
+
+    const char* name() const { return "uinput"; }
+
+    bool write(const struct input_event* events, size_t count) {
+        size_t bytes = count * sizeof(struct input_event);
+        ssize_t n = ::write(fd, events, bytes);
+        if (n == static_cast<ssize_t>(bytes)) return true;
+        LOG_WARN("uinput write failed: ", n < 0 ? strerror(errno) : "short write");
+        return false;
+    }
+
+    std::string status() {
+        return std::string("Input: uinput device \"") + DEVICE_NAME + "\"\n";
+    }
+
+private:
+    int fd;
+};
+
+// Helper creating the uinput device; returns the descriptor or -1
+/*
+    int ioctl(int fd, UI_SET_EVBIT / UI_SET_KEYBIT / UI_SET_RELBIT, int code);
+        Declare the event types and codes the device can send. Events the
+        device did not declare are dropped by the input core.
+
+    int ioctl(int fd, UI_DEV_SETUP, struct uinput_setup* setup);
+    int ioctl(int fd, UI_DEV_CREATE);
+        Name the device and make it appear (/dev/input/eventN); from then on
+        every write() of input_event structs is an input report.
+*/
+static int createUinputDevice() {
+    int fd = open(UINPUT_PATH, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_WARN("Cannot open ", UINPUT_PATH, ": ", strerror(errno));
+        return -1;
+    }
+
+    bool ok = ioctl(fd, UI_SET_EVBIT, EV_KEY) == 0 && ioctl(fd, UI_SET_EVBIT, EV_REL) == 0 &&
+              ioctl(fd, UI_SET_EVBIT, EV_SYN) == 0;
+    for (int key = 1; ok && key <= InputSink::MAX_KEY; ++key) ok = ioctl(fd, UI_SET_KEYBIT, key) == 0;
+    for (int button = BTN_LEFT; ok && button <= InputSink::LAST_BUTTON; ++button) {
+        ok = ioctl(fd, UI_SET_KEYBIT, button) == 0;
+    }
+    const int axes[] = { REL_X, REL_Y, REL_WHEEL, REL_HWHEEL };
+    for (size_t i = 0; ok && i < sizeof(axes) / sizeof(axes[0]); ++i) ok = ioctl(fd, UI_SET_RELBIT, axes[i]) == 0;
+
+    struct uinput_setup setup;
+    memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_VIRTUAL;
+    setup.id.vendor = 0x1;
+    setup.id.product = 0x1;
+    strncpy(setup.name, DEVICE_NAME, UINPUT_MAX_NAME_SIZE - 1);
+    ok = ok && ioctl(fd, UI_DEV_SETUP, &setup) == 0 && ioctl(fd, UI_DEV_CREATE) == 0;
+    if (!ok) {
+        LOG_WARN("Creating the uinput device failed: ", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+std::unique_ptr<InputSink> createInputSink(const std::string& kind) {
+    if (kind == "mock") return std::unique_ptr<InputSink>(new MockInputSink());
+
+    if (kind == "uinput" || kind.empty()) {
+        int fd = createUinputDevice();
+        if (fd >= 0) return std::unique_ptr<InputSink>(new UinputSink(fd));
+        if (kind.empty()) LOG_WARN("uinput unavailable, remote input is off.");
+        return std::unique_ptr<InputSink>();
+    }
+
+    LOG_WARN("Unknown input backend: ", kind);
+    return std::unique_ptr<InputSink>();
+}
@@ -0,0 +1,394 @@
+#include "../header/IoUring.hpp"
+#include "../header/Logger.hpp"
+#include <cstring>
+#include <cstddef>
+#include <cerrno>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+
+// Helpers wrapping the io_uring system calls (glibc has no wrappers)
+static int ringSetup(unsigned entries, struct io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int ringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0));
+}
+
+static int ringRegister(int fd, unsigned opcode, void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+// Helper checking the running kernel is at least major.minor
+/*
+    Multishot recv (IORING_RECV_MULTISHOT) came with Linux 6.0. An older
+    kernel accepts the request and fails it later, so the version is checked
+    up front instead of finding out on the first client.
+*/
+static bool kernelAtLeast(int major, int minor) {
+    struct utsname name;
+    int haveMajor = 0, haveMinor = 0;
+    if (uname(&name) != 0 || sscanf(name.release, "%d.%d", &haveMajor, &haveMinor) != 2) return false;
+    return haveMajor > major || (haveMajor == major && haveMinor >= minor);
+}
+
+// Helpers addressing the shared buffer ring by its C layout
+/*
+    In C the ring is an array of io_uring_buf whose first entry doubles as
+    the header: "tail" sits in bufs[0].resv, at byte 14. The kernel header
+    declares "bufs" with __DECLARE_FLEX_ARRAY, whose empty wrapper struct
+    takes space in C++, so &ring->bufs[i] and &ring->tail are 8 bytes off
+    with g++. Entries and the tail are therefore reached through
+    io_uring_buf directly, as liburing's io_uring_buf_ring_add() does.
+*/
+static_assert(sizeof(struct io_uring_buf) == 16, "io_uring_buf must be 16 bytes");
+static_assert(offsetof(struct io_uring_buf, resv) == 14, "buffer ring tail must overlay bufs[0].resv");
+
+static struct io_uring_buf* ringEntry(struct io_uring_buf_ring* ring, unsigned index) {
+    return reinterpret_cast<struct io_uring_buf*>(ring) + index;
+}
+
+static uint16_t* ringTail(struct io_uring_buf_ring* ring) {
+    return &reinterpret_cast<struct io_uring_buf*>(ring)->resv;
+}
+
+// Completion queue size: multishot requests post many completions per submission
+static const unsigned CQ_ENTRIES = 4096;
+
+IoUring::IoUring()
+    : ring_fd(-1), sqRing(MAP_FAILED), sqRingSize(0), cqRing(MAP_FAILED), cqRingSize(0), sqes(NULL), sqesSize(0),
+      sqHead(NULL), sqTail(NULL), sqFlags(NULL), sqMask(0), sqEntries(0), cqHead(NULL), cqTail(NULL), cqMask(0), cqes(NULL),
+      sqeTail(0), submittedTail(0), bufRing(NULL), bufRingSize(0), buffers(NULL), buffersSize(0), bufferSize(0),
+      bufferMask(0), bufferGroup(0) {}
+
+IoUring::~IoUring() {
+    destroy();
+}
+
+// Private method releasing the ring and the buffers
+/*
+    The ring descriptor is closed before the buffer memory is unmapped: a
+    request the kernel is still finishing then writes to an unmapped address
+    (EFAULT) instead of memory that was reused.
+*/
+void IoUring::destroy() {
+    if (ring_fd >= 0) close(ring_fd);
+    ring_fd = -1;
+    if (sqes != NULL) munmap(sqes, sqesSize);
+    if (cqRing != MAP_FAILED && cqRing != sqRing) munmap(cqRing, cqRingSize);
+    if (sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+    if (bufRing != NULL) munmap(bufRing, bufRingSize);
+    if (buffers != NULL) munmap(buffers, buffersSize);
+    sqes = NULL;
+    sqRing = cqRing = MAP_FAILED;
+    bufRing = NULL;
+    buffers = NULL;
+}
+
+// Public method creating the rings
+/*
+    int io_uring_setup(u32 entries, struct io_uring_params* p);
+        Creates the instance and fills "p" with the offsets of the head, tail,
+        mask and array fields inside the two rings, which are then mmap()ed.
+
+        IORING_SETUP_CQSIZE    : a larger completion queue than 2x entries
+        IORING_SETUP_SUBMIT_ALL: one bad entry does not stop the rest of a batch
+
+    int io_uring_register(int fd, IORING_REGISTER_PROBE, ...);
+        Lists the opcodes this kernel supports.
+
+    The submission queue array is filled with 0..n-1 once: entries are always
+    used in order, so array[i] == i stays right.
+*/
+bool IoUring::init(unsigned entries) {
+    if (!kernelAtLeast(6, 0)) {
+        LOG_WARN("io_uring backend needs Linux 6.0 or newer.");
+        return false;
+    }
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_CLAMP;
+    params.cq_entries = CQ_ENTRIES;
+    ring_fd = ringSetup(entries, &params);
+    if (ring_fd < 0) {
+        LOG_WARN("io_uring_setup failed: ", strerror(errno));
+        return false;
+    }
+    if (!(params.features & IORING_FEAT_NODROP)) {
+        LOG_WARN("io_uring lacks IORING_FEAT_NODROP.");
+        destroy();
+        return false;
+    }
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && cqRingSize > sqRingSize) sqRingSize = cqRingSize;
+
+    sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        LOG_WARN("io_uring mmap failed: ", strerror(errno));
+        destroy();
+        return false;
+    }
+    cqRing = single ? sqRing
+                    : mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+    sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* mappedSqes = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (cqRing == MAP_FAILED || mappedSqes == MAP_FAILED) {
+        LOG_WARN("io_uring mmap failed: ", strerror(errno));
+        destroy();
+        return false;
+    }
+    sqes = static_cast<struct io_uring_sqe*>(mappedSqes);
+
+    char* sq = static_cast<char*>(sqRing);
+    char* cq = static_cast<char*>(cqRing);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqFlags = reinterpret_cast<unsigned*>(sq + params.sq_off.flags);
+    sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries = params.sq_entries;
+    unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < sqEntries; ++i) array[i] = i;
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+    sqeTail = submittedTail = *sqTail;
+
+    // Every opcode the backend uses must be there
+    const size_t probeSize = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    char probeBuffer[probeSize];
+    memset(probeBuffer, 0, sizeof(probeBuffer));
+    struct io_uring_probe* probe = reinterpret_cast<struct io_uring_probe*>(probeBuffer);
+    if (ringRegister(ring_fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+        LOG_WARN("io_uring probe failed: ", strerror(errno));
+        destroy();
+        return false;
+    }
+    const int needed[] = { IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG, IORING_OP_ASYNC_CANCEL };
+    for (size_t i = 0; i < sizeof(needed) / sizeof(needed[0]); ++i) {
+        if (needed[i] > probe->last_op || !(probe->ops[needed[i]].flags & IO_URING_OP_SUPPORTED)) {
+            LOG_WARN("io_uring opcode ", needed[i], " not supported.");
+            destroy();
+            return false;
+        }
+    }
+    return true;
+}
+
+// Public method returning the next submission entry
+/*
+    The kernel moves the head when it consumed entries; load-acquire makes
+    sure an entry counts as free only after the kernel is done reading it.
+*/
+struct io_uring_sqe* IoUring::nextSqe() {
+    if (ring_fd < 0) return NULL;
+    if (sqeTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) {
+        if (!submit() || sqeTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) return NULL;
+    }
+    struct io_uring_sqe* sqe = &sqes[sqeTail & sqMask];
+    memset(sqe, 0, sizeof(*sqe));
+    ++sqeTail;
+    return sqe;
+}
+
+// Public method submitting the queued entries
+/*
+    int io_uring_enter(int fd, u32 to_submit, u32 min_complete, u32 flags, ...);
+        Consumes "to_submit" entries from the submission queue. With
+        min_complete 0 it does not wait for anything.
+
+    The tail is published with store-release, so the kernel sees the filled
+    entries before it sees the new tail.
+*/
+bool IoUring::submit() {
+    if (ring_fd < 0) return false;
+    if (sqeTail == submittedTail) return true;
+    __atomic_store_n(sqTail, sqeTail, __ATOMIC_RELEASE);
+    while (submittedTail != sqeTail) {
+        int submitted = ringEnter(ring_fd, sqeTail - submittedTail, 0, 0);
+        if (submitted < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EBUSY) {
+                // Completion queue backlog: let the caller reap first
+                return true;
+            }
+            LOG_ERROR("io_uring_enter failed: ", strerror(errno));
+            return false;
+        }
+        submittedTail += static_cast<unsigned>(submitted);
+    }
+    return true;
+}
+
+// Public method handing every waiting completion to "handler"
+/*
+    The head is advanced after each completion, so a handler may queue new
+    requests. If the completion queue ran full, the kernel kept the extra
+    completions aside (IORING_SQ_CQ_OVERFLOW); an io_uring_enter() with
+    IORING_ENTER_GETEVENTS moves them into the queue.
+*/
+size_t IoUring::reap(const std::function<void(const struct io_uring_cqe&)>& handler) {
+    size_t count = 0;
+    while (ring_fd >= 0) {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            struct io_uring_cqe cqe = cqes[head & cqMask];
+            __atomic_store_n(cqHead, ++head, __ATOMIC_RELEASE);
+            ++count;
+            handler(cqe);
+        }
+        if (!(__atomic_load_n(sqFlags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW)) break;
+        if (ringEnter(ring_fd, 0, 0, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) break;
+    }
+    return count;
+}
+
+// Public method registering the provided receive buffers
+/*
+    int io_uring_register(int fd, IORING_REGISTER_PBUF_RING, struct io_uring_buf_reg* reg, 1);
+        Registers a ring of buffer descriptors (address, length, id) shared
+        with the kernel. A recv with IOSQE_BUFFER_SELECT takes the next buffer
+        only when data arrived, so idle connections hold no receive memory;
+        the completion says which buffer was used. recycleBuffer() puts it
+        back at the tail: a memory write, no system call.
+
+    Some kernels register the ring and then fail every recv with ENOBUFS, so
+    one recv on a socketpair checks it works. If not, the buffers are handed
+    over the classic way (IORING_OP_PROVIDE_BUFFERS), one request per
+    recycled buffer, submitted with the next batch.
+
+    Both the descriptor ring and the buffers are mmap()ed: page aligned, as
+    the kernel requires for the ring.
+*/
+bool IoUring::setupBuffers(uint16_t group, unsigned count, unsigned size) {
+    if (ring_fd < 0) return false;
+    if (count == 0 || (count & (count - 1)) != 0 || count > 32768) {
+        destroy();
+        return false;
+    }
+
+    bufRingSize = count * sizeof(struct io_uring_buf);
+    void* ring = mmap(NULL, bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    buffersSize = static_cast<size_t>(count) * size;
+    void* memory = mmap(NULL, buffersSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED || memory == MAP_FAILED) {
+        LOG_WARN("io_uring buffer allocation failed: ", strerror(errno));
+        if (ring != MAP_FAILED) munmap(ring, bufRingSize);
+        if (memory != MAP_FAILED) munmap(memory, buffersSize);
+        destroy();
+        return false;
+    }
+    bufRing = static_cast<struct io_uring_buf_ring*>(ring);
+    buffers = static_cast<char*>(memory);
+    memset(bufRing, 0, bufRingSize);  // fault the pages in: the kernel pins these, not the zero page
+    bufferSize = size;
+    bufferMask = count - 1;
+    bufferGroup = group;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(bufRing);
+    reg.ring_entries = count;
+    reg.bgid = group;
+    if (ringRegister(ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) == 0) {
+        for (unsigned i = 0; i < count; ++i) {
+            struct io_uring_buf* buf = ringEntry(bufRing, i);
+            buf->addr = reinterpret_cast<uint64_t>(buffers + static_cast<size_t>(i) * size);
+            buf->len = size;
+            buf->bid = static_cast<uint16_t>(i);
+        }
+        __atomic_store_n(ringTail(bufRing), static_cast<uint16_t>(count), __ATOMIC_RELEASE);
+        if (receiveWorks()) return true;
+        ringRegister(ring_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    }
+
+    // Classic provided buffers: all of them in one request
+    LOG_WARN("io_uring buffer ring not usable, providing receive buffers per request.");
+    munmap(bufRing, bufRingSize);
+    bufRing = NULL;
+    struct io_uring_sqe* sqe = nextSqe();
+    if (sqe == NULL) {
+        destroy();
+        return false;
+    }
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = static_cast<int>(count);
+    sqe->addr = reinterpret_cast<uint64_t>(buffers);
+    sqe->len = size;
+    sqe->off = 0;
+    sqe->buf_group = group;
+    if (!submit() || !receiveWorks()) {
+        LOG_WARN("io_uring provided buffers not usable.");
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+// Private method checking that a recv picks a provided buffer
+/*
+    Runs right after the buffers were set up, before the ring carries any
+    other request: one byte through a socketpair, then the completion is
+    waited for (io_uring_enter() with min_complete 1) and the buffer given
+    back.
+*/
+bool IoUring::receiveWorks() {
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) return false;
+    bool works = false;
+    struct io_uring_sqe* sqe = nextSqe();
+    if (sqe != NULL && write(pair[1], "x", 1) == 1) {
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = pair[0];
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = bufferGroup;
+        if (submit()) {
+            int waited;
+            do {
+                waited = ringEnter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+            } while (waited < 0 && errno == EINTR);
+            reap([this, &works](const struct io_uring_cqe& cqe) {
+                if (cqe.res == 1 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+                    works = true;
+                    recycleBuffer(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+                }
+            });
+        }
+    }
+    close(pair[0]);
+    close(pair[1]);
+    return works;
+}
+
+void IoUring::recycleBuffer(uint16_t id) {
+    if (bufRing == NULL) {
+        struct io_uring_sqe* sqe = nextSqe();
+        if (sqe == NULL) {
+            LOG_ERROR("io_uring queue full, receive buffer ", id, " lost.");
+            return;
+        }
+        sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe->fd = 1;
+        sqe->addr = reinterpret_cast<uint64_t>(buffer(id));
+        sqe->len = bufferSize;
+        sqe->off = id;
+        sqe->buf_group = bufferGroup;
+        sqe->flags = IOSQE_CQE_SKIP_SUCCESS;  // only a failure needs a completion
+        return;
+    }
+    uint16_t tail = *ringTail(bufRing);
+    struct io_uring_buf* buf = ringEntry(bufRing, tail & bufferMask);
+    buf->addr = reinterpret_cast<uint64_t>(buffers + static_cast<size_t>(id) * bufferSize);
+    buf->len = bufferSize;
+    buf->bid = id;
+    __atomic_store_n(&bufRing->tail, static_cast<uint16_t>(tail + 1), __ATOMIC_RELEASE);
+}
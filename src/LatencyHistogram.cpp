@@ -0,0 +1,84 @@
+#include "../header/LatencyHistogram.hpp"
+#include <cstdio>
+
+LatencyHistogram::LatencyHistogram() : counts(BUCKETS, 0), total(0), sum(0), minValue(UINT64_MAX), maxValue(0) {}
+
+// Bucket index of a value
+/*
+    Values below 16 get their own bucket. Above that, the position of the
+    highest set bit (e) selects a group of 16 buckets and the next four bits
+    select the bucket inside the group.
+*/
+int LatencyHistogram::bucketOf(uint64_t nanos) {
+    if (nanos < static_cast<uint64_t>(SUB_BUCKETS)) return static_cast<int>(nanos);
+    int e = 63 - __builtin_clzll(nanos);
+    int shift = e - 4;
+    int sub = static_cast<int>((nanos >> shift) - SUB_BUCKETS);
+    return SUB_BUCKETS + shift * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int bucket) {
+    if (bucket < SUB_BUCKETS) return static_cast<uint64_t>(bucket);
+    int shift = (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+    uint64_t sub = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanos) {
+    ++counts[bucketOf(nanos)];
+    ++total;
+    sum += nanos;
+    if (nanos < minValue) minValue = nanos;
+    if (nanos > maxValue) maxValue = nanos;
+}
+
+void LatencyHistogram::addToBucket(int bucket, uint64_t n, uint64_t sumNanos) {
+    if (n == 0 || bucket < 0 || bucket >= BUCKETS) return;
+    counts[bucket] += n;
+    total += n;
+    sum += sumNanos;
+    uint64_t upper = bucketUpperBound(bucket);
+    uint64_t lower = bucket < SUB_BUCKETS ? upper : bucketUpperBound(bucket - 1) + 1;
+    if (lower < minValue) minValue = lower;
+    if (upper > maxValue) maxValue = upper;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (int i = 0; i < BUCKETS; ++i) counts[i] += other.counts[i];
+    total += other.total;
+    sum += other.sum;
+    if (other.total > 0 && other.minValue < minValue) minValue = other.minValue;
+    if (other.maxValue > maxValue) maxValue = other.maxValue;
+}
+
+void LatencyHistogram::reset() {
+    counts.assign(BUCKETS, 0);
+    total = sum = maxValue = 0;
+    minValue = UINT64_MAX;
+}
+
+uint64_t LatencyHistogram::percentile(double percentile) const {
+    if (total == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > total) rank = total;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            uint64_t upper = bucketUpperBound(i);
+            return upper < maxValue ? upper : maxValue;
+        }
+    }
+    return maxValue;
+}
+
+std::string LatencyHistogram::summary() const {
+    char line[256];
+    snprintf(line, sizeof(line), "n=%llu p50=%.1fus p90=%.1fus p99=%.1fus p999=%.1fus max=%.1fus",
+             static_cast<unsigned long long>(total),
+             percentile(50) / 1000.0, percentile(90) / 1000.0, percentile(99) / 1000.0,
+             percentile(99.9) / 1000.0, max() / 1000.0);
+    return line;
+}
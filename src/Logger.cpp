@@ -0,0 +1,263 @@
+#include "../header/Logger.hpp"
+#include <chrono>
+#include <cstring>
+
+static const char* LEVEL_NAMES[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+static const char* LEVEL_KEYS[] = { "debug", "info", "warn", "error" };
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : ring(new Record[CAPACITY]), head(0), tail(0), minLevel(LEVEL_INFO), rateLimit(100),
+      droppedRecords(0), reportedDrops(0), out(stdout), ownsFile(false),
+      outputFormat(FORMAT_TEXT), running(false) {
+    for (size_t i = 0; i < CAPACITY; ++i) ring[i].seq.store(i, std::memory_order_relaxed);
+}
+
+Logger::~Logger() {
+    stop();
+    delete[] ring;
+}
+
+bool Logger::parseLevel(const std::string& text, Level& level) {
+    for (int i = LEVEL_DEBUG; i <= LEVEL_ERROR; ++i) {
+        if (text == LEVEL_KEYS[i]) {
+            level = static_cast<Level>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Logger::parseFormat(const std::string& text, Format& format) {
+    if (text == "text") format = FORMAT_TEXT;
+    else if (text == "json") format = FORMAT_JSON;
+    else return false;
+    return true;
+}
+
+// Public method to start the writer thread
+bool Logger::start(const std::string& path, Format format) {
+    if (running.load()) return true;
+
+    if (!path.empty()) {
+        FILE* file = fopen(path.c_str(), "ae");  // append, close-on-exec
+        if (file == NULL) {
+            perror("Log file open failed");
+            return false;
+        }
+        out = file;
+        ownsFile = true;
+    }
+    outputFormat = format;
+    running.store(true);
+    writer = std::thread(&Logger::writerLoop, this);
+    return true;
+}
+
+// Public method to flush the queue and stop the writer thread
+/*
+    Records queued before start() (or after stop()) are written here by the
+    calling thread, so nothing logged during start-up or shutdown is lost.
+*/
+void Logger::stop() {
+    if (running.exchange(false)) writer.join();
+    drain();
+    if (ownsFile) {
+        fclose(out);
+        out = stdout;
+        ownsFile = false;
+    }
+}
+
+// Private method applying the call site's per-second budget
+/*
+    Budgets are counted per wall-clock second. The counters are updated with
+    relaxed atomics from any thread, so under a race a site may log a record
+    or two more than its limit; that is fine for a rate limiter.
+*/
+bool Logger::admit(Site& site, uint64_t time, uint32_t& suppressed) {
+    uint32_t limit = rateLimit.load(std::memory_order_relaxed);
+    if (limit == 0) return true;
+
+    uint64_t second = time / 1000000000ULL;
+    uint64_t window = site.window.load(std::memory_order_relaxed);
+    if (window != second && site.window.compare_exchange_strong(window, second, std::memory_order_relaxed)) {
+        site.used.store(0, std::memory_order_relaxed);
+    }
+    if (site.used.fetch_add(1, std::memory_order_relaxed) >= limit) {
+        site.suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
+// Private method claiming the next free record for a producer (NULL if the ring is full)
+Logger::Record* Logger::claim(size_t& pos) {
+    pos = head.load(std::memory_order_relaxed);
+    for (;;) {
+        Record& record = ring[pos & (CAPACITY - 1)];
+        size_t seq = record.seq.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) return &record;
+        } else if (diff < 0) {
+            return NULL;  // the writer has not consumed this slot yet: ring full
+        } else {
+            pos = head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// Cuts at a character boundary: a UTF-8 sequence split in two would make
+// the line invalid (its bytes are escaped, but the character is lost anyway).
+void Logger::appendText(Record& record, const char* data, size_t size) {
+    size_t room = TEXT_MAX - record.length;
+    if (size > room) {
+        size = room;
+        while (size > 0 && (static_cast<unsigned char>(data[size]) & 0xC0) == 0x80) --size;
+    }
+    memcpy(record.text + record.length, data, size);
+    record.length += size;
+}
+
+// Private method run by the writer thread
+/*
+    The writer polls: producers never signal it, because waking a thread costs
+    a system call on the request path. When the ring is empty it sleeps for a
+    few milliseconds, which bounds how late a line shows up in the log.
+*/
+void Logger::writerLoop() {
+    while (running.load(std::memory_order_relaxed)) {
+        if (drain() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+// Private method writing every ready record; returns how many it wrote
+size_t Logger::drain() {
+    std::string text;
+    size_t written = 0;
+    for (;;) {
+        Record& record = ring[tail & (CAPACITY - 1)];
+        if (record.seq.load(std::memory_order_acquire) != tail + 1) break;
+
+        format(record, text);
+        record.seq.store(tail + CAPACITY, std::memory_order_release);  // free for position tail + CAPACITY
+        ++tail;
+        ++written;
+    }
+
+    uint64_t drops = droppedRecords.load(std::memory_order_relaxed);
+    if (drops != reportedDrops) {
+        Site site(__FILE__, __LINE__);
+        Record note;
+        note.time = wallClock();
+        note.site = &site;
+        note.level = LEVEL_WARN;
+        note.suppressed = 0;
+        note.length = 0;
+        append(note, "Log ring full: ");
+        append(note, drops - reportedDrops);
+        append(note, " records dropped");
+        format(note, text);
+        reportedDrops = drops;
+    }
+
+    if (!text.empty()) {
+        fwrite(text.data(), 1, text.size(), out);
+        fflush(out);
+    }
+    return written;
+}
+
+// Helper returning the length of the valid UTF-8 character at "p" (0 if the
+// bytes are not one: stray continuation byte, overlong form, surrogate,
+// beyond U+10FFFF or cut short)
+static size_t utf8Length(const unsigned char* p, size_t size) {
+    size_t length;
+    uint32_t code;
+    if (p[0] < 0x80) return 1;
+    else if (p[0] >= 0xC2 && p[0] <= 0xDF) { length = 2; code = p[0] & 0x1F; }
+    else if (p[0] >= 0xE0 && p[0] <= 0xEF) { length = 3; code = p[0] & 0x0F; }
+    else if (p[0] >= 0xF0 && p[0] <= 0xF4) { length = 4; code = p[0] & 0x07; }
+    else return 0;
+    if (size < length) return 0;
+    for (size_t i = 1; i < length; ++i) {
+        if ((p[i] & 0xC0) != 0x80) return 0;
+        code = (code << 6) | (p[i] & 0x3F);
+    }
+    if ((length == 3 && (code < 0x800 || (code >= 0xD800 && code <= 0xDFFF))) ||
+        (length == 4 && (code < 0x10000 || code > 0x10FFFF))) {
+        return 0;
+    }
+    return length;
+}
+
+// Helper copying a message into a log line
+/*
+    Messages carry client bytes (command lines, peer input), so nothing that
+    could forge or break a line gets through: control characters and bytes
+    that are not valid UTF-8 become \xNN in text lines and \u00NN in JSON,
+    where '"' and '\\' are escaped as well.
+*/
+static void appendEscaped(std::string& out, std::string_view message, bool json) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(message.data());
+    for (size_t i = 0; i < message.size();) {
+        unsigned char c = bytes[i];
+        size_t length = utf8Length(bytes + i, message.size() - i);
+        if (length == 0 || c < 0x20 || c == 0x7F) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), json ? "\\u%04x" : "\\x%02x", c);
+            out += escaped;
+            ++i;
+            continue;
+        }
+        if (json && (c == '"' || c == '\\')) out += '\\';
+        out.append(message.data() + i, length);
+        i += length;
+    }
+}
+
+// Private method turning one record into a text or JSON line
+void Logger::format(const Record& record, std::string& out) const {
+    time_t seconds = static_cast<time_t>(record.time / 1000000000ULL);
+    unsigned millis = static_cast<unsigned>(record.time / 1000000ULL % 1000);
+    struct tm parts;
+    gmtime_r(&seconds, &parts);
+
+    char stamp[40];
+    size_t len = strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &parts);
+    snprintf(stamp + len, sizeof(stamp) - len, ".%03uZ", millis);
+
+    const char* file = strrchr(record.site->file, '/');
+    file = file ? file + 1 : record.site->file;
+    std::string_view message(record.text, record.length);
+
+    if (outputFormat == FORMAT_TEXT) {
+        out += stamp;
+        out += ' ';
+        out += LEVEL_NAMES[record.level];
+        out.append(6 - strlen(LEVEL_NAMES[record.level]), ' ');
+        appendEscaped(out, message, false);
+        if (record.suppressed > 0) out += " [" + std::to_string(record.suppressed) + " similar lines suppressed]";
+        out += '\n';
+        return;
+    }
+
+    out += "{\"time\":\"";
+    out += stamp;
+    out += "\",\"level\":\"";
+    out += LEVEL_KEYS[record.level];
+    out += "\",\"source\":\"";
+    out += file;
+    out += ':' + std::to_string(record.site->line);
+    out += "\",\"message\":\"";
+    appendEscaped(out, message, true);
+    out += '"';
+    if (record.suppressed > 0) out += ",\"suppressed\":" + std::to_string(record.suppressed);
+    out += "}\n";
+}
@@ -0,0 +1,179 @@
+#include "../header/Metrics.hpp"
+#include <cstdio>
+#include <cstring>
+
+static const char* STAGE_NAMES[Metrics::STAGE_COUNT] = { "accept", "read", "parse", "dispatch", "send" };
+
+static const char* COUNTER_NAMES[Metrics::COUNTER_COUNT] = {
+    "pcctl_connections_accepted_total",
+    "pcctl_connections_closed_total",
+    "pcctl_connections_idle_closed_total",
+    "pcctl_bytes_read_total",
+    "pcctl_bytes_sent_total",
+    "pcctl_frames_received_total",
+    "pcctl_commands_unknown_total",
+    "pcctl_commands_merged_total",
+    "pcctl_commands_busy_total",
+    "pcctl_commands_throttled_total",
+    "pcctl_input_events_total",
+    "pcctl_input_merged_total"
+};
+
+// Lowest bucket exported to Prometheus: 2^10 ns ~ 1 us
+static const int FIRST_EXPORTED_BUCKET = 10;
+
+Metrics& Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Metrics() {}
+
+// Private method returning the calling thread's slot (allocated once per thread)
+/*
+    Slots are never freed: a thread that exits keeps contributing what it
+    already counted, which is what cumulative Prometheus counters expect.
+*/
+Metrics::ThreadSlot& Metrics::slot() {
+    thread_local ThreadSlot* mine = NULL;
+    if (mine == NULL) {
+        mine = new ThreadSlot();  // value-initialised: every counter starts at zero
+        std::lock_guard<std::mutex> guard(lock);
+        slots.push_back(mine);
+    }
+    return *mine;
+}
+
+// Single writer per slot: a plain load + store is enough (no locked instruction)
+void Metrics::bump(std::atomic<uint64_t>& value, uint64_t n) {
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+void Metrics::record(Histogram& h, uint64_t nanos) {
+    int bucket = nanos == 0 ? 0 : 64 - __builtin_clzll(nanos);
+    if (bucket >= BUCKETS) bucket = BUCKETS - 1;
+    bump(h.buckets[bucket], 1);
+    bump(h.count, 1);
+    bump(h.sum, nanos);
+}
+
+void Metrics::add(Counter counter, uint64_t n) {
+    bump(slot().counters[counter], n);
+}
+
+void Metrics::recordStage(Stage stage, uint64_t nanos) {
+    record(slot().stages[stage], nanos);
+}
+
+int Metrics::handlerId(const std::string& name) {
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t i = 0; i < handlerNames.size(); ++i) {
+        if (handlerNames[i] == name) return static_cast<int>(i);
+    }
+    if (handlerNames.size() >= static_cast<size_t>(MAX_HANDLERS)) return -1;
+    handlerNames.push_back(name);
+    return static_cast<int>(handlerNames.size() - 1);
+}
+
+void Metrics::recordHandler(int id, uint64_t nanos) {
+    if (id < 0) return;
+    record(slot().handlers[id], nanos);
+}
+
+// Helper escaping a label value as the exposition format requires (\\, \", \n)
+static std::string escapeLabel(const std::string& value) {
+    std::string out;
+    out.reserve(value.size());
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (value[i] == '\\') out += "\\\\";
+        else if (value[i] == '"') out += "\\\"";
+        else if (value[i] == '\n') out += "\\n";
+        else out += value[i];
+    }
+    return out;
+}
+
+// Helper that appends one histogram in Prometheus format
+/*
+    # TYPE pcctl_stage_seconds histogram
+    pcctl_stage_seconds_bucket{stage="read",le="1.024e-06"} 12
+    ...
+    pcctl_stage_seconds_bucket{stage="read",le="+Inf"} 40
+    pcctl_stage_seconds_sum{stage="read"} 0.0003
+    pcctl_stage_seconds_count{stage="read"} 40
+*/
+static void appendHistogram(std::string& out, const char* metric, const std::string& labels,
+                            const uint64_t* buckets, uint64_t count, uint64_t sum) {
+    char line[256];
+    uint64_t cumulative = 0;
+    for (int i = 0; i < Metrics::BUCKETS; ++i) {
+        cumulative += buckets[i];
+        if (i < FIRST_EXPORTED_BUCKET || i == Metrics::BUCKETS - 1) continue;
+        snprintf(line, sizeof(line), "%s_bucket{%s,le=\"%.4g\"} %llu\n", metric, labels.c_str(),
+                 static_cast<double>(1ULL << i) / 1e9, static_cast<unsigned long long>(cumulative));
+        out += line;
+    }
+    snprintf(line, sizeof(line), "%s_bucket{%s,le=\"+Inf\"} %llu\n%s_sum{%s} %.9f\n%s_count{%s} %llu\n",
+             metric, labels.c_str(), static_cast<unsigned long long>(count),
+             metric, labels.c_str(), sum / 1e9,
+             metric, labels.c_str(), static_cast<unsigned long long>(count));
+    out += line;
+}
+
+std::string Metrics::render() {
+    std::vector<ThreadSlot*> all;
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        all = slots;
+        names = handlerNames;
+    }
+
+    std::string out;
+    char line[256];
+
+    // Counters
+    uint64_t totals[COUNTER_COUNT] = {0};
+    for (size_t s = 0; s < all.size(); ++s) {
+        for (int c = 0; c < COUNTER_COUNT; ++c) totals[c] += all[s]->counters[c].load(std::memory_order_relaxed);
+    }
+    for (int c = 0; c < COUNTER_COUNT; ++c) {
+        snprintf(line, sizeof(line), "# TYPE %s counter\n%s %llu\n", COUNTER_NAMES[c], COUNTER_NAMES[c],
+                 static_cast<unsigned long long>(totals[c]));
+        out += line;
+    }
+    snprintf(line, sizeof(line), "# TYPE pcctl_connections_open gauge\npcctl_connections_open %llu\n",
+             static_cast<unsigned long long>(totals[CONNECTIONS_ACCEPTED] - totals[CONNECTIONS_CLOSED]));
+    out += line;
+
+    // Histograms: sum the slots bucket by bucket
+    uint64_t buckets[BUCKETS];
+    out += "# TYPE pcctl_stage_seconds histogram\n";
+    for (int st = 0; st < STAGE_COUNT; ++st) {
+        uint64_t count = 0, sum = 0;
+        memset(buckets, 0, sizeof(buckets));
+        for (size_t s = 0; s < all.size(); ++s) {
+            const Histogram& h = all[s]->stages[st];
+            for (int b = 0; b < BUCKETS; ++b) buckets[b] += h.buckets[b].load(std::memory_order_relaxed);
+            count += h.count.load(std::memory_order_relaxed);
+            sum += h.sum.load(std::memory_order_relaxed);
+        }
+        appendHistogram(out, "pcctl_stage_seconds", std::string("stage=\"") + STAGE_NAMES[st] + "\"", buckets, count, sum);
+    }
+
+    out += "# TYPE pcctl_handler_seconds histogram\n";
+    for (size_t id = 0; id < names.size(); ++id) {
+        uint64_t count = 0, sum = 0;
+        memset(buckets, 0, sizeof(buckets));
+        for (size_t s = 0; s < all.size(); ++s) {
+            const Histogram& h = all[s]->handlers[id];
+            for (int b = 0; b < BUCKETS; ++b) buckets[b] += h.buckets[b].load(std::memory_order_relaxed);
+            count += h.count.load(std::memory_order_relaxed);
+            sum += h.sum.load(std::memory_order_relaxed);
+        }
+        if (count == 0) continue;
+        std::string labels = "command=\"" + escapeLabel(names[id]) + "\"";
+        appendHistogram(out, "pcctl_handler_seconds", labels, buckets, count, sum);
+    }
+    return out;
+}
@@ -0,0 +1,177 @@
+#include "../header/MetricsServer.hpp"
+#include "../header/Metrics.hpp"
+#include "../header/Logger.hpp"
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+
+// Helper returning a monotonic timestamp in milliseconds
+static int64_t nowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+MetricsServer::MetricsServer(int port)
+    : port(port), listen_fd(-1), timer_fd(-1), loop(NULL), accepted(0), deadlines(32, TICK_MS) {}
+
+MetricsServer::~MetricsServer() {
+    for (std::unordered_map<int, Scraper>::iterator it = clients.begin(); it != clients.end(); ++it) close(it->first);
+    if (listen_fd >= 0) close(listen_fd);
+    if (timer_fd >= 0) close(timer_fd);
+}
+
+bool MetricsServer::attach(TcpServer& server) {
+    loop = &server;
+
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        LOG_ERROR("Metrics socket creation failed: ", strerror(errno));
+        return false;
+    }
+    int opt = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port);
+    if (bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listen_fd, 16) < 0) {
+        LOG_ERROR("Metrics bind/listen failed: ", strerror(errno));
+        return false;
+    }
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0 || !server.watchFd(timer_fd, EPOLLIN, [this](uint32_t) { onTimer(); })) {
+        LOG_ERROR("Metrics timer setup failed: ", strerror(errno));
+        return false;
+    }
+
+    LOG_INFO("Metrics available on port ", port);
+    return server.watchFd(listen_fd, EPOLLIN, [this](uint32_t) { acceptScrapers(); });
+}
+
+// Private method that accepts every waiting scrape connection
+void MetricsServer::acceptScrapers() {
+    while (true) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;  // EAGAIN: queue empty
+
+        // Full: close at once rather than leave it in the backlog
+        if (clients.size() >= MAX_SCRAPERS) {
+            LOG_WARN("Metrics port has ", static_cast<size_t>(MAX_SCRAPERS), " connections, refusing another.");
+            close(fd);
+            continue;
+        }
+
+        Scraper& scraper = clients[fd];
+        scraper.response.clear();
+        scraper.key = (static_cast<uint64_t>(++accepted) << 32) | static_cast<uint32_t>(fd);
+        scraper.deadlineMs = nowMs() + SCRAPE_TIMEOUT_MS;
+        if (!loop->watchFd(fd, EPOLLIN, [this, fd](uint32_t events) { onClient(fd, events); })) {
+            clients.erase(fd);
+            close(fd);
+            continue;
+        }
+        if (deadlines.size() == 0) armTimer(true);
+        deadlines.schedule(scraper.key, scraper.deadlineMs);
+    }
+}
+
+// Private method: read the request once, then write the response until done
+/*
+    The request itself is not parsed: every request gets the metrics. The
+    response is built once and written as the socket accepts it; only if the
+    socket fills up do we switch the watch from EPOLLIN to EPOLLOUT. The
+    connection is closed after the last byte (HTTP/1.0 style).
+*/
+void MetricsServer::onClient(int fd, uint32_t events) {
+    std::unordered_map<int, Scraper>::iterator it = clients.find(fd);
+    if (it == clients.end()) return;
+    std::string& response = it->second.response;
+
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        closeClient(fd);
+        return;
+    }
+
+    if (response.empty()) {
+        if (!(events & EPOLLIN)) return;
+        char request[2048];
+        ssize_t n = read(fd, request, sizeof(request));
+        if (n <= 0) {
+            if (n < 0 && errno == EAGAIN) return;
+            closeClient(fd);
+            return;
+        }
+
+        std::string body = Metrics::instance().render();
+        response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                     std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    }
+
+    while (!response.empty()) {
+        ssize_t sent = send(fd, response.data(), response.size(), MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN) {
+                // Socket full: wait for EPOLLOUT (level-triggered) to write the rest
+                loop->unwatchFd(fd);
+                if (loop->watchFd(fd, EPOLLOUT, [this, fd](uint32_t events) { onClient(fd, events); })) return;
+            }
+            closeClient(fd);
+            return;
+        }
+        response.erase(0, sent);
+    }
+    closeClient(fd);
+}
+
+void MetricsServer::closeClient(int fd) {
+    loop->unwatchFd(fd);
+    clients.erase(fd);
+    close(fd);
+}
+
+// Private method starting (periodic, every TICK_MS) or stopping the deadline timer
+void MetricsServer::armTimer(bool on) {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (on) {
+        spec.it_value.tv_nsec = TICK_MS * 1000000;
+        spec.it_interval = spec.it_value;
+    }
+    timerfd_settime(timer_fd, 0, &spec, NULL);
+}
+
+// Private method closing the scrapers whose deadline passed
+/*
+    Scrapers that finished in time are already gone; their wheel entries
+    find no connection (or one with another key) and are dropped. The timer
+    stops once the wheel is empty.
+*/
+void MetricsServer::onTimer() {
+    uint64_t expirations;
+    while (read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {}
+
+    due.clear();
+    int64_t now = nowMs();
+    deadlines.advance(now, due);
+    for (size_t i = 0; i < due.size(); ++i) {
+        int fd = static_cast<int>(static_cast<uint32_t>(due[i]));
+        std::unordered_map<int, Scraper>::iterator it = clients.find(fd);
+        if (it == clients.end() || it->second.key != due[i]) continue;
+        if (it->second.deadlineMs > now) {
+            deadlines.schedule(due[i], it->second.deadlineMs);
+            continue;
+        }
+        LOG_WARN("Metrics client timed out after ", static_cast<int64_t>(SCRAPE_TIMEOUT_MS), " ms, closing.");
+        closeClient(fd);
+    }
+    if (deadlines.size() == 0) armTimer(false);
+}
@@ -0,0 +1,118 @@
+#include "../header/OutboundQueue.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/uio.h>
+#include <sys/socket.h>
+
+BufferPool::BufferPool(size_t maxFree) : maxFree(maxFree) {}
+
+BufferPool::~BufferPool() {
+    for (size_t i = 0; i < freeChunks.size(); ++i) delete freeChunks[i];
+}
+
+BufferPool::Chunk* BufferPool::acquire() {
+    Chunk* chunk;
+    if (freeChunks.empty()) {
+        chunk = new Chunk;
+    } else {
+        chunk = freeChunks.back();
+        freeChunks.pop_back();
+    }
+    chunk->begin = chunk->end = 0;
+    return chunk;
+}
+
+void BufferPool::release(Chunk* chunk) {
+    if (freeChunks.size() < maxFree) {
+        freeChunks.push_back(chunk);
+    } else {
+        delete chunk;
+    }
+}
+
+OutboundQueue::OutboundQueue(BufferPool& pool) : pool(&pool), queued(0) {}
+
+OutboundQueue::OutboundQueue(OutboundQueue&& other) noexcept
+    : pool(other.pool), chunks(std::move(other.chunks)), queued(other.queued) {
+    other.chunks.clear();
+    other.queued = 0;
+}
+
+OutboundQueue::~OutboundQueue() {
+    clear();
+}
+
+// Private method that returns every chunk to the pool
+void OutboundQueue::clear() {
+    for (size_t i = 0; i < chunks.size(); ++i) pool->release(chunks[i]);
+    chunks.clear();
+    queued = 0;
+}
+
+void OutboundQueue::append(std::string_view data) {
+    const char* src = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+        if (chunks.empty() || chunks.back()->end == BufferPool::CHUNK_SIZE) chunks.push_back(pool->acquire());
+        BufferPool::Chunk* tail = chunks.back();
+        size_t n = std::min(left, BufferPool::CHUNK_SIZE - tail->end);
+        memcpy(tail->data + tail->end, src, n);
+        tail->end += n;
+        src += n;
+        left -= n;
+    }
+    queued += data.size();
+}
+
+// Public method that writes queued chunks to the socket
+/*
+    ssize_t writev(int fd, const struct iovec *iov, int iovcnt);
+        Writes several separate buffers with one system call, in order.
+        Like send(), it may write fewer bytes than asked (partial write):
+        the return value says how many, and the rest stays queued.
+
+    writev() cannot take MSG_NOSIGNAL, so sendmsg() is used with the same iovec
+    array: a client that disconnected must not kill the server with SIGPIPE.
+*/
+OutboundQueue::FlushResult OutboundQueue::flush(int fd) {
+    while (queued > 0) {
+        struct iovec iov[MAX_IOV];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = gather(iov, MAX_IOV);
+        ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return WOULD_BLOCK;
+            return FAILED;
+        }
+        consume(static_cast<size_t>(sent));
+    }
+    return FLUSHED;
+}
+
+int OutboundQueue::gather(struct iovec* iov, int maxIov) const {
+    int count = 0;
+    for (size_t i = 0; i < chunks.size() && count < maxIov; ++i, ++count) {
+        iov[count].iov_base = chunks[i]->data + chunks[i]->begin;
+        iov[count].iov_len = chunks[i]->end - chunks[i]->begin;
+    }
+    return count;
+}
+
+// Public method dropping fully written chunks and advancing the partially written one
+void OutboundQueue::consume(size_t sent) {
+    queued -= sent;
+    while (sent > 0) {
+        BufferPool::Chunk* head = chunks.front();
+        size_t n = std::min(sent, head->end - head->begin);
+        head->begin += n;
+        sent -= n;
+        if (head->begin == head->end) {
+            pool->release(head);
+            chunks.pop_front();
+        }
+    }
+}
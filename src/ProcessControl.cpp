@@ -0,0 +1,237 @@
+#include "../header/ProcessControl.hpp"
+#include "../header/Logger.hpp"
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <ctime>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+
+// The /proc index is reused for this long before it is refreshed
+static const int64_t INDEX_TTL_MS = 1000;
+
+// How long a process or group may ignore SIGTERM before it gets SIGKILL
+static const int64_t KILL_GRACE_MS = 3000;
+
+// Helper returning a monotonic timestamp in milliseconds
+static int64_t nowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Helpers wrapping the pidfd system calls (Linux 5.3+, no glibc wrappers before 2.36)
+static int pidfdOpen(pid_t pid) {
+    return static_cast<int>(syscall(__NR_pidfd_open, pid, 0));
+}
+
+static int pidfdSignal(int pidfd, int signal) {
+    return static_cast<int>(syscall(__NR_pidfd_send_signal, pidfd, signal, NULL, 0));
+}
+
+// Helper reading /proc/<pid>/cmdline with the arguments joined by spaces
+// ("" if the process is gone)
+static std::string readCmdline(pid_t pid) {
+    std::ifstream file(("/proc/" + std::to_string(pid) + "/cmdline").c_str(), std::ios::binary);
+    std::string cmdline((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    for (size_t i = 0; i < cmdline.size(); ++i) {
+        if (cmdline[i] == '\0') cmdline[i] = ' ';
+    }
+    return cmdline;
+}
+
+ProcessControl::ProcessControl(ProcessLauncher& launcher)
+    : launcher(launcher), timer_fd(-1), indexTimeMs(-INDEX_TTL_MS) {}
+
+ProcessControl::~ProcessControl() {
+    if (timer_fd >= 0) close(timer_fd);
+    for (size_t i = 0; i < pendingKills.size(); ++i) {
+        if (pendingKills[i].pidfd >= 0) close(pendingKills[i].pidfd);
+    }
+}
+
+// Public method that creates the SIGKILL escalation timer
+/*
+    int timerfd_create(int clockid, int flags);
+        Creates a timer that is read like a file: the descriptor becomes readable
+        when the timer expires, so it can be watched by epoll like a socket.
+*/
+bool ProcessControl::attach(TcpServer& server) {
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0) {
+        LOG_ERROR("timerfd_create failed: ", strerror(errno));
+        return false;
+    }
+    return server.watchFd(timer_fd, EPOLLIN, [this](uint32_t) { onTimer(); });
+}
+
+int ProcessControl::terminateSession(const std::string& session, const std::string& cmdlinePattern) {
+    int signalled = 0;
+    if (launcher.isDryRun()) return 0;  // mock handlers: nothing was started
+
+    // 1. Groups we launched ourselves: one killpg() each, no lookup needed
+    std::set<pid_t> pids = launcher.pidsOf(session);
+    //    (a tracked leader is a child not reaped yet, so the pgid is still ours)
+    for (std::set<pid_t>::const_iterator it = pids.begin(); it != pids.end(); ++it) {
+        int pidfd = pidfdOpen(*it);
+        if (killpg(*it, SIGTERM) == 0) {
+            scheduleKill(-*it, pidfd, std::string());
+            ++signalled;
+        } else if (pidfd >= 0) {
+            close(pidfd);
+        }
+    }
+
+    // 2. Nothing tracked (e.g. started by a previous server run): look for the
+    //    session's profile on the command lines in the /proc index. The index
+    //    may be up to INDEX_TTL_MS old, so each match is pinned with a pidfd and
+    //    its command line read again; the pidfd still signalling 0 afterwards
+    //    proves the line we read belonged to that process.
+    if (pids.empty() && !cmdlinePattern.empty()) {
+        std::vector<pid_t> found = findByCmdline(cmdlinePattern);
+        for (size_t i = 0; i < found.size(); ++i) {
+            int pidfd = pidfdOpen(found[i]);
+            bool same = readCmdline(found[i]).find(cmdlinePattern) != std::string::npos &&
+                        (pidfd < 0 || pidfdSignal(pidfd, 0) == 0);
+            bool sent = same && (pidfd >= 0 ? pidfdSignal(pidfd, SIGTERM) : kill(found[i], SIGTERM)) == 0;
+            if (sent) {
+                scheduleKill(found[i], pidfd, cmdlinePattern);
+                ++signalled;
+            } else if (pidfd >= 0) {
+                close(pidfd);
+            }
+        }
+    }
+
+    return signalled;
+}
+
+std::vector<pid_t> ProcessControl::findByCmdline(const std::string& pattern) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (nowMs() - indexTimeMs >= INDEX_TTL_MS) refreshIndex();
+
+    std::vector<pid_t> found;
+    pid_t self = getpid();
+    for (std::unordered_map<pid_t, std::string>::const_iterator it = procIndex.begin(); it != procIndex.end(); ++it) {
+        if (it->first != self && it->second.find(pattern) != std::string::npos) found.push_back(it->first);
+    }
+    return found;
+}
+
+// Private method that brings the /proc index up to date
+/*
+    /proc contains one directory per running process, named by its pid.
+    /proc/<pid>/cmdline holds the arguments separated by '\0'.
+
+    Only pids that are not in the index yet are read; pids that disappeared
+    are dropped. An entry can therefore be stale (exec() in place, or the pid
+    reused between two refreshes): it only selects candidates, and
+    terminateSession() checks them again before signalling.
+*/
+void ProcessControl::refreshIndex() {
+    DIR* dir = opendir("/proc");
+    if (dir == NULL) return;
+
+    std::unordered_map<pid_t, std::string> fresh;
+    fresh.reserve(procIndex.size() + 16);
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        char* end = NULL;
+        long pid = strtol(entry->d_name, &end, 10);
+        if (end == entry->d_name || *end != '\0') continue;  // not a pid directory
+
+        std::unordered_map<pid_t, std::string>::iterator known = procIndex.find(static_cast<pid_t>(pid));
+        if (known != procIndex.end()) {
+            fresh[known->first].swap(known->second);
+            continue;
+        }
+
+        fresh[static_cast<pid_t>(pid)] = readCmdline(static_cast<pid_t>(pid));
+    }
+    closedir(dir);
+
+    procIndex.swap(fresh);
+    indexTimeMs = nowMs();
+}
+
+// Private method that remembers a target for SIGKILL escalation
+void ProcessControl::scheduleKill(pid_t target, int pidfd, const std::string& pattern) {
+    if (timer_fd < 0) {
+        if (pidfd >= 0) close(pidfd);
+        return;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    PendingKill pending = { target, pidfd, pattern, nowMs() + KILL_GRACE_MS };
+    pendingKills.push_back(pending);
+    armTimer();
+}
+
+// Private method that arms the timer for the earliest escalation deadline
+void ProcessControl::armTimer() {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (!pendingKills.empty()) {
+        int64_t earliest = pendingKills[0].deadlineMs;
+        for (size_t i = 1; i < pendingKills.size(); ++i) {
+            if (pendingKills[i].deadlineMs < earliest) earliest = pendingKills[i].deadlineMs;
+        }
+        int64_t delay = earliest - nowMs();
+        if (delay < 1) delay = 1;  // a zero it_value would disarm the timer
+        spec.it_value.tv_sec = delay / 1000;
+        spec.it_value.tv_nsec = (delay % 1000) * 1000000;
+    }
+    timerfd_settime(timer_fd, 0, &spec, NULL);
+}
+
+// Private method called when the escalation timer expires
+/*
+    A pid target is killed through its pidfd, which cannot reach a process
+    that reused the pid; without one its command line is checked again.
+
+    A group is only killed while its id still belongs to our group: either
+    the leader is alive (its pidfd accepts signal 0), or no process has that
+    pid at all, since a pid is not handed out again while a group with that
+    id has members. A pid that exists while our leader is gone was reused.
+*/
+void ProcessControl::onTimer() {
+    uint64_t expirations;
+    while (read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {}
+
+    std::lock_guard<std::mutex> guard(lock);
+    int64_t now = nowMs();
+    size_t kept = 0;
+    for (size_t i = 0; i < pendingKills.size(); ++i) {
+        const PendingKill& pending = pendingKills[i];
+        if (pending.deadlineMs > now) {
+            pendingKills[kept++] = pending;
+            continue;
+        }
+        bool ours;
+        if (pending.target < 0) {
+            bool leaderAlive = pending.pidfd >= 0 && pidfdSignal(pending.pidfd, 0) == 0;
+            ours = leaderAlive || kill(-pending.target, 0) != 0;
+        } else if (pending.pidfd >= 0) {
+            ours = pidfdSignal(pending.pidfd, 0) == 0;
+        } else {
+            ours = readCmdline(pending.target).find(pending.pattern) != std::string::npos;
+        }
+
+        // Still alive after the grace period? (signal 0 only checks existence)
+        if (ours && kill(pending.target, 0) == 0) {
+            LOG_WARN("Process ", pending.target < 0 ? "group " : "", pending.target < 0 ? -pending.target : pending.target,
+                     " ignored SIGTERM, sending SIGKILL.");
+            if (pending.target > 0 && pending.pidfd >= 0) pidfdSignal(pending.pidfd, SIGKILL);
+            else kill(pending.target, SIGKILL);
+        }
+        if (pending.pidfd >= 0) close(pending.pidfd);
+    }
+    pendingKills.resize(kept);
+    armTimer();
+}
@@ -0,0 +1,147 @@
+#include "../header/ProcessLauncher.hpp"
+#include "../header/Logger.hpp"
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+
+extern char** environ;
+
+ProcessLauncher::ProcessLauncher() : signal_fd(-1), dryRun(false) {}
+
+ProcessLauncher::~ProcessLauncher() {
+    if (signal_fd >= 0) close(signal_fd);
+}
+
+// Public method that routes SIGCHLD into the event loop
+/*
+    int signalfd(int fd, const sigset_t *mask, int flags);
+        Returns a descriptor that becomes readable when one of the signals in
+        "mask" is pending. The signal must be blocked with sigprocmask() first,
+        otherwise it would still be delivered the classic asynchronous way.
+
+    Several exits may be merged into one SIGCHLD, so the handler checks every
+    child it launched with waitpid(pid, WNOHANG).
+*/
+bool ProcessLauncher::attach(TcpServer& server) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) < 0) {
+        LOG_ERROR("sigprocmask failed: ", strerror(errno));
+        return false;
+    }
+
+    signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd < 0) {
+        LOG_ERROR("signalfd failed: ", strerror(errno));
+        return false;
+    }
+
+    return server.watchFd(signal_fd, EPOLLIN, [this](uint32_t) { reapChildren(); });
+}
+
+// Public method to start a program in the background
+/*
+    int posix_spawnp(pid_t *pid, const char *file,
+                     const posix_spawn_file_actions_t *file_actions,
+                     const posix_spawnattr_t *attrp,
+                     char *const argv[], char *const envp[]);
+
+        POSIX_SPAWN_SETSIGMASK : the child starts with an empty signal mask
+                                 (we block SIGCHLD here, the browser must not inherit that).
+        POSIX_SPAWN_SETPGROUP  : pgroup 0 puts the child in a new process group,
+                                 so the whole browser process tree can be signalled at once.
+
+    All server sockets are opened with *_CLOEXEC, so the child does not keep them open.
+*/
+pid_t ProcessLauncher::launch(const std::string& session, const std::vector<std::string>& argv) {
+    if (argv.empty()) return -1;
+    if (dryRun) return 0;
+
+    std::vector<char*> args;
+    for (size_t i = 0; i < argv.size(); ++i) args.push_back(const_cast<char*>(argv[i].c_str()));
+    args.push_back(NULL);
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t empty;
+    sigemptyset(&empty);
+    posix_spawnattr_setsigmask(&attr, &empty);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETPGROUP);
+
+    // Spawned and registered under the lock, so reapChildren() on another
+    // thread cannot handle this child's SIGCHLD before it is tracked
+    std::lock_guard<std::mutex> guard(lock);
+    pid_t pid = -1;
+    int err = posix_spawnp(&pid, args[0], NULL, &attr, args.data(), environ);
+    posix_spawnattr_destroy(&attr);
+
+    if (err != 0) {
+        LOG_WARN("Failed to launch ", argv[0], ": ", strerror(err));
+        return -1;
+    }
+
+    children[pid] = session;
+    sessions[session].insert(pid);
+    return pid;
+}
+
+// Private method called when the signalfd is readable
+void ProcessLauncher::reapChildren() {
+    // Drain the pending signal notifications
+    struct signalfd_siginfo info;
+    while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {}
+
+    // Only our own children are reaped: worker threads may be waiting for
+    // children of their own (system()), and waitpid(-1) would steal them.
+    std::vector<pid_t> exited;
+    std::vector<int> statuses;
+    std::vector<std::string> exitedSessions;
+    std::unique_lock<std::mutex> guard(lock);
+    for (std::map<pid_t, std::string>::const_iterator it = children.begin(); it != children.end(); ++it) {
+        int status = 0;
+        if (waitpid(it->first, &status, WNOHANG) == it->first) {
+            exited.push_back(it->first);
+            statuses.push_back(status);
+        }
+    }
+
+    for (size_t i = 0; i < exited.size(); ++i) {
+        pid_t pid = exited[i];
+        std::string session = children[pid];
+        children.erase(pid);
+        std::map<std::string, std::set<pid_t> >::iterator s = sessions.find(session);
+        if (s != sessions.end()) {
+            s->second.erase(pid);
+            if (s->second.empty()) sessions.erase(s);
+        }
+        exitedSessions.push_back(session);
+    }
+    guard.unlock();
+
+    for (size_t i = 0; i < exited.size(); ++i) {
+        if (onExit) onExit(exited[i], exitedSessions[i], statuses[i]);
+    }
+}
+
+std::set<pid_t> ProcessLauncher::pidsOf(const std::string& session) const {
+    std::lock_guard<std::mutex> guard(lock);
+    std::map<std::string, std::set<pid_t> >::const_iterator it = sessions.find(session);
+    return it == sessions.end() ? std::set<pid_t>() : it->second;
+}
+
+std::string ProcessLauncher::sessionOf(pid_t pid) const {
+    std::lock_guard<std::mutex> guard(lock);
+    std::map<pid_t, std::string>::const_iterator it = children.find(pid);
+    return it == children.end() ? std::string() : it->second;
+}
+
+void ProcessLauncher::setExitHandler(const ExitHandler& handler) {
+    onExit = handler;
+}
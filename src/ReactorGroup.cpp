@@ -0,0 +1,113 @@
+#include "../header/ReactorGroup.hpp"
+#include "../header/Logger.hpp"
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
+ReactorGroup::ReactorGroup(int port, int threads) : pinning(false), draining(false) {
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 0; i < threads; ++i) shards.push_back(std::unique_ptr<TcpServer>(new TcpServer(port)));
+}
+
+// Public method starting every shard
+/*
+    A previous process with more shards hands over more sockets than we use.
+    Closing a surplus one resets the connections waiting in its accept queue,
+    so the log says so; run the new server with at least as many threads to
+    avoid it.
+*/
+bool ReactorGroup::start(const std::vector<int>& inherited) {
+    for (size_t i = 0; i < inherited.size(); ++i) {
+        if (i < shards.size() && shards[i]->adoptListener(inherited[i])) continue;
+        if (i >= shards.size()) {
+            LOG_WARN("Closing surplus inherited listening socket (", inherited.size(), " handed over).");
+        }
+        close(inherited[i]);
+    }
+    for (size_t i = 0; i < shards.size(); ++i) {
+        if (!shards[i]->start()) return false;
+        listeners.push_back(shards[i]->listenFd());
+    }
+    LOG_INFO("Reactor threads: ", shards.size(), pinning ? " (pinned to CPUs)" : "");
+    return true;
+}
+
+// Public method running every shard
+/*
+    Shards 1..N-1 get their own threads; shard 0 runs here. The threads are
+    created now, after main() finished the set-up, so they inherit the blocked
+    SIGCHLD mask set by ProcessLauncher::attach().
+*/
+void ReactorGroup::run() {
+    for (size_t i = 1; i < shards.size(); ++i) {
+        threads.push_back(std::thread([this, i]() {
+            if (pinning) pinCurrentThread(i);
+            shards[i]->run();
+        }));
+    }
+    if (pinning) pinCurrentThread(0);
+    shards[0]->run();
+
+    // Shard 0 stopped: make sure the others follow (draining shards stop by
+    // themselves, within the drain timeout), then wait for them
+    if (!draining) stop();
+    for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+    threads.clear();
+}
+
+// Public method stopping every shard
+/*
+    TcpServer::stop() is not thread-safe, so it is posted to each shard and
+    runs on that shard's own thread.
+*/
+void ReactorGroup::stop() {
+    for (size_t i = 0; i < shards.size(); ++i) {
+        TcpServer* shard = shards[i].get();
+        shard->post([shard]() { shard->stop(); });
+    }
+}
+
+// Public method returning the listening sockets recorded by start()
+/*
+    Called on shard 0's thread: the other shards' TcpServer state belongs to
+    their own threads, so the descriptors are read once, before they run.
+*/
+std::vector<int> ReactorGroup::listenFds() const {
+    return listeners;
+}
+
+void ReactorGroup::drain(int timeoutMs) {
+    draining = true;
+    for (size_t i = 0; i < shards.size(); ++i) {
+        TcpServer* shard = shards[i].get();
+        shard->post([shard, timeoutMs]() { shard->drain(timeoutMs); });
+    }
+}
+
+// Private method pinning the calling thread to one CPU
+/*
+    The CPU is picked from the set the process is allowed to run on (taskset,
+    cgroups), so shard i goes to the i-th allowed CPU, wrapping around.
+*/
+void ReactorGroup::pinCurrentThread(size_t index) {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+
+    int count = CPU_COUNT(&allowed);
+    if (count == 0) return;
+    int wanted = static_cast<int>(index % count);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed)) continue;
+        if (wanted-- > 0) continue;
+
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+        if (err != 0) LOG_WARN("Pinning reactor ", index, " to CPU ", cpu, " failed: ", strerror(err));
+        return;
+    }
+}
@@ -0,0 +1,111 @@
+#include "../header/RingBuffer.hpp"
+#include <cstring>
+#include <algorithm>
+
+// Helper that rounds a size up to the next power of two
+static size_t roundUpPow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+RingBuffer::RingBuffer(size_t initialCapacity, size_t maxCapacity)
+    : capacity(roundUpPow2(initialCapacity)), maxCapacity(roundUpPow2(maxCapacity)), head(0), tail(0) {
+    data.reset(new char[capacity]);
+}
+
+RingBuffer::RingBuffer(RingBuffer&& other) noexcept
+    : data(std::move(other.data)), capacity(other.capacity), maxCapacity(other.maxCapacity),
+      head(other.head), tail(other.tail) {
+    other.capacity = 0;
+    other.head = other.tail = 0;
+}
+
+RingBuffer& RingBuffer::operator=(RingBuffer&& other) noexcept {
+    if (this != &other) {
+        data = std::move(other.data);
+        capacity = other.capacity;
+        maxCapacity = other.maxCapacity;
+        head = other.head;
+        tail = other.tail;
+        other.capacity = 0;
+        other.head = other.tail = 0;
+    }
+    return *this;
+}
+
+// Private method that doubles the capacity, keeping the buffered bytes in order
+bool RingBuffer::grow() {
+    if (capacity >= maxCapacity) return false;
+
+    size_t newCapacity = capacity * 2;
+    std::unique_ptr<char[]> bigger(new char[newCapacity]);
+    size_t n = size();
+    size_t start = head & (capacity - 1);
+    size_t first = std::min(n, capacity - start);
+    memcpy(bigger.get(), data.get() + start, first);
+    memcpy(bigger.get() + first, data.get(), n - first);
+
+    data = std::move(bigger);
+    capacity = newCapacity;
+    head = 0;
+    tail = n;
+    return true;
+}
+
+// Private method that rotates the buffered bytes to the start of the array
+void RingBuffer::linearize() {
+    size_t n = size();
+    size_t start = head & (capacity - 1);
+    if (start + n <= capacity) return;  // already contiguous
+
+    std::rotate(data.get(), data.get() + start, data.get() + capacity);
+    head = 0;
+    tail = n;
+}
+
+size_t RingBuffer::writableSpan(char** out) {
+    if (freeSpace() == 0 && !grow()) return 0;
+
+    size_t start = tail & (capacity - 1);
+    size_t headIdx = head & (capacity - 1);
+    size_t span = (start >= headIdx && size() != capacity) ? capacity - start : headIdx - start;
+    if (size() == 0) {
+        // Empty ring: restart at index 0 so the whole array is one span
+        head = tail = 0;
+        start = 0;
+        span = capacity;
+    }
+    *out = data.get() + start;
+    return span;
+}
+
+void RingBuffer::consume(size_t n) {
+    head += std::min(n, size());
+}
+
+size_t RingBuffer::find(char c, size_t from) const {
+    size_t n = size();
+    if (from >= n) return npos;
+
+    // Search the (at most two) contiguous segments with memchr
+    size_t start = (head + from) & (capacity - 1);
+    size_t first = std::min(n - from, capacity - start);
+    const void* hit = memchr(data.get() + start, c, first);
+    if (hit != NULL) return from + (static_cast<const char*>(hit) - (data.get() + start));
+
+    size_t second = n - from - first;
+    if (second == 0) return npos;
+    hit = memchr(data.get(), c, second);
+    if (hit != NULL) return from + first + (static_cast<const char*>(hit) - data.get());
+    return npos;
+}
+
+const char* RingBuffer::contiguous(size_t offset, size_t len) {
+    size_t start = (head + offset) & (capacity - 1);
+    if (start + len > capacity) {
+        linearize();
+        start = offset;
+    }
+    return data.get() + start;
+}
@@ -0,0 +1,316 @@
+#include "../header/ScreenStreamer.hpp"
+#include "../header/CommandDispatcher.hpp"
+#include "../header/ImageEncoder.hpp"
+#include "../header/Logger.hpp"
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Edge length of the tiles frames are compared and sent in
+static const int TILE = 64;
+
+struct ScreenStreamer::Session {
+    TcpServer* server;
+    TcpServer::ConnectionId client;
+    CommandDispatcher* dispatcher;
+    bool binary;
+    uint64_t requestId;
+
+    int timer_fd = -1;
+    int targetMs = 0;             // interval of the requested frame rate
+    int intervalMs = 0;           // current interval, longer while the client lags
+    int maxWidth = 0;
+    bool busy = false;            // a worker is capturing / encoding (loop thread only)
+    bool stopped = false;
+    uint64_t sequence = 0;
+
+    // Used by the one worker job running at a time (see busy)
+    Frame captured;
+    Frame scaled;
+    Frame previous;
+    bool hasPrevious = false;
+    std::string scratch;
+};
+
+ScreenStreamer::ScreenStreamer(FrameSource& source, ThreadPool& pool) : source(source), pool(pool) {}
+
+ScreenStreamer::~ScreenStreamer() {
+    for (std::map<Key, std::shared_ptr<Session> >::iterator it = sessions.begin(); it != sessions.end(); ++it) {
+        close(it->second->timer_fd);
+    }
+}
+
+void ScreenStreamer::addShard(TcpServer& server, CommandDispatcher& dispatcher) {
+    std::lock_guard<std::mutex> guard(lock);
+    dispatchers[&server] = &dispatcher;
+}
+
+// Private method (re)arming a session's periodic timer
+/*
+    int timerfd_settime(int fd, int flags, const struct itimerspec* new_value, struct itimerspec* old_value);
+        it_value is the first expiry, it_interval the period after it. Ticks
+        missed while the loop was busy are counted, not queued: one read
+        returns them all, so a slow loop never sees a burst of frames.
+*/
+void ScreenStreamer::setInterval(Session& session, int intervalMs) {
+    session.intervalMs = intervalMs;
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_interval.tv_sec = intervalMs / 1000;
+    spec.it_interval.tv_nsec = static_cast<long>(intervalMs % 1000) * 1000000L;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(session.timer_fd, 0, &spec, NULL) < 0) {
+        LOG_WARN("timerfd_settime failed: ", strerror(errno));
+    }
+}
+
+bool ScreenStreamer::start(TcpServer& server, TcpServer::ConnectionId client, bool binary, uint64_t requestId,
+                           int fps, int maxWidth) {
+    if (fps < 1) fps = 1;
+    if (fps > MAX_FPS) fps = MAX_FPS;
+    int intervalMs = 1000 / fps;
+
+    std::lock_guard<std::mutex> guard(lock);
+    std::map<TcpServer*, CommandDispatcher*>::iterator shard = dispatchers.find(&server);
+    if (shard == dispatchers.end()) return false;
+
+    std::shared_ptr<Session>& session = sessions[Key(&server, client)];
+    if (!session) {
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (fd < 0) {
+            LOG_ERROR("timerfd_create failed: ", strerror(errno));
+            sessions.erase(Key(&server, client));
+            return false;
+        }
+        session = std::make_shared<Session>();
+        session->server = &server;
+        session->client = client;
+        session->dispatcher = shard->second;
+        session->binary = binary;
+        session->requestId = requestId;
+        session->timer_fd = fd;
+
+        std::weak_ptr<Session> weak = session;
+        if (!server.watchFd(fd, EPOLLIN, [this, weak](uint32_t) {
+                std::shared_ptr<Session> ticked = weak.lock();
+                if (ticked) onTick(ticked);
+            })) {
+            close(fd);
+            sessions.erase(Key(&server, client));
+            return false;
+        }
+    }
+    session->targetMs = intervalMs;
+    session->maxWidth = maxWidth;
+    setInterval(*session, intervalMs);
+    return true;
+}
+
+bool ScreenStreamer::active(TcpServer& server, TcpServer::ConnectionId client) {
+    std::lock_guard<std::mutex> guard(lock);
+    return sessions.count(Key(&server, client)) != 0;
+}
+
+// Private method ending a session (the caller holds the lock)
+/*
+    A frame that a worker is encoding right now still holds the session; its
+    result is dropped in onFrame() because "stopped" is set.
+*/
+void ScreenStreamer::remove(const std::shared_ptr<Session>& session) {
+    session->server->unwatchFd(session->timer_fd);
+    close(session->timer_fd);
+    session->timer_fd = -1;
+    session->stopped = true;
+    sessions.erase(Key(session->server, session->client));
+}
+
+bool ScreenStreamer::stop(TcpServer& server, TcpServer::ConnectionId client) {
+    std::shared_ptr<Session> session;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        std::map<Key, std::shared_ptr<Session> >::iterator it = sessions.find(Key(&server, client));
+        if (it == sessions.end()) return false;
+        session = it->second;
+        remove(session);
+    }
+
+    // Binary clients: close the stream request, after the frames still queued
+    if (session->binary) {
+        CommandContext end(server, client);
+        end.binary = true;
+        end.requestId = session->requestId;
+        end.output = "Stream stopped.\n";
+        session->dispatcher->push(client, end);
+    }
+    LOG_INFO("Stream to client ", client, " stopped after ", session->sequence, " frames.");
+    return true;
+}
+
+void ScreenStreamer::onDisconnect(TcpServer& server, TcpServer::ConnectionId client) {
+    std::lock_guard<std::mutex> guard(lock);
+    std::map<Key, std::shared_ptr<Session> >::iterator it = sessions.find(Key(&server, client));
+    if (it != sessions.end()) remove(it->second);
+}
+
+void ScreenStreamer::stopAll(TcpServer& server) {
+    std::vector<TcpServer::ConnectionId> clients;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (std::map<Key, std::shared_ptr<Session> >::iterator it = sessions.begin(); it != sessions.end(); ++it) {
+            if (it->first.first == &server) clients.push_back(it->first.second);
+        }
+    }
+    for (size_t i = 0; i < clients.size(); ++i) stop(server, clients[i]);
+}
+
+// Private method deciding on each timer tick whether to send a frame
+/*
+    A tick is skipped while the last frame is still being encoded, and backs
+    the rate off while the client has not read the previous frames: a frame
+    still queued in the dispatcher, or more than half the outbox limit queued
+    in the outbox and the kernel together. The capture itself is skipped too,
+    so a lagging client costs no CPU.
+*/
+void ScreenStreamer::onTick(const std::shared_ptr<Session>& session) {
+    uint64_t expirations = 0;
+    if (read(session->timer_fd, &expirations, sizeof(expirations)) < 0 && errno == EAGAIN) return;
+    if (session->busy) return;
+
+    TcpServer& server = *session->server;
+    if (session->dispatcher->queuedAttachments(session->client) > 0 ||
+        server.pendingBytes(session->client) + server.unackedBytes(session->client) > server.outboxLimit() / 2) {
+        if (session->intervalMs < MAX_INTERVAL_MS) {
+            int slower = session->intervalMs * 2;
+            setInterval(*session, slower < MAX_INTERVAL_MS ? slower : MAX_INTERVAL_MS);
+            LOG_DEBUG("Stream to client ", session->client, " lags, interval ", session->intervalMs, " ms.");
+        }
+        return;
+    }
+
+    session->busy = true;
+    std::shared_ptr<Session> job = session;
+    FrameSource* frames = &source;
+    int maxWidth = session->maxWidth;
+    bool queued = pool.submit([this, job, frames, maxWidth]() {
+        std::shared_ptr<std::string> payload = std::make_shared<std::string>();
+        std::string header;
+        int tiles = encodeChanges(*frames, *job, maxWidth, *payload);
+        if (tiles > 0) {
+            bool compressed = ImageEncoder::compress(*payload, job->scratch);
+            header = "Frame: " + std::to_string(job->sequence + 1) + " " + std::to_string(job->previous.width) +
+                     "x" + std::to_string(job->previous.height) + ", " + std::to_string(tiles) + " tiles, " +
+                     (compressed ? "deflate " : "raw ") + std::to_string(payload->size()) + " bytes\n";
+        }
+        job->server->post([this, job, payload, header]() { onFrame(job, payload, header); });
+    });
+    if (!queued) session->busy = false;   // workers saturated: try again next tick
+}
+
+// Private method sending an encoded frame (event loop thread)
+/*
+    An empty header means nothing changed (or capture failed): no frame is
+    sent. Once the client has read everything, a backed-off interval moves a
+    quarter of the way back to the target.
+*/
+void ScreenStreamer::onFrame(const std::shared_ptr<Session>& session, const std::shared_ptr<std::string>& payload,
+                             const std::string& header) {
+    session->busy = false;
+    if (session->stopped) return;
+
+    if (!header.empty()) {
+        ++session->sequence;
+        CommandContext frame(*session->server, session->client);
+        frame.output = header;
+        frame.attachment = payload;
+        frame.acknowledge = false;
+        frame.binary = session->binary;
+        frame.requestId = session->requestId;
+        frame.partial = true;
+        session->dispatcher->push(session->client, frame);
+    }
+
+    TcpServer& server = *session->server;
+    if (session->intervalMs > session->targetMs && session->dispatcher->queuedAttachments(session->client) == 0 &&
+        server.pendingBytes(session->client) + server.unackedBytes(session->client) == 0) {
+        int faster = session->intervalMs * 3 / 4;
+        setInterval(*session, faster > session->targetMs ? faster : session->targetMs);
+    }
+}
+
+// Helper comparing two byte ranges, stopping at the first difference
+/*
+    SSE2 compares 16 bytes per instruction; a changed tile usually differs in
+    its first rows, so the early exit keeps changed tiles cheap and unchanged
+    ones cost one pass over their bytes.
+*/
+static bool sameBytes(const uint8_t* a, const uint8_t* b, size_t length) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= length; i += 16) {
+        __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(left, right)) != 0xFFFF) return false;
+    }
+#endif
+    return memcmp(a + i, b + i, length - i) == 0;
+}
+
+// Helper appending a 16-bit big-endian number
+static void putUint16(std::string& out, int value) {
+    out += static_cast<char>(value >> 8);
+    out += static_cast<char>(value);
+}
+
+// Private method capturing a frame and collecting the tiles that changed
+/*
+    Runs on a worker. The new frame becomes "previous" by swapping buffers, so
+    the old one is reused by the next capture and nothing is allocated once
+    the buffers have grown. Returns the number of tiles in "payload", or -1 if
+    the capture failed.
+*/
+int ScreenStreamer::encodeChanges(FrameSource& source, Session& session, int maxWidth, std::string& payload) {
+    if (!source.capture(session.captured)) return -1;
+    Frame& frame = ImageEncoder::downscale(session.captured, maxWidth, session.scaled) ? session.scaled
+                                                                                       : session.captured;
+
+    bool keyFrame = !session.hasPrevious || session.previous.width != frame.width ||
+                    session.previous.height != frame.height;
+    const size_t stride = static_cast<size_t>(frame.width) * 3;
+    int tiles = 0;
+
+    for (int y = 0; y < frame.height; y += TILE) {
+        int height = frame.height - y < TILE ? frame.height - y : TILE;
+        for (int x = 0; x < frame.width; x += TILE) {
+            int width = frame.width - x < TILE ? frame.width - x : TILE;
+            const size_t offset = static_cast<size_t>(y) * stride + static_cast<size_t>(x) * 3;
+            const size_t rowBytes = static_cast<size_t>(width) * 3;
+
+            if (!keyFrame) {
+                bool same = true;
+                for (int row = 0; row < height && same; ++row) {
+                    same = sameBytes(frame.rgb.data() + offset + row * stride,
+                                     session.previous.rgb.data() + offset + row * stride, rowBytes);
+                }
+                if (same) continue;
+            }
+
+            putUint16(payload, x);
+            putUint16(payload, y);
+            putUint16(payload, width);
+            putUint16(payload, height);
+            for (int row = 0; row < height; ++row) {
+                payload.append(reinterpret_cast<const char*>(frame.rgb.data() + offset + row * stride), rowBytes);
+            }
+            ++tiles;
+        }
+    }
+
+    std::swap(session.previous, frame);
+    session.hasPrevious = true;
+    return tiles;
+}
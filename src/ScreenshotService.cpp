@@ -0,0 +1,69 @@
+#include "../header/ScreenshotService.hpp"
+#include "../header/ImageEncoder.hpp"
+#include "../header/AppRegistry.hpp"
+#include "../header/Logger.hpp"
+
+ScreenshotService::ScreenshotService(std::unique_ptr<FrameSource> source)
+    : source(std::move(source)), pool(std::make_shared<BufferPool>()),
+      lastMaxWidth(-1), lastCaptureMs(0), cacheMs(0) {}
+
+void ScreenshotService::setCacheTime(int milliseconds) {
+    std::lock_guard<std::mutex> guard(captureLock);
+    cacheMs = milliseconds;
+}
+
+// Private method handing out an empty image buffer from the pool
+/*
+    The deleter returns the buffer (with its capacity) to the pool instead of
+    freeing it. It holds its own reference to the pool, so an image that is
+    still being sent when the service goes away is freed normally.
+*/
+std::shared_ptr<std::string> ScreenshotService::acquireBuffer() {
+    std::string* buffer = NULL;
+    {
+        std::lock_guard<std::mutex> guard(pool->lock);
+        if (!pool->images.empty()) {
+            buffer = pool->images.back();
+            pool->images.pop_back();
+        }
+    }
+    if (buffer == NULL) buffer = new std::string();
+    buffer->clear();
+
+    std::shared_ptr<BufferPool> owner = pool;
+    return std::shared_ptr<std::string>(buffer, [owner](std::string* released) {
+        std::lock_guard<std::mutex> guard(owner->lock);
+        if (owner->images.size() < POOL_SIZE) owner->images.push_back(released);
+        else delete released;
+    });
+}
+
+bool ScreenshotService::take(int maxWidth, Shot& shot) {
+    std::lock_guard<std::mutex> guard(captureLock);
+
+    int64_t now = AppRegistry::nowMs();
+    if (last.data && maxWidth == lastMaxWidth && now - lastCaptureMs < cacheMs) {
+        shot = last;
+        shot.cached = true;
+        return true;
+    }
+
+    if (!source->capture(captured)) return false;
+    const Frame& frame = ImageEncoder::downscale(captured, maxWidth, scaled) ? scaled : captured;
+
+    std::shared_ptr<std::string> image = acquireBuffer();
+    if (!ImageEncoder::encode(frame, *image)) return false;
+
+    last.data = image;
+    last.width = frame.width;
+    last.height = frame.height;
+    last.format = ImageEncoder::format();
+    last.cached = false;
+    lastMaxWidth = maxWidth;
+    lastCaptureMs = AppRegistry::nowMs();
+
+    shot = last;
+    LOG_DEBUG("Screenshot ", frame.width, "x", frame.height, " encoded in ", lastCaptureMs - now,
+              " ms, ", image->size(), " bytes.");
+    return true;
+}
@@ -0,0 +1,214 @@
+#include "../header/ServerLifecycle.hpp"
+#include "../header/Logger.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+
+ServerLifecycle::ServerLifecycle(ReactorGroup& reactors)
+    : reactors(reactors), signal_fd(-1), handoff_fd(-1), handedOff(false), drainSeconds(5), stopping(false) {}
+
+ServerLifecycle::~ServerLifecycle() {
+    if (signal_fd >= 0) close(signal_fd);
+    if (handoff_fd >= 0) {
+        close(handoff_fd);
+        if (!handedOff) unlink(handoffPath.c_str());
+    }
+}
+
+void ServerLifecycle::setDrainTimeout(int seconds) {
+    drainSeconds = seconds < 0 ? 0 : seconds;
+}
+
+// Helper filling a Unix socket address; false if the path is too long
+static bool unixAddress(const std::string& path, struct sockaddr_un& address) {
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        LOG_ERROR("Bad handoff socket path: \"", path, "\"");
+        return false;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+// Public method registering the shutdown signals and the handoff socket
+/*
+    SIGTERM / SIGINT arrive through a signalfd, like SIGHUP in ConfigStore.
+
+    The handoff socket file of a previous server is removed before bind():
+    either that server is gone (stale file) or it already handed us its
+    sockets in inherit().
+*/
+bool ServerLifecycle::attach(TcpServer& loop, const std::string& path) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    if (pthread_sigmask(SIG_BLOCK, &mask, NULL) != 0) {
+        LOG_ERROR("sigprocmask failed: ", strerror(errno));
+        return false;
+    }
+    signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd < 0) {
+        LOG_ERROR("signalfd failed: ", strerror(errno));
+        return false;
+    }
+    if (!loop.watchFd(signal_fd, EPOLLIN, [this](uint32_t) { onSignal(); })) return false;
+
+    if (path.empty()) return true;
+
+    struct sockaddr_un address;
+    if (!unixAddress(path, address)) return false;
+    handoff_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (handoff_fd < 0) {
+        LOG_ERROR("Handoff socket creation failed: ", strerror(errno));
+        return false;
+    }
+    unlink(path.c_str());
+    if (bind(handoff_fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(handoff_fd, 1) < 0) {
+        LOG_ERROR("Handoff socket ", path, " failed: ", strerror(errno));
+        close(handoff_fd);
+        handoff_fd = -1;
+        return false;
+    }
+    handoffPath = path;
+    LOG_INFO("Listening for a replacement server on ", path);
+    return loop.watchFd(handoff_fd, EPOLLIN, [this](uint32_t) { onHandoff(); });
+}
+
+void ServerLifecycle::shutdown(const char* reason) {
+    if (stopping.exchange(true)) return;
+    LOG_INFO("Shutting down (", reason, "), draining clients for up to ", drainSeconds.load(), " s.");
+    reactors.drain(drainSeconds * 1000);
+}
+
+// Private method called when the signalfd is readable
+void ServerLifecycle::onSignal() {
+    struct signalfd_siginfo info;
+    int signal = 0;
+    while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) signal = static_cast<int>(info.ssi_signo);
+    if (signal != 0) shutdown(signal == SIGINT ? "SIGINT" : "SIGTERM");
+}
+
+// Private method passing the listening sockets to a replacement process
+/*
+    ssize_t sendmsg(int sockfd, const struct msghdr* msg, int flags);
+        An SCM_RIGHTS control message carries descriptors: the receiver gets
+        new descriptors for the same open sockets. Once sendmsg() returned
+        they are in flight in the kernel, so closing ours (drain() does) does
+        not close the sockets.
+
+    The message text is "listeners <count>\n"; the count lets the receiver
+    check that the control message was not truncated.
+*/
+void ServerLifecycle::onHandoff() {
+    int client = accept4(handoff_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (client < 0) return;
+
+    std::vector<int> fds = stopping ? std::vector<int>() : reactors.listenFds();
+    if (fds.size() > static_cast<size_t>(MAX_HANDOFF_FDS)) fds.resize(MAX_HANDOFF_FDS);
+    std::string text = "listeners " + std::to_string(fds.size()) + "\n";
+
+    struct iovec iov;
+    iov.iov_base = &text[0];
+    iov.iov_len = text.size();
+    char control[CMSG_SPACE(sizeof(int) * MAX_HANDOFF_FDS)];
+    memset(control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (!fds.empty()) {
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+        memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+    }
+
+    bool sent = sendmsg(client, &msg, MSG_NOSIGNAL) == static_cast<ssize_t>(text.size());
+    close(client);
+    if (!sent) {
+        LOG_WARN("Handing the listening sockets over failed: ", strerror(errno));
+        return;
+    }
+    if (fds.empty()) return;  // already shutting down: the new server binds its own
+
+    LOG_INFO("Handed ", fds.size(), " listening sockets to a new server process.");
+    handedOff = true;
+    shutdown("replaced by a new server");
+}
+
+// Public method taking the listening sockets of a running server
+/*
+    ssize_t recvmsg(int sockfd, struct msghdr* msg, int flags);
+        MSG_CMSG_CLOEXEC sets close-on-exec on the received descriptors, so
+        launched browsers do not inherit them.
+
+    A missing or stale socket file (ENOENT / ECONNREFUSED) just means there is
+    no server to replace.
+*/
+bool ServerLifecycle::inherit(const std::string& path, std::vector<int>& fds) {
+    fds.clear();
+    struct sockaddr_un address;
+    if (path.empty() || !unixAddress(path, address)) return false;
+
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) return false;
+    struct timeval timeout = { 2, 0 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (connect(sock, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        close(sock);
+        return false;
+    }
+
+    char text[64];
+    struct iovec iov;
+    iov.iov_base = text;
+    iov.iov_len = sizeof(text) - 1;
+    char control[CMSG_SPACE(sizeof(int) * MAX_HANDOFF_FDS)];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    close(sock);
+    if (n <= 0) {
+        LOG_WARN("No listening sockets from the running server: ", n < 0 ? strerror(errno) : "closed");
+        return false;
+    }
+    text[n] = '\0';
+
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        const unsigned char* data = CMSG_DATA(cmsg);
+        for (size_t i = 0; i < count; ++i) {
+            int fd;
+            memcpy(&fd, data + i * sizeof(int), sizeof(int));
+            fds.push_back(fd);
+        }
+    }
+
+    unsigned long expected = 0;
+    if (sscanf(text, "listeners %lu", &expected) != 1 || (msg.msg_flags & MSG_CTRUNC) || expected != fds.size()) {
+        LOG_WARN("Bad handoff message from the running server, binding new sockets.");
+        for (size_t i = 0; i < fds.size(); ++i) close(fds[i]);
+        fds.clear();
+        return false;
+    }
+    if (fds.empty()) return false;
+    LOG_INFO("Took over ", fds.size(), " listening sockets from the running server.");
+    return true;
+}
@@ -1,24 +1,56 @@
 #include "../header/TCPServer.hpp"
-#include <iostream>
+#include "../header/Metrics.hpp"
+#include "../header/Logger.hpp"
 #include <unistd.h>
+#include <algorithm>
 #include <cstring>
+#include <cerrno>
+#include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>  // For SIOCOUTQ
 #include <netinet/in.h>
+#include <netinet/tcp.h>  // For TCP_NODELAY, TCP_KEEPIDLE
 #include <arpa/inet.h>  // For inet_ntoa function
+#include <time.h>
 
-// Constructor to initialize server parameters (port and buffer size)
+// Helper returning monotonic time in milliseconds
+static int64_t monotonicMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+// io_uring user_data: the request kind in the low two bits, the ConnectionId
+// above them (the top two generation bits are lost, which only matters after
+// 2^30 connections on one fd number)
+enum RingTag { TAG_NONE = 0, TAG_ACCEPT = 1, TAG_RECV = 2, TAG_SEND = 3 };
+
+static uint64_t ringUserData(RingTag tag, uint64_t id) {
+    return (id << 2) | tag;
+}
+
+// Constructor to initialize server parameters (port and backlog)
 /*
 server_fd(-1) initializes the server_fd (server socket file descriptor) to -1. This indicates that no socket has been created yet. A valid socket file descriptor will be assigned later when the socket is created.
 
-client_fd(-1) initializes the client_fd (client socket file descriptor) to -1. It also indicates that no client connection has been established yet. It will be assigned when a client connects.
+epoll_fd(-1), wake_fd(-1), idle_fd(-1) and drain_fd(-1) initialize the epoll instance, the post() wakeup, the idle check and the drain check timer descriptors to -1. The first three are created in start() once the listening socket is ready, the last one by drain().
+
+useRing(false) selects the epoll backend until setIoBackend() asks for io_uring; the ring itself is created in start().
 
 port(port) initializes the port member variable with the value passed as an argument to the constructor. This is the port number on which the server will listen for connections.
 
-addrlen(sizeof(address)) initializes the addrlen variable with the size of the address structure. This is the length of the address structure that will be used when calling functions like accept().
+backlog(backlog) is passed to listen(). It is the length of the kernel queue of connections that finished the TCP handshake but were not accept()ed yet.
 
 */
-TcpServer::TcpServer(int port)
-    : server_fd(-1), client_fd(-1), port(port), addrlen(sizeof(address)) {
+TcpServer::TcpServer(int port, int backlog)
+    : server_fd(-1), epoll_fd(-1), wake_fd(-1), idle_fd(-1), drain_fd(-1), draining(false), drainDeadlineMs(0),
+      port(port), backlog(backlog), running(false), generation(0), outboxHighWater(256 * 1024), idleTimeoutMs(0), idleTimers(IDLE_WHEEL_SLOTS, IDLE_TICK_MS),
+      noDelay(false), keepAliveSeconds(0), capture(NULL), loopTimeMs(monotonicMs()), useRing(false), acceptArmed(false),
+      dispatchingFd(-1) {
     /*
     void* memset(void* ptr, int value, size_t num);
         ptr: A pointer to the block of memory you want to set. This can be a pointer to an array or a structure.
@@ -26,14 +58,21 @@ TcpServer::TcpServer(int port)
         num: The number of bytes to be set to the specified value.
     */
     memset(&address, 0, sizeof(address));  // Initialize the address structure to 0
-    memset(buffer, 0, BUFFER_SIZE);        // Initialize buffer to 0
 }
 
-// Destructor to clean up open file descriptors (client and server sockets)
+// Destructor to clean up open file descriptors (client, epoll and server sockets)
 TcpServer::~TcpServer() {
-    if (client_fd >= 0) close(client_fd);  // Close client socket if open
+    for (std::unordered_map<int, Connection>::iterator it = connections.begin(); it != connections.end(); ++it) {
+        if (ring.active()) shutdown(it->first, SHUT_RDWR);  // ends the recv holding the socket open
+        close(it->first);                  // Close every client socket still open
+    }
+    connections.clear();
+    if (wake_fd >= 0) close(wake_fd);      // Close wakeup eventfd if open
+    if (idle_fd >= 0) close(idle_fd);      // Close idle check timer if open
+    if (drain_fd >= 0) close(drain_fd);    // Close drain check timer if open
+    if (epoll_fd >= 0) close(epoll_fd);    // Close epoll instance if open
     if (server_fd >= 0) close(server_fd);  // Close server socket if open
-    std::cout << "Server sockets closed.\n";
+    LOG_INFO("Server sockets closed.");
 }
 
 // Private method to create a socket
@@ -56,9 +95,9 @@ bool TcpServer::setupSocket() {
         A value of 0 means that the system should use the default protocol for the specified socket type (SOCK_STREAM in this case). For SOCK_STREAM, the default protocol is TCP.
         This argument is often set to 0 because it's generally implied by the socket type (SOCK_STREAM already indicates the use of TCP).
     */
-    server_fd = socket(AF_INET, SOCK_STREAM, 0);
+    server_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (server_fd < 0) {
-        perror("Socket creation failed");
+        LOG_ERROR("Socket creation failed: ", strerror(errno));
         return false;
     }
 
@@ -88,10 +127,16 @@ bool TcpServer::setupSocket() {
         
         opt = 1: This means "enable" these options.
 
+    optname is a number, not a bit mask, so every option needs its own call
+    (SO_REUSEADDR | SO_REUSEPORT is 2 | 15 == 15, which only sets SO_REUSEPORT).
+
+    With SO_REUSEPORT each reactor thread (see ReactorGroup) binds its own
+    socket to the same port and the kernel spreads new connections over them.
     */
     int opt = 1;
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt))) {
-        perror("setsockopt failed");
+    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) ||
+        setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt))) {
+        LOG_ERROR("setsockopt failed: ", strerror(errno));
         return false;
     }
 
@@ -104,7 +149,7 @@ bool TcpServer::setupSocket() {
     address.sin_addr.s_addr = INADDR_ANY;  // Accept connections from any address
     address.sin_port = htons(port);        // Convert port to network byte order
 
-    std::cout << "1- Socket setup complete.\n";
+    LOG_INFO("1- Socket setup complete.");
 
     return true;
 }
@@ -127,11 +172,11 @@ bool TcpServer::setupSocket() {
 bool TcpServer::bindSocket() {
     // Bind server socket to the defined address
     if (bind(server_fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
-        perror("Bind failed");
+        LOG_ERROR("Bind failed: ", strerror(errno));
         return false;
     }
 
-    std::cout << "2- Socket binding complete " << std::endl;
+    LOG_INFO("2- Socket binding complete");
 
     return true;
 }
@@ -147,43 +192,150 @@ bool TcpServer::bindSocket() {
 It just tells the OS: 🗣️ “I’m ready to accept connections.”
 */
 bool TcpServer::listenSocket() {
-    // Listen for incoming connections (with a backlog of 3 clients)
-    if (listen(server_fd, 3) < 0) {
-        perror("Listen failed");
+    // Listen for incoming connections (with the configured backlog)
+    if (listen(server_fd, backlog) < 0) {
+        LOG_ERROR("Listen failed: ", strerror(errno));
         return false;
     }
 
-    std::cout << "3- Server listening on port: " << port << std::endl;
+    LOG_INFO("3- Server listening on port: ", port);
 
     return true;
 }
 
-// Private method to accept an incoming client connection
+// Private method to create the epoll instance and register the listening socket
 /*
-int accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen);
-    ➤ What accept() does:
-    Blocks and waits until a client tries to connect.
+    int epoll_create1(int flags);
+        Creates an epoll instance: a kernel object that watches many file descriptors at once
+        and reports which of them are ready. EPOLL_CLOEXEC closes it automatically in exec()ed children.
+
+    int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+        Adds (EPOLL_CTL_ADD), changes (EPOLL_CTL_MOD) or removes (EPOLL_CTL_DEL) a watched descriptor.
 
-    Accepts the connection.
+        EPOLLIN  : notify when the descriptor is readable (for server_fd: a client is waiting in accept queue).
+        EPOLLOUT : notify when the descriptor is writable again.
+        EPOLLET  : edge-triggered. We are told only once per state change, so every handler must
+                   keep reading / writing until the call fails with EAGAIN.
+*/
+bool TcpServer::setupEpoll() {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        LOG_ERROR("epoll_create1 failed: ", strerror(errno));
+        return false;
+    }
 
-    Returns a new socket descriptor (client_fd) used to communicate with the connected client.
+    // io_uring backend: accepts through the ring instead of epoll
+    if (useRing && !setupRing()) {
+        LOG_WARN("io_uring backend unavailable, using epoll.");
+        useRing = false;
+    }
 
-    The original server_fd continues listening for new connections.
+    if (ring.active()) {
+        armAccept();
+    } else {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.fd = server_fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &ev) < 0) {
+            LOG_ERROR("epoll_ctl failed: ", strerror(errno));
+            return false;
+        }
+    }
 
-*/
-bool TcpServer::acceptClient() {
-    // Accept an incoming connection and get the client socket
-    client_fd = accept(server_fd, (struct sockaddr*)&address, (socklen_t*)&addrlen);
-    if (client_fd < 0) {
-        perror("Accept failed");
+    /*
+    int eventfd(unsigned int initval, int flags);
+        A counter the kernel exposes as a descriptor. post() writes to it from any
+        thread, which makes epoll_wait() return so the loop runs the posted tasks.
+    */
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        LOG_ERROR("eventfd failed: ", strerror(errno));
         return false;
     }
+    if (!watchFd(wake_fd, EPOLLIN, [this](uint32_t) { runPosted(); })) return false;
 
-    std::cout << "Client connected.\n";
+    // Idle check: ticks once a second while an idle timeout is set
+    idle_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (idle_fd < 0) {
+        LOG_ERROR("timerfd_create failed: ", strerror(errno));
+        return false;
+    }
+    if (!watchFd(idle_fd, EPOLLIN, [this](uint32_t) { closeIdleClients(); })) return false;
+    armIdleTimer();
+
+    LOG_INFO("4- Event loop ready (", ring.active() ? "io_uring" : "epoll", ").");
     return true;
 }
 
-// Public method to start the server (handles all steps: setup, listen, accept)
+// Private method to accept every pending client connection
+/*
+int accept4(int sockfd, struct sockaddr *addr, socklen_t *addrlen, int flags);
+    ➤ What accept4() does:
+    Same as accept(), but the new socket is created with the given flags
+    (SOCK_NONBLOCK | SOCK_CLOEXEC), so no extra fcntl() call is needed.
+
+    Because server_fd is non-blocking and edge-triggered, we loop until accept4()
+    fails with EAGAIN: that means the kernel accept queue is empty.
+
+    The original server_fd continues listening for new connections.
+*/
+void TcpServer::acceptClients() {
+    while (true) {
+        struct sockaddr_in peer;
+        socklen_t peerLen = sizeof(peer);
+        uint64_t started = Metrics::now();
+        int fd = accept4(server_fd, (struct sockaddr*)&peer, &peerLen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) LOG_ERROR("Accept failed: ", strerror(errno));
+            return;
+        }
+        addConnection(fd, peer, started);
+    }
+}
+
+// Private method registering an accepted client socket
+/*
+    With epoll the socket is added edge-triggered for EPOLLIN; with io_uring
+    its multishot recv is armed instead. Returns false if the socket had to
+    be closed.
+*/
+bool TcpServer::addConnection(int fd, const struct sockaddr_in& peer, uint64_t started) {
+    if (!ring.active()) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            LOG_ERROR("epoll_ctl failed: ", strerror(errno));
+            close(fd);
+            return false;
+        }
+    }
+
+    configureSocket(fd);
+
+    Connection& conn = connections.emplace(fd, Connection{fd, 0, peer,
+        RingBuffer(INBOX_INITIAL, INBOX_MAX), FrameParser(), OutboundQueue(sendPool), false, false, false,
+        loopTimeMs, std::function<void()>(), false, false, std::unique_ptr<UringSend>(), 0, false}).first->second;
+    conn.id = (static_cast<ConnectionId>(++generation) << 32) | static_cast<uint32_t>(fd);
+    if (capture != NULL) conn.captureStream = capture->opened();
+    if (idleTimeoutMs > 0) idleTimers.schedule(conn.id, loopTimeMs + idleTimeoutMs);
+
+    Metrics::instance().add(Metrics::CONNECTIONS_ACCEPTED);
+    Metrics::instance().recordStage(Metrics::STAGE_ACCEPT, Metrics::now() - started);
+
+    LOG_INFO("Client connected: ", inet_ntoa(peer.sin_addr), ":", ntohs(peer.sin_port));
+    ConnectionId id = conn.id;
+    if (onConnect) onConnect(id);
+
+    Connection* connected = findConnection(id);  // the handler may have closed it
+    if (connected != NULL && ring.active()) armRecv(*connected);
+    return connected != NULL;
+}
+
+// Public method to start the server (handles all steps: setup, bind, listen, epoll)
 /*
 
     This line uses the logical AND (&&) operator, which in C++ is short-circuiting.
@@ -193,78 +345,939 @@ bool TcpServer::acceptClient() {
 
         Only if setupSocket() returns true, then bindSocket() is called.
 
-        Then listenSocket(), and finally acceptClient() — each one depends on the one before.
+        Then listenSocket(), and finally setupEpoll() — each one depends on the one before.
 
+    Clients are no longer accepted here: run() accepts them as they arrive.
 */
 bool TcpServer::start() {
-    return setupSocket() && bindSocket() && listenSocket() && acceptClient();
+    if (server_fd >= 0) return setupEpoll();  // adopted listener: already bound and listening
+    return setupSocket() && bindSocket() && listenSocket() && setupEpoll();
 }
 
-// Public method to send data to the connected client
-bool TcpServer::sendData(const std::string& data) {
-    if (client_fd < 0) 
-    {
-        std::cerr << "No client connected to server.\n";
-        return false; // No client connected, return false
+// Public method taking over a listening socket
+/*
+    int getsockname(int sockfd, struct sockaddr* addr, socklen_t* addrlen);
+        The local address the socket is bound to: used to check that the
+        inherited socket is on our port.
+
+    SO_ACCEPTCONN reads as 1 only for a socket in the listening state.
+
+    The socket stays the same kernel object in both processes, so connections
+    already waiting in its accept queue are accepted here instead of reset.
+*/
+bool TcpServer::adoptListener(int fd) {
+    struct sockaddr_in bound;
+    socklen_t boundLen = sizeof(bound);
+    int listening = 0;
+    socklen_t optLen = sizeof(listening);
+    if (getsockname(fd, (struct sockaddr*)&bound, &boundLen) < 0 || bound.sin_family != AF_INET ||
+        ntohs(bound.sin_port) != port ||
+        getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &optLen) < 0 || !listening) {
+        LOG_WARN("Inherited descriptor ", fd, " is not listening on port ", port, ", ignoring it.");
+        return false;
     }
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0 || fcntl(fd, F_SETFD, FD_CLOEXEC) < 0) {
+        LOG_WARN("fcntl on inherited descriptor failed: ", strerror(errno));
+        return false;
+    }
+    server_fd = fd;
+    address = bound;
+    LOG_INFO("1- Inherited listening socket on port: ", port);
+    return true;
+}
 
-    // Send data to the client (returns number of bytes sent)
-    /*
-    ssize_t send(int sockfd, const void *buf, size_t len, int flags);
-        Parameter	    Description
-        client_fd	    The socket file descriptor for the connected client (from accept())
-        data.c_str()	Pointer to the data (as a C-style string) to send
-        data.size()	    Number of bytes to send
-        0	            Flags (0 = no special options)
-        ===============================================
-        🧠 What does send(...) return?
-            It returns the number of bytes successfully sent.
-            If it returns -1, an error occurred.
-    */
-    int sent = send(client_fd, data.c_str(), data.size(), 0);
-    return sent >= 0;  // Return true if data was sent successfully
+// Public method that runs the event loop
+/*
+    int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout);
+        Blocks until at least one watched descriptor is ready (timeout -1 = wait forever)
+        and fills "events" with up to maxevents ready descriptors.
+
+    Every ready descriptor is handled without blocking, so all clients are served
+    by this single thread in turn.
+
+    With io_uring, everything the last iteration queued (sends, re-armed
+    receives) is submitted in one io_uring_enter() right before waiting.
+
+    A client that keeps sending is read READ_TURN bytes at a time: the rest
+    waits in readAgain until the other ready descriptors had their turn, and
+    the next epoll_wait() only polls. One flooding client therefore delays
+    the others by one turn instead of starving them.
+*/
+void TcpServer::run() {
+    struct epoll_event events[MAX_EVENTS];
+    running = true;
+
+    while (running) {
+        if (ring.active()) submitRing();
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, readAgain.empty() ? -1 : 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("epoll_wait failed: ", strerror(errno));
+            break;
+        }
+        loopTimeMs = monotonicMs();
+
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            uint32_t flags = events[i].events;
+
+            if (fd == server_fd) {
+                acceptClients();
+                continue;
+            }
+
+            std::unordered_map<int, FdHandler>::iterator w = watchers.find(fd);
+            if (w != watchers.end()) {
+                FdHandler handler = w->second;  // copy: the handler may unwatch itself
+                handler(flags);
+                continue;
+            }
+
+            std::unordered_map<int, Connection>::iterator it = connections.find(fd);
+            if (it == connections.end()) continue;  // closed earlier in this batch
+
+            if (flags & EPOLLIN) {
+                handleReadable(it->second);
+                it = connections.find(fd);
+                if (it == connections.end()) continue;
+            }
+            if (flags & EPOLLOUT) {
+                if (!flushOutbox(it->second)) continue;
+                afterWrite(fd);
+            }
+            if (flags & (EPOLLERR | EPOLLHUP)) {
+                dropConnection(fd);
+            }
+        }
+        if (!readAgain.empty()) resumeReads();
+    }
 }
 
-// Public method to receive data from the connected client
-std::string TcpServer::receiveData() {
-    if (client_fd < 0) 
+// Private method giving the clients that used up their read turn the next one
+/*
+    Edge-triggered epoll does not report their unread data again, so they
+    are read here. A client may queue itself again for the next iteration.
+*/
+void TcpServer::resumeReads() {
+    std::vector<ConnectionId> due;
+    due.swap(readAgain);
+    for (size_t i = 0; i < due.size(); ++i) {
+        Connection* conn = findConnection(due[i]);
+        if (conn == NULL || !conn->readQueued) continue;
+        conn->readQueued = false;
+        if (!conn->readPaused) handleReadable(*conn);
+    }
+}
+
+// Public method to leave the event loop
+void TcpServer::stop() {
+    running = false;
+}
+
+// Private method run after some of a client's outbox was written
+void TcpServer::afterWrite(int fd) {
+    std::unordered_map<int, Connection>::iterator it = connections.find(fd);
+    if (it == connections.end()) return;
+
+    // A chunked reply waits for room in the outbox: let it continue
+    if (it->second.onDrained && it->second.outbox.size() <= outboxHighWater / 2) {
+        std::function<void()> drained;
+        drained.swap(it->second.onDrained);
+        drained();
+        it = connections.find(fd);
+        if (it == connections.end()) return;
+    }
+    Connection& conn = it->second;
+
+    // The client caught up: start reading from it again. Edge-triggered
+    // epoll will not repeat data that arrived meanwhile, so read now (a
+    // re-armed io_uring recv gets that data by itself, only the frames held
+    // in the inbox are due).
+    if (conn.readPaused && conn.outbox.size() <= outboxHighWater / 2) {
+        updateInterest(conn, conn.wantWrite, false);
+        if (ring.active()) {
+            // First the frames held while paused, then new data (a recv
+            // armed earlier could deliver a burst on top of them)
+            if (!dispatchFrames(conn)) return;
+            if (!conn.readPaused && !conn.recvArmed) armRecv(conn);
+        } else {
+            handleReadable(conn);
+        }
+    }
+}
+
+// Public method starting a graceful stop
+/*
+    Closing the listening socket first means this process takes no new
+    clients; with a listener handoff the next server process already holds
+    the same socket and accepts them. The drain check runs every
+    DRAIN_CHECK_MS from a timerfd until checkDrained() stops the loop.
+*/
+void TcpServer::drain(int timeoutMs) {
+    if (draining) return;
+    draining = true;
+    drainDeadlineMs = loopTimeMs + (timeoutMs > 0 ? timeoutMs : 0);
+
+    if (server_fd >= 0) {
+        // The armed accept holds the socket open until it is cancelled
+        if (acceptArmed) cancelRing(ringUserData(TAG_ACCEPT, 0));
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, server_fd, NULL);
+        close(server_fd);
+        server_fd = -1;
+    }
+
+    drain_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_interval.tv_nsec = DRAIN_CHECK_MS * 1000000L;
+    spec.it_value.tv_nsec = 1;  // first check right away
+    if (drain_fd < 0 || timerfd_settime(drain_fd, 0, &spec, NULL) < 0 ||
+        !watchFd(drain_fd, EPOLLIN, [this](uint32_t) { checkDrained(); })) {
+        LOG_WARN("Cannot wait for clients to drain, stopping now.");
+        stop();
+        return;
+    }
+    LOG_INFO("Draining ", connections.size(), " connections.");
+}
+
+// Private method stopping a draining loop once it has nothing left to do
+void TcpServer::checkDrained() {
+    uint64_t expirations;
+    ssize_t ignored = read(drain_fd, &expirations, sizeof(expirations));
+    (void)ignored;
+
+    bool flushed = true;
+    for (std::unordered_map<int, Connection>::iterator it = connections.begin(); it != connections.end(); ++it) {
+        if (it->second.outbox.size() > 0) flushed = false;
+    }
+    bool quiet = !onDrain || onDrain();
+    if (quiet && flushed) {
+        LOG_INFO("Drained, stopping event loop.");
+    } else if (loopTimeMs >= drainDeadlineMs) {
+        LOG_WARN("Drain timeout: stopping with ", quiet ? "unsent replies." : "commands still running.");
+    } else {
+        return;
+    }
+    unwatchFd(drain_fd);
+    stop();
+}
+
+void TcpServer::setMessageHandler(const MessageHandler& handler) {
+    onMessage = handler;
+}
+
+void TcpServer::setConnectHandler(const ConnectionHandler& handler) {
+    onConnect = handler;
+}
+
+void TcpServer::setDisconnectHandler(const ConnectionHandler& handler) {
+    onDisconnect = handler;
+}
+
+void TcpServer::setBatchEndHandler(const ConnectionHandler& handler) {
+    onBatchEnd = handler;
+}
+
+void TcpServer::setDrainHandler(const std::function<bool()>& handler) {
+    onDrain = handler;
+}
+
+// Public method to watch an additional descriptor from the event loop
+bool TcpServer::watchFd(int fd, uint32_t events, const FdHandler& handler) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        LOG_ERROR("epoll_ctl failed: ", strerror(errno));
+        return false;
+    }
+    watchers[fd] = handler;
+    return true;
+}
+
+void TcpServer::unwatchFd(int fd) {
+    if (watchers.erase(fd) > 0) epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+// Public method to run a task on the event loop thread (thread-safe)
+void TcpServer::post(std::function<void()> task) {
     {
-        std::cerr << "No client connected to server.\n";
-        return "No client connected to server\n"; // No client connected, return empty string
+        std::lock_guard<std::mutex> guard(postedLock);
+        posted.push_back(std::move(task));
     }
-    /*
-    Clears the buffer by filling it with 0s to remove any leftover data from previous operations.
-    This ensures we don't accidentally read old/stale data when we access buffer.
-    */
-    memset(buffer, 0, BUFFER_SIZE);  
-    /*
-        int bytesRead = read(client_fd, buffer, BUFFER_SIZE);
-            Reads data from the client socket (client_fd) into buffer, up to BUFFER_SIZE bytes.
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd, &one, sizeof(one));
+    (void)ignored;  // the counter can only fail to grow if it is already non-zero
+}
 
-            read() is a system call. It will block (wait) until the client sends some data or disconnects.
+// Private method that runs every task handed over by post()
+void TcpServer::runPosted() {
+    uint64_t count;
+    ssize_t ignored = read(wake_fd, &count, sizeof(count));
+    (void)ignored;
 
-            The return value bytesRead tells us how many bytes were actually received:
+    std::vector<std::function<void()> > tasks;
+    {
+        std::lock_guard<std::mutex> guard(postedLock);
+        tasks.swap(posted);
+    }
+    for (size_t i = 0; i < tasks.size(); ++i) tasks[i]();
+}
+
+bool TcpServer::setFraming(ConnectionId client, FrameParser::Mode mode) {
+    Connection* conn = findConnection(client);
+    if (conn == NULL) return false;
+    conn->parser.setMode(mode);
+    return true;
+}
 
-            If bytesRead > 0, some data was received.
+FrameParser::Mode TcpServer::framing(ConnectionId client) const {
+    const Connection* conn = findConnection(client);
+    return conn == NULL ? FrameParser::NEWLINE : conn->parser.mode();
+}
 
-            If bytesRead == 0, the client has closed the connection.
+// Private method that drains a readable client socket
+/*
+    ssize_t read(int fd, void *buf, size_t count);
+        If bytesRead > 0, some data was received.
 
-            If bytesRead < 0, an error occurred.
-    */
-    int bytesRead = read(client_fd, buffer, BUFFER_SIZE);
-    if (bytesRead <= 0) return "";  // If no data or error, return empty string
+        If bytesRead == 0, the client has closed the connection.
 
-    /*
-    std::string(buffer, bytesRead):
+        If bytesRead < 0 and errno is EAGAIN, everything available was read
+        (edge-triggered: we will be woken up again when new data arrives).
 
-        buffer : is a character array (i.e., a C-style string).
+    read() writes straight into the free space of the connection's ring buffer.
+    After every read all complete frames are handed to the message handler as
+    views into the ring; a partial frame simply waits for the next read.
+*/
+void TcpServer::handleReadable(Connection& conn) {
+    int fd = conn.fd;
+    if (conn.readQueued) return;  // already waiting for its next turn
 
-        bytesRead : is the number of characters in that buffer that were actually filled with valid data from the client (not the whole buffer, just the part that was read).
+    size_t turn = 0;
+    while (!conn.readPaused) {
+        if (turn >= READ_TURN) {
+            conn.readQueued = true;
+            readAgain.push_back(conn.id);
+            return;
+        }
+        char* span = NULL;
+        size_t room = conn.inbox.writableSpan(&span);
+        if (room == 0) {
+            LOG_WARN("Client frame exceeds receive buffer, closing.");
+            dropConnection(fd);
+            return;
+        }
 
-        So, this constructor creates a C++ std::string from the first bytesRead characters of the buffer.
+        uint64_t started = Metrics::now();
+        ssize_t bytesRead = read(fd, span, room);
+        Metrics::instance().recordStage(Metrics::STAGE_READ, Metrics::now() - started);
+        if (bytesRead > 0) {
+            turn += bytesRead;
+            Metrics::instance().add(Metrics::BYTES_READ, bytesRead);
+            if (conn.captureStream != 0) capture->received(conn.captureStream, span, bytesRead);
+            conn.inbox.commit(bytesRead);
+            conn.lastActiveMs = loopTimeMs;
+            if (!dispatchFrames(conn)) return;  // connection closed
+            continue;
+        }
+        if (bytesRead < 0 && errno == EINTR) continue;
+        if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
 
-        summary : convert from C-style string to C++ string.
-    */
+        // 0 = orderly shutdown by the peer, < 0 = socket error
+        dropConnection(fd);
+        return;
+    }
+}
+
+// Private method that hands every complete frame in the inbox to the message handler
+// Returns false if the connection was closed. With io_uring, frames stop at
+// a read pause and stay in the inbox until reading resumes.
+bool TcpServer::dispatchFrames(Connection& conn) {
+    int fd = conn.fd;
+    ConnectionId id = conn.id;
+    std::string_view frame;
+    FrameParser::Result result = FrameParser::NEED_MORE;
+
+    size_t delivered = 0;
+    size_t batchBytes = 0;
+
+    Metrics& metrics = Metrics::instance();
+
+    dispatchingFd = fd;
+    while (!conn.closing && !(ring.active() && conn.readPaused)) {
+        uint64_t started = Metrics::now();
+        result = conn.parser.next(conn.inbox, frame);
+        uint64_t parsed = Metrics::now();
+        metrics.recordStage(Metrics::STAGE_PARSE, parsed - started);
+        if (result != FrameParser::FRAME) break;
+
+        metrics.add(Metrics::FRAMES_RECEIVED);
+        if (onMessage) onMessage(id, frame);
+        metrics.recordStage(Metrics::STAGE_DISPATCH, Metrics::now() - parsed);
+        ++delivered;
+
+        // io_uring: frames held during a pause can be many reads' worth;
+        // end a batch every receive buffer's worth, as if read() returned
+        batchBytes += frame.size();
+        if (ring.active() && batchBytes >= URING_BUFFER_SIZE && !conn.closing) {
+            if (onBatchEnd) onBatchEnd(id);
+            delivered = batchBytes = 0;
+        }
+    }
+    // Every frame of this read was delivered: let the handler flush its batch
+    if (delivered > 0 && !conn.closing && onBatchEnd) onBatchEnd(id);
+    dispatchingFd = -1;
+
+    if (conn.closing) {
+        dropConnection(fd);
+        return false;
+    }
+    if (result == FrameParser::TOO_LARGE) {
+        LOG_WARN("Client frame too large, closing.");
+        dropConnection(fd);
+        return false;
+    }
+    return true;
+}
+
+// Private method that writes as much of the outbox as the socket accepts
+// Returns false if the connection had to be dropped.
+bool TcpServer::flushOutbox(Connection& conn) {
+    size_t before = conn.outbox.size();
+    uint64_t started = Metrics::now();
+    OutboundQueue::FlushResult result = conn.outbox.flush(conn.fd);
+    Metrics::instance().recordStage(Metrics::STAGE_SEND, Metrics::now() - started);
+    Metrics::instance().add(Metrics::BYTES_SENT, before - conn.outbox.size());
+    if (conn.outbox.size() != before) conn.lastActiveMs = loopTimeMs;
+
+    if (result == OutboundQueue::FAILED) {
+        dropConnection(conn.fd);
+        return false;
+    }
+    // WOULD_BLOCK: the socket buffer is full, wait for EPOLLOUT
+    updateInterest(conn, result == OutboundQueue::WOULD_BLOCK, conn.readPaused);
+    return true;
+}
+
+// Private method to update the epoll flags of one connection
+/*
+    With io_uring there is no interest to change: pausing cancels the
+    client's multishot recv; afterWrite() arms a new one on resume.
+*/
+void TcpServer::updateInterest(Connection& conn, bool wantWrite, bool readPaused) {
+    if (conn.wantWrite == wantWrite && conn.readPaused == readPaused) return;
+
+    if (ring.active()) {
+        if (readPaused && !conn.readPaused && conn.recvArmed) {
+            cancelRing(ringUserData(TAG_RECV, conn.id));
+            ring.submit();  // at once: until then the recv keeps filling the inbox
+        }
+        conn.wantWrite = wantWrite;
+        conn.readPaused = readPaused;
+        return;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLRDHUP | EPOLLET | (readPaused ? 0u : static_cast<uint32_t>(EPOLLIN)) |
+                (wantWrite ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    ev.data.fd = conn.fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn.fd, &ev) == 0) {
+        conn.wantWrite = wantWrite;
+        conn.readPaused = readPaused;
+    }
+}
+
+// Private method to close a client socket and forget its state
+void TcpServer::dropConnection(int fd) {
+    std::unordered_map<int, Connection>::iterator it = connections.find(fd);
+    if (it == connections.end()) return;
+
+    // A handler closed the connection whose frame it is processing:
+    // finish the dispatch first, dispatchFrames() closes it afterwards
+    if (fd == dispatchingFd) {
+        it->second.closing = true;
+        return;
+    }
+
+    ConnectionId id = it->second.id;
+    if (ring.active()) {
+        // Requests in the ring hold the socket open: shutdown() ends them
+        // and sends the FIN now. A send in flight keeps its chunks until its
+        // completion arrives.
+        shutdown(fd, SHUT_RDWR);
+        if (it->second.send && it->second.send->bytes > 0) {
+            retiredSends.emplace(ringUserData(TAG_SEND, id),
+                                 RetiredSend{std::move(it->second.outbox), std::move(it->second.send)});
+        }
+    } else {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    }
+    close(fd);
+    Metrics::instance().add(Metrics::CONNECTIONS_CLOSED);
+    if (it->second.captureStream != 0) capture->closed(it->second.captureStream);
+    connections.erase(it);
+
+    // An accept that stopped for lack of descriptors can go on now
+    if (ring.active() && !acceptArmed && server_fd >= 0 && !draining) armAccept();
+
+    LOG_INFO("Client disconnected.");
+    if (onDisconnect) onDisconnect(id);
+}
+
+TcpServer::Connection* TcpServer::findConnection(ConnectionId client) {
+    std::unordered_map<int, Connection>::iterator it = connections.find(static_cast<int>(client & 0xffffffffu));
+    if (it == connections.end() || it->second.id != client) return NULL;
+    return &it->second;
+}
+
+const TcpServer::Connection* TcpServer::findConnection(ConnectionId client) const {
+    std::unordered_map<int, Connection>::const_iterator it = connections.find(static_cast<int>(client & 0xffffffffu));
+    if (it == connections.end() || it->second.id != client) return NULL;
+    return &it->second;
+}
+
+// Public method to send data to a connected client
+/*
+    The data is copied into the connection's outbox (pooled chunks) and written
+    right away if the socket has room. Whatever the kernel does not accept stays
+    queued and is written when epoll reports EPOLLOUT, so a slow reader never
+    blocks the loop.
+
+    Backpressure: while more than outboxHighWater bytes are queued we stop
+    reading the client's commands, so a client that sends but does not read
+    cannot make us buffer replies without limit.
+*/
+bool TcpServer::sendData(ConnectionId client, std::string_view data) {
+    Connection* conn = findConnection(client);
+    if (conn == NULL) {
+        LOG_WARN("No such client connected to server.");
+        return false;
+    }
+
+    if (conn->outbox.size() + data.size() > outboxHighWater * 4) {
+        LOG_WARN("Client ", peerName(client), " is not reading its replies, closing.");
+        dropConnection(conn->fd);
+        return false;
+    }
 
-    return std::string(buffer, bytesRead);  // Return the received data as a string
+    conn->outbox.append(data);
+    if (ring.active()) {
+        queueSend(*conn);  // submitted with the other sends at the end of this iteration
+    } else if (!conn->wantWrite && !flushOutbox(*conn)) {
+        return false;  // otherwise EPOLLOUT will flush it
+    }
+
+    if (!conn->readPaused && conn->outbox.size() > outboxHighWater) {
+        updateInterest(*conn, conn->wantWrite, true);
+    }
+    return true;
+}
+
+void TcpServer::setIoBackend(IoBackend backend) {
+    useRing = backend == IO_URING;
+}
+
+void TcpServer::setOutboxLimit(size_t highWater) {
+    outboxHighWater = highWater;
+}
+
+// Public method to set the idle timeout
+/*
+    Turning it on schedules the connections that are already open; turning it
+    off just forgets every timer.
+*/
+void TcpServer::setIdleTimeout(int seconds) {
+    int64_t timeoutMs = seconds > 0 ? static_cast<int64_t>(seconds) * 1000 : 0;
+    if (timeoutMs == idleTimeoutMs) return;
+    idleTimeoutMs = timeoutMs;
+    idleTimers.clear();
+    for (std::unordered_map<int, Connection>::iterator it = connections.begin(); it != connections.end(); ++it) {
+        if (idleTimeoutMs > 0) idleTimers.schedule(it->second.id, it->second.lastActiveMs + idleTimeoutMs);
+    }
+    armIdleTimer();
+}
+
+void TcpServer::setNoDelay(bool enabled) {
+    noDelay = enabled;
+}
+
+void TcpServer::setKeepAlive(int idleSeconds) {
+    keepAliveSeconds = idleSeconds > 0 ? idleSeconds : 0;
+}
+
+void TcpServer::setCapture(TrafficCapture* recorder) {
+    capture = recorder;
+}
+
+// Private method applying the socket options to an accepted client
+/*
+    TCP_NODELAY turns off Nagle's algorithm: a reply is sent at once even if an
+    earlier one was not acknowledged yet. Replies are written in one piece per
+    batch, so this costs no extra packets.
+
+    SO_KEEPALIVE with TCP_KEEPIDLE / TCP_KEEPINTVL / TCP_KEEPCNT: after
+    keepAliveSeconds of silence the kernel sends probes; a peer that answers
+    none of the KEEPALIVE_PROBES is reported as an error and the connection is
+    dropped like any other failed socket.
+*/
+void TcpServer::configureSocket(int fd) {
+    int on = 1;
+    if (noDelay && setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)) < 0) {
+        LOG_WARN("TCP_NODELAY failed: ", strerror(errno));
+    }
+    if (keepAliveSeconds > 0) {
+        int idle = keepAliveSeconds;
+        int interval = keepAliveSeconds / KEEPALIVE_PROBES > 0 ? keepAliveSeconds / KEEPALIVE_PROBES : 1;
+        int probes = KEEPALIVE_PROBES;
+        if (setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on)) < 0 ||
+            setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle)) < 0 ||
+            setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval)) < 0 ||
+            setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof(probes)) < 0) {
+            LOG_WARN("TCP keepalive setup failed: ", strerror(errno));
+        }
+    }
+}
+
+// Private method starting / stopping the once-a-second idle check
+void TcpServer::armIdleTimer() {
+    if (idle_fd < 0) return;
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (idleTimeoutMs > 0) {
+        spec.it_interval.tv_sec = IDLE_TICK_MS / 1000;
+        spec.it_interval.tv_nsec = static_cast<long>(IDLE_TICK_MS % 1000) * 1000000L;
+        spec.it_value = spec.it_interval;
+    }
+    if (timerfd_settime(idle_fd, 0, &spec, NULL) < 0) LOG_WARN("timerfd_settime failed: ", strerror(errno));
+}
+
+// Private method closing the clients whose idle timer came due
+/*
+    The wheel holds one timer per connection, set when it was accepted or last
+    checked; reads and writes only update lastActiveMs. A due timer of a client
+    that was active since is simply scheduled again from its last activity,
+    and a closed client's timer finds no connection and is dropped.
+*/
+void TcpServer::closeIdleClients() {
+    uint64_t expirations;
+    ssize_t ignored = read(idle_fd, &expirations, sizeof(expirations));
+    (void)ignored;
+    if (idleTimeoutMs <= 0) return;
+
+    std::vector<uint64_t> due;
+    idleTimers.advance(loopTimeMs, due);
+    for (size_t i = 0; i < due.size(); ++i) {
+        Connection* conn = findConnection(due[i]);
+        if (conn == NULL) continue;
+        if (loopTimeMs - conn->lastActiveMs < idleTimeoutMs) {
+            idleTimers.schedule(conn->id, conn->lastActiveMs + idleTimeoutMs);
+            continue;
+        }
+        LOG_INFO("Client ", peerName(conn->id), " idle for ", idleTimeoutMs / 1000, " s, closing.");
+        Metrics::instance().add(Metrics::CONNECTIONS_IDLE_CLOSED);
+        dropConnection(conn->fd);
+    }
+}
+
+bool TcpServer::notifyWhenDrained(ConnectionId client, std::function<void()> callback) {
+    Connection* conn = findConnection(client);
+    if (conn == NULL) return false;
+    if (conn->outbox.size() <= outboxHighWater / 2) {
+        post(std::move(callback));  // already drained: run on the next loop iteration
+    } else {
+        conn->onDrained = std::move(callback);
+    }
+    return true;
+}
+
+size_t TcpServer::pendingBytes(ConnectionId client) const {
+    const Connection* conn = findConnection(client);
+    return conn == NULL ? 0 : conn->outbox.size();
+}
+
+// Public method reading the client's kernel send queue
+/*
+    int ioctl(int fd, SIOCOUTQ, int* value);
+        For a TCP socket, the number of bytes in the send queue that the peer
+        has not acknowledged yet (sent or not).
+*/
+size_t TcpServer::unackedBytes(ConnectionId client) const {
+    const Connection* conn = findConnection(client);
+    int queued = 0;
+    if (conn == NULL || ioctl(conn->fd, SIOCOUTQ, &queued) < 0 || queued < 0) return 0;
+    return static_cast<size_t>(queued);
+}
+
+// Public method to close one client connection
+void TcpServer::closeConnection(ConnectionId client) {
+    Connection* conn = findConnection(client);
+    if (conn != NULL) dropConnection(conn->fd);
+}
+
+bool TcpServer::isConnected(ConnectionId client) const {
+    return findConnection(client) != NULL;
+}
+
+size_t TcpServer::connectionCount() const {
+    return connections.size();
+}
+
+bool TcpServer::isLoopback(ConnectionId client) const {
+    const Connection* conn = findConnection(client);
+    return conn != NULL && (ntohl(conn->peer.sin_addr.s_addr) >> 24) == 127;
+}
+
+std::string TcpServer::peerName(ConnectionId client) const {
+    const Connection* conn = findConnection(client);
+    if (conn == NULL) return "";
+    char ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &conn->peer.sin_addr, ip, sizeof(ip));
+    return std::string(ip) + ":" + std::to_string(ntohs(conn->peer.sin_port));
+}
+
+// Private method creating the io_uring and its receive buffers
+bool TcpServer::setupRing() {
+    if (!ring.init(URING_ENTRIES) || !ring.setupBuffers(URING_BUFFER_GROUP, URING_BUFFERS, URING_BUFFER_SIZE)) {
+        return false;
+    }
+    return watchFd(ring.fd(), EPOLLIN, [this](uint32_t) { reapRing(); });
+}
+
+// Private method arming the multishot accept on the listening socket
+/*
+    IORING_OP_ACCEPT with IORING_ACCEPT_MULTISHOT stays armed and posts one
+    completion per accepted client (res = the new socket). The new sockets
+    are blocking: the ring waits for them, nothing reads or writes them
+    directly.
+*/
+void TcpServer::armAccept() {
+    struct io_uring_sqe* sqe = ring.nextSqe();
+    if (sqe == NULL) {
+        LOG_ERROR("io_uring queue full, not accepting clients.");
+        return;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = server_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = ringUserData(TAG_ACCEPT, 0);
+    acceptArmed = true;
+}
+
+// Private method arming a client's multishot recv
+/*
+    IORING_OP_RECV with IORING_RECV_MULTISHOT and IOSQE_BUFFER_SELECT posts a
+    completion each time data arrives, in a buffer the kernel took from the
+    provided buffer ring. It ends (no IORING_CQE_F_MORE) on EOF, on error,
+    when cancelled, or when the buffers ran out (ENOBUFS).
+*/
+void TcpServer::armRecv(Connection& conn) {
+    struct io_uring_sqe* sqe = ring.nextSqe();
+    if (sqe == NULL) {
+        LOG_ERROR("io_uring queue full, closing client.");
+        dropConnection(conn.fd);
+        return;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = ringUserData(TAG_RECV, conn.id);
+    conn.recvArmed = true;
+}
+
+// Private method cancelling the ring request with this user_data
+void TcpServer::cancelRing(uint64_t userData) {
+    struct io_uring_sqe* sqe = ring.nextSqe();
+    if (sqe == NULL) return;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = userData;
+    sqe->user_data = ringUserData(TAG_NONE, 0);
+}
+
+// Private method remembering that a client has bytes to send this iteration
+void TcpServer::queueSend(Connection& conn) {
+    if (conn.sendQueued || (conn.send && conn.send->bytes > 0) || conn.outbox.empty()) return;
+    conn.sendQueued = true;
+    sendQueue.push_back(conn.id);
+}
+
+// Private method submitting the sends of this iteration
+/*
+    One IORING_OP_SENDMSG per client over its outbox chunks (like
+    OutboundQueue::flush(), MSG_NOSIGNAL included), at most one in flight
+    per client so the bytes stay in order. All of them, and whatever else
+    was queued (re-armed receives, cancels), go to the kernel with a single
+    io_uring_enter().
+*/
+void TcpServer::submitRing() {
+    for (size_t i = 0; i < sendQueue.size(); ++i) {
+        Connection* conn = findConnection(sendQueue[i]);
+        if (conn == NULL) continue;
+        conn->sendQueued = false;
+        if ((conn->send && conn->send->bytes > 0) || conn->outbox.empty()) continue;
+
+        struct io_uring_sqe* sqe = ring.nextSqe();
+        if (sqe == NULL) {
+            LOG_ERROR("io_uring queue full, closing client.");
+            dropConnection(conn->fd);
+            continue;
+        }
+        if (!conn->send) conn->send.reset(new UringSend);
+        UringSend& send = *conn->send;
+        memset(&send.msg, 0, sizeof(send.msg));
+        send.msg.msg_iov = send.iov;
+        send.msg.msg_iovlen = conn->outbox.gather(send.iov, OutboundQueue::MAX_IOV);
+        send.bytes = 0;
+        for (size_t k = 0; k < send.msg.msg_iovlen; ++k) send.bytes += send.iov[k].iov_len;
+
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = conn->fd;
+        sqe->addr = reinterpret_cast<uint64_t>(&send.msg);
+        sqe->len = 1;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = ringUserData(TAG_SEND, conn->id);
+    }
+    sendQueue.clear();
+    ring.submit();
+}
+
+// Private method handling every completion the ring has (its fd polled readable)
+void TcpServer::reapRing() {
+    ring.reap([this](const struct io_uring_cqe& cqe) {
+        switch (cqe.user_data & 3) {
+        case TAG_ACCEPT: onAccepted(cqe); break;
+        case TAG_RECV: onReceived(cqe); break;
+        case TAG_SEND: onSent(cqe); break;
+        default: break;  // cancel results
+        }
+    });
+}
+
+// Private method finding the connection a completion belongs to (NULL if it closed since)
+TcpServer::Connection* TcpServer::ringConnection(uint64_t userData) {
+    std::unordered_map<int, Connection>::iterator it = connections.find(static_cast<int>((userData >> 2) & 0xffffffffu));
+    if (it == connections.end() || ringUserData(TAG_NONE, it->second.id) != (userData & ~static_cast<uint64_t>(3))) {
+        return NULL;
+    }
+    return &it->second;
+}
+
+// Private method handling an accept completion
+/*
+    Multishot accept gives no peer address, so getpeername() asks for it.
+    When the process is out of descriptors the accept ends; dropConnection()
+    arms it again once a client closed.
+*/
+void TcpServer::onAccepted(const struct io_uring_cqe& cqe) {
+    if (!(cqe.flags & IORING_CQE_F_MORE)) acceptArmed = false;
+
+    bool retry = true;
+    if (cqe.res >= 0) {
+        struct sockaddr_in peer;
+        socklen_t peerLen = sizeof(peer);
+        memset(&peer, 0, sizeof(peer));
+        getpeername(cqe.res, (struct sockaddr*)&peer, &peerLen);
+        addConnection(cqe.res, peer, Metrics::now());
+    } else if (cqe.res != -ECANCELED) {
+        LOG_ERROR("Accept failed: ", strerror(-cqe.res));
+        retry = cqe.res != -EMFILE && cqe.res != -ENFILE && cqe.res != -ENOBUFS && cqe.res != -ENOMEM;
+    }
+    if (retry && !acceptArmed && server_fd >= 0 && !draining) armAccept();
+}
+
+// Private method handling a recv completion
+/*
+    The data is copied from the provided buffer into the connection's inbox
+    and the buffer goes straight back to the kernel, so a few hundred
+    buffers serve any number of clients. Then the frames are dispatched as
+    after a read().
+
+    A paused client's recv keeps delivering until its cancel is processed;
+    those bytes wait in the inbox (up to INBOX_MAX) like unread bytes wait
+    in the socket with epoll.
+*/
+void TcpServer::onReceived(const struct io_uring_cqe& cqe) {
+    bool hasBuffer = (cqe.flags & IORING_CQE_F_BUFFER) != 0;
+    uint16_t bufferId = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    Connection* conn = ringConnection(cqe.user_data);
+    if (conn == NULL) {
+        if (hasBuffer) ring.recycleBuffer(bufferId);
+        return;
+    }
+    int fd = conn->fd;
+    if (!(cqe.flags & IORING_CQE_F_MORE)) conn->recvArmed = false;
+
+    if (cqe.res > 0 && hasBuffer) {
+        const char* src = ring.buffer(bufferId);
+        if (conn->captureStream != 0) capture->received(conn->captureStream, src, cqe.res);
+        size_t left = static_cast<size_t>(cqe.res);
+        while (left > 0) {
+            char* span = NULL;
+            size_t room = conn->inbox.writableSpan(&span);
+            if (room == 0) break;
+            size_t n = std::min(left, room);
+            memcpy(span, src, n);
+            conn->inbox.commit(n);
+            src += n;
+            left -= n;
+        }
+        ring.recycleBuffer(bufferId);
+        if (left > 0) {
+            LOG_WARN("Client frame exceeds receive buffer, closing.");
+            dropConnection(fd);
+            return;
+        }
+        Metrics::instance().add(Metrics::BYTES_READ, cqe.res);
+        conn->lastActiveMs = loopTimeMs;
+        if (!dispatchFrames(*conn)) return;  // connection closed (paused: the frames wait)
+    } else if (hasBuffer) {
+        ring.recycleBuffer(bufferId);
+    }
+
+    // 0 = orderly shutdown by the peer, < 0 = socket error; ENOBUFS (no
+    // buffer was free) and ECANCELED (paused) just end this recv
+    if (cqe.res == 0 || (cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED)) {
+        dropConnection(fd);
+        return;
+    }
+    if (!conn->recvArmed && !conn->readPaused) armRecv(*conn);
+}
+
+// Private method handling a send completion
+/*
+    res is the number of bytes the socket took; a short send leaves the rest
+    queued and the next iteration sends it, together with anything appended
+    meanwhile.
+*/
+void TcpServer::onSent(const struct io_uring_cqe& cqe) {
+    Connection* conn = ringConnection(cqe.user_data);
+    if (conn == NULL || !conn->send || conn->send->bytes == 0) {
+        retiredSends.erase(cqe.user_data);  // the client closed meanwhile
+        return;
+    }
+    int fd = conn->fd;
+    conn->send->bytes = 0;
+
+    if (cqe.res < 0) {
+        if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+            queueSend(*conn);
+            return;
+        }
+        dropConnection(fd);
+        return;
+    }
+    if (cqe.res > 0) {
+        conn->outbox.consume(static_cast<size_t>(cqe.res));
+        conn->lastActiveMs = loopTimeMs;
+        Metrics::instance().add(Metrics::BYTES_SENT, cqe.res);
+    }
+    queueSend(*conn);
+    afterWrite(fd);
 }
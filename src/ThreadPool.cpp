@@ -0,0 +1,98 @@
+#include "../header/ThreadPool.hpp"
+
+ThreadPool::ThreadPool(size_t threads, size_t maxQueued)
+    : maxQueued(maxQueued), nextQueue(0), queued(0), stopping(false) {
+    if (threads == 0) threads = 1;
+    for (size_t i = 0; i < threads; ++i) queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    for (size_t i = 0; i < threads; ++i) workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+}
+
+// Public method stopping the pool before its users go away
+/*
+    Queued jobs still point at the dispatchers and the streamer, which main()
+    destroys before the pool: they are dropped, not run. Jobs already running
+    finish before the workers are joined.
+*/
+void ThreadPool::shutdown() {
+    for (size_t i = 0; i < queues.size(); ++i) {
+        std::lock_guard<std::mutex> guard(queues[i]->lock);
+        queued.fetch_sub(queues[i]->jobs.size(), std::memory_order_relaxed);
+        queues[i]->jobs.clear();
+    }
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+    workers.clear();
+}
+
+// Public method queuing a job
+/*
+    The slot is reserved before the job is pushed, so a worker that pops the
+    job at once never takes "queued" below zero, and several reactor threads
+    submitting together cannot overshoot maxQueued. A worker that sees the
+    reservation before the push finds nothing and looks again.
+*/
+bool ThreadPool::submit(Job job) {
+    size_t count = queued.load(std::memory_order_relaxed);
+    do {
+        if (count >= maxQueued) return false;
+    } while (!queued.compare_exchange_weak(count, count + 1, std::memory_order_relaxed));
+
+    WorkQueue& q = *queues[nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size()];
+    {
+        std::lock_guard<std::mutex> guard(q.lock);
+        q.jobs.push_back(std::move(job));
+    }
+    {
+        // Taken once so a worker that checked "queued" before the reservation
+        // is already waiting and gets the notification
+        std::lock_guard<std::mutex> guard(sleepLock);
+    }
+    wakeup.notify_one();
+    return true;
+}
+
+// Private method: own deque first (front), then steal from the others (back)
+bool ThreadPool::take(size_t index, Job& job) {
+    for (size_t n = 0; n < queues.size(); ++n) {
+        WorkQueue& q = *queues[(index + n) % queues.size()];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.jobs.empty()) continue;
+        if (n == 0) {
+            job = std::move(q.jobs.front());
+            q.jobs.pop_front();
+        } else {
+            job = std::move(q.jobs.back());
+            q.jobs.pop_back();
+        }
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    while (true) {
+        Job job;
+        if (take(index, job)) {
+            job();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(sleepLock);
+        wakeup.wait(guard, [this] { return stopping || queued.load(std::memory_order_relaxed) > 0; });
+        if (stopping && queued.load(std::memory_order_relaxed) == 0) return;
+    }
+}
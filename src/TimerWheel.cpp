@@ -0,0 +1,53 @@
+#include "../header/TimerWheel.hpp"
+
+TimerWheel::TimerWheel(size_t slots, int64_t tickMs)
+    : slots(slots == 0 ? 1 : slots), tick(tickMs <= 0 ? 1 : tickMs), currentTick(-1), count(0) {}
+
+// Public method to add a timer
+/*
+    A deadline in a tick the wheel already processed goes into the next slot
+    to be processed, so it fires on the next advance() instead of a full turn
+    later.
+*/
+void TimerWheel::schedule(uint64_t key, int64_t deadlineMs) {
+    int64_t due = (deadlineMs + tick - 1) / tick;   // first tick at or after the deadline
+    if (due <= currentTick) due = currentTick + 1;
+    Entry entry = { key, deadlineMs };
+    slots[static_cast<size_t>(due) % slots.size()].push_back(entry);
+    ++count;
+}
+
+// Public method to expire every timer due up to "nowMs"
+/*
+    Visits each slot between the last processed tick and now once (at most one
+    turn: after a long pause every slot is visited). Entries whose deadline is
+    a later turn stay where they are.
+*/
+void TimerWheel::advance(int64_t nowMs, std::vector<uint64_t>& due) {
+    int64_t now = nowMs / tick;
+    if (currentTick < 0) currentTick = now - 1;
+    if (now <= currentTick) return;
+
+    int64_t first = currentTick + 1;
+    if (now - first >= static_cast<int64_t>(slots.size())) first = now - static_cast<int64_t>(slots.size()) + 1;
+
+    for (int64_t t = first; t <= now; ++t) {
+        std::vector<Entry>& slot = slots[static_cast<size_t>(t) % slots.size()];
+        size_t kept = 0;
+        for (size_t i = 0; i < slot.size(); ++i) {
+            if (slot[i].deadlineMs <= nowMs) {
+                due.push_back(slot[i].key);
+                --count;
+            } else {
+                slot[kept++] = slot[i];
+            }
+        }
+        slot.resize(kept);
+    }
+    currentTick = now;
+}
+
+void TimerWheel::clear() {
+    for (size_t i = 0; i < slots.size(); ++i) slots[i].clear();
+    count = 0;
+}
@@ -0,0 +1,44 @@
+#include "../header/TokenBucket.hpp"
+
+TokenBucket::TokenBucket() : tokens(0), updated(0) {}
+
+void TokenBucket::setLimit(const RateLimit& newLimit) {
+    if (newLimit == limit && updated != 0) return;
+    limit = newLimit;
+    tokens = limit.count;
+    updated = 0;
+}
+
+// Public method taking one token
+/*
+    Tokens are refilled lazily from the time since the last call, so an idle
+    bucket costs nothing. Fractions are kept: 10/min gives one token every
+    6 seconds, not ten at the top of each minute.
+*/
+bool TokenBucket::take(uint64_t nowNs, uint64_t& waitNs) {
+    waitNs = 0;
+    if (limit.count <= 0) return true;
+
+    double perNs = static_cast<double>(limit.count) / (limit.seconds * 1e9);
+    if (updated != 0 && nowNs > updated) {
+        tokens += (nowNs - updated) * perNs;
+        if (tokens > limit.count) tokens = limit.count;
+    }
+    if (updated == 0 || nowNs > updated) updated = nowNs;
+
+    if (tokens >= 1) {
+        tokens -= 1;
+        return true;
+    }
+    waitNs = static_cast<uint64_t>((1 - tokens) / perNs);
+    return false;
+}
+
+std::string TokenBucket::describe(const RateLimit& limit) {
+    if (limit.count <= 0) return "unlimited";
+    std::string text = std::to_string(limit.count) + "/";
+    if (limit.seconds == 3600) return text + "h";
+    if (limit.seconds == 60) return text + "min";
+    if (limit.seconds == 1) return text + "s";
+    return text + std::to_string(limit.seconds) + "s";
+}
@@ -0,0 +1,151 @@
+#include "../header/TrafficCapture.hpp"
+#include "../header/BinaryProtocol.hpp"
+#include "../header/Logger.hpp"
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+const char TrafficCapture::MAGIC[8] = { 'P', 'C', 'C', 'A', 'P', '0', '1', '\n' };
+
+// Helper returning monotonic microseconds
+static uint64_t nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+TrafficCapture::TrafficCapture()
+    : fd(-1), written(0), limit(0), nextStream(1), lastUs(0), full(false) {}
+
+TrafficCapture::~TrafficCapture() {
+    flush();
+    if (fd >= 0) close(fd);
+}
+
+bool TrafficCapture::open(const std::string& path, uint64_t limitBytes, std::string& error) {
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    limit = limitBytes;
+    lastUs = nowUs();
+    buffer.reserve(BLOCK + 1024);
+    buffer.assign(MAGIC, sizeof(MAGIC));
+    return true;
+}
+
+uint64_t TrafficCapture::opened() {
+    std::lock_guard<std::mutex> guard(lock);
+    uint64_t stream = nextStream++;
+    append(RECORD_OPEN, stream);
+    return stream;
+}
+
+void TrafficCapture::received(uint64_t stream, const char* data, size_t size) {
+    std::lock_guard<std::mutex> guard(lock);
+    append(RECORD_DATA, stream);
+    if (fd < 0 || full) return;
+    BinaryProtocol::putVarint(buffer, size);
+    buffer.append(data, size);
+    if (buffer.size() >= BLOCK) writeBuffer();
+}
+
+void TrafficCapture::closed(uint64_t stream) {
+    std::lock_guard<std::mutex> guard(lock);
+    append(RECORD_CLOSE, stream);
+}
+
+void TrafficCapture::flush() {
+    std::lock_guard<std::mutex> guard(lock);
+    writeBuffer();
+}
+
+// Private method starting a record (lock held)
+/*
+    Once the limit is reached nothing more is recorded: the file ends with
+    complete records, and replay treats streams left open as closed.
+*/
+void TrafficCapture::append(RecordType type, uint64_t stream) {
+    if (fd < 0 || full) return;
+    if (limit > 0 && written + buffer.size() >= limit) {
+        full = true;
+        LOG_WARN("Capture file reached ", limit, " bytes, recording stopped.");
+        return;
+    }
+    uint64_t now = nowUs();
+    if (now < lastUs) now = lastUs;
+    buffer += static_cast<char>(type);
+    BinaryProtocol::putVarint(buffer, now - lastUs);
+    BinaryProtocol::putVarint(buffer, stream);
+    lastUs = now;
+}
+
+// Private method writing the buffered records (lock held)
+void TrafficCapture::writeBuffer() {
+    if (fd < 0 || buffer.empty()) return;
+    size_t done = 0;
+    while (done < buffer.size()) {
+        ssize_t n = write(fd, buffer.data() + done, buffer.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            LOG_WARN("Writing the capture file failed: ", strerror(errno), ", recording stopped.");
+            full = true;
+            break;
+        }
+        done += n;
+    }
+    written += done;
+    buffer.clear();
+}
+
+bool TrafficCapture::load(const std::string& path, std::string& contents, std::vector<Record>& records,
+                          std::string& error) {
+    records.clear();
+    contents.clear();
+    int in = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    char block[BLOCK];
+    ssize_t n;
+    while ((n = read(in, block, sizeof(block))) > 0) contents.append(block, n);
+    close(in);
+    if (n < 0) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    if (contents.size() < sizeof(MAGIC) || memcmp(contents.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        error = path + ": not a capture file";
+        return false;
+    }
+
+    std::string_view rest(contents);
+    rest.remove_prefix(sizeof(MAGIC));
+    uint64_t timeUs = 0;
+    while (!rest.empty()) {
+        Record record;
+        unsigned char type = static_cast<unsigned char>(rest[0]);
+        rest.remove_prefix(1);
+        uint64_t delta = 0, length = 0;
+        bool ok = type <= RECORD_CLOSE && BinaryProtocol::getVarint(rest, delta) &&
+                  BinaryProtocol::getVarint(rest, record.stream);
+        if (ok && type == RECORD_DATA) ok = BinaryProtocol::getVarint(rest, length) && length <= rest.size();
+        if (!ok) {
+            error = path + ": damaged record " + std::to_string(records.size() + 1);
+            return false;
+        }
+        timeUs += delta;
+        record.type = static_cast<RecordType>(type);
+        record.timeUs = timeUs;
+        if (type == RECORD_DATA) {
+            record.data = rest.substr(0, length);
+            rest.remove_prefix(length);
+        }
+        records.push_back(record);
+    }
+    return true;
+}
@@ -0,0 +1,103 @@
+#include "../header/VolumeBackend.hpp"
+#include "../header/Logger.hpp"
+#include <vector>
+#include <mutex>
+
+// Volume change sent by one media key press
+static const int XDOTOOL_STEP = 5;
+
+// Helper that limits a percentage to 0..100
+static int clampPercent(int percent) {
+    return percent < 0 ? 0 : (percent > 100 ? 100 : percent);
+}
+
+// Keeps the volume in memory only
+class MockVolumeBackend : public VolumeBackend {
+public:
+    MockVolumeBackend() : level(50), isMuted(false) {}
+
+    const char* name() const { return "mock"; }
+    bool adjust(int percent) { level = clampPercent(level + percent); return true; }
+    bool set(int percent) { level = clampPercent(percent); return true; }
+    int get() { return level; }
+    bool setMuted(bool muted) { isMuted = muted; return true; }
+    int muted() { return isMuted ? 1 : 0; }
+
+private:
+    int level;
+    bool isMuted;
+};
+
+// Presses XF86AudioRaiseVolume / XF86AudioLowerVolume through xdotool.
+// The keys are relative and do not report the level, so set / get / mute
+// state are not supported.
+class XdotoolVolumeBackend : public VolumeBackend {
+public:
+    XdotoolVolumeBackend(ProcessLauncher& launcher) : launcher(launcher) {}
+
+    const char* name() const { return "xdotool"; }
+
+    bool adjust(int percent) {
+        int steps = (percent < 0 ? -percent : percent) / XDOTOOL_STEP;
+        if (steps == 0) return true;
+        return launcher.launch("volume", std::vector<std::string>{"xdotool", "key", "--repeat", std::to_string(steps),
+                               percent > 0 ? "XF86AudioRaiseVolume" : "XF86AudioLowerVolume"}) > 0;
+    }
+
+    bool set(int) { return false; }
+    int get() { return -1; }
+    bool setMuted(bool) { return false; }
+    int muted() { return -1; }
+
+private:
+    ProcessLauncher& launcher;
+};
+
+// Serialises every call to a stateful backend (mixer handle, in-memory level).
+// adjust() is a read-modify-write, so it must hold the lock across both steps.
+class LockedVolumeBackend : public VolumeBackend {
+public:
+    LockedVolumeBackend(std::unique_ptr<VolumeBackend> inner) : inner(std::move(inner)) {}
+
+    const char* name() const { return inner->name(); }
+    bool adjust(int percent) { std::lock_guard<std::mutex> guard(lock); return inner->adjust(percent); }
+    bool set(int percent) { std::lock_guard<std::mutex> guard(lock); return inner->set(percent); }
+    int get() { std::lock_guard<std::mutex> guard(lock); return inner->get(); }
+    bool setMuted(bool muted) { std::lock_guard<std::mutex> guard(lock); return inner->setMuted(muted); }
+    int muted() { std::lock_guard<std::mutex> guard(lock); return inner->muted(); }
+
+private:
+    std::unique_ptr<VolumeBackend> inner;
+    std::mutex lock;
+};
+
+// Helper wrapping a backend in LockedVolumeBackend (NULL stays NULL)
+static std::unique_ptr<VolumeBackend> locked(std::unique_ptr<VolumeBackend> backend) {
+    if (!backend) return backend;
+    return std::unique_ptr<VolumeBackend>(new LockedVolumeBackend(std::move(backend)));
+}
+
+// The xdotool backend keeps no state of its own (the launcher is thread-safe),
+// so it is the only one returned without a lock.
+std::unique_ptr<VolumeBackend> createVolumeBackend(const std::string& kind, ProcessLauncher& launcher) {
+    if (kind == "mock") return locked(std::unique_ptr<VolumeBackend>(new MockVolumeBackend()));
+    if (kind == "xdotool") return std::unique_ptr<VolumeBackend>(new XdotoolVolumeBackend(launcher));
+
+#ifdef HAVE_ALSA
+    if (kind == "alsa" || kind.empty()) {
+        std::unique_ptr<VolumeBackend> alsa = createAlsaVolumeBackend();
+        if (alsa || kind == "alsa") return locked(std::move(alsa));
+        LOG_WARN("ALSA mixer unavailable, falling back to xdotool.");
+    }
+#else
+    if (kind == "alsa") {
+        LOG_WARN("Built without ALSA support.");
+        return std::unique_ptr<VolumeBackend>();
+    }
+#endif
+
+    if (kind.empty()) return std::unique_ptr<VolumeBackend>(new XdotoolVolumeBackend(launcher));
+
+    LOG_WARN("Unknown volume backend: ", kind);
+    return std::unique_ptr<VolumeBackend>();
+}
@@ -0,0 +1,93 @@
+#include "../header/FrameSource.hpp"
+#include "../header/Logger.hpp"
+#include <mutex>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+// Captures the root window of the default X display.
+/*
+    The display connection is opened once and kept, so a capture is one
+    XGetImage round trip to the X server instead of a gnome-screenshot process
+    writing a PNG file we would then have to read back.
+
+    Xlib connections are not thread-safe: captures are serialised with a mutex
+    (the screenshot service single-flights them anyway).
+*/
+class X11FrameSource : public FrameSource {
+public:
+    X11FrameSource() : display(NULL) {}
+
+    ~X11FrameSource() {
+        if (display != NULL) XCloseDisplay(display);
+    }
+
+    bool open() {
+        display = XOpenDisplay(NULL);  // $DISPLAY
+        if (display == NULL) return false;
+        LOG_INFO("Screenshots from X display ", DisplayString(display), ".");
+        return true;
+    }
+
+    const char* name() const { return "x11"; }
+
+    bool capture(Frame& frame) {
+        std::lock_guard<std::mutex> guard(lock);
+        Window root = DefaultRootWindow(display);
+        XWindowAttributes attributes;
+        if (!XGetWindowAttributes(display, root, &attributes)) return false;
+
+        XImage* image = XGetImage(display, root, 0, 0, attributes.width, attributes.height, AllPlanes, ZPixmap);
+        if (image == NULL) {
+            LOG_WARN("XGetImage failed.");
+            return false;
+        }
+
+        frame.width = image->width;
+        frame.height = image->height;
+        frame.rgb.resize(static_cast<size_t>(frame.width) * frame.height * 3);
+        uint8_t* out = frame.rgb.data();
+
+        if (image->bits_per_pixel == 32 && image->red_mask == 0xFF0000 && image->blue_mask == 0xFF) {
+            // Common 24/32-bit TrueColor layout: copy the bytes directly
+            for (int y = 0; y < image->height; ++y) {
+                const uint8_t* row = reinterpret_cast<const uint8_t*>(image->data) + y * image->bytes_per_line;
+                for (int x = 0; x < image->width; ++x) {
+                    *out++ = row[x * 4 + 2];
+                    *out++ = row[x * 4 + 1];
+                    *out++ = row[x * 4];
+                }
+            }
+        } else {
+            // Any other visual: slow but correct
+            for (int y = 0; y < image->height; ++y) {
+                for (int x = 0; x < image->width; ++x) {
+                    unsigned long pixel = XGetPixel(image, x, y);
+                    *out++ = scale(pixel, image->red_mask);
+                    *out++ = scale(pixel, image->green_mask);
+                    *out++ = scale(pixel, image->blue_mask);
+                }
+            }
+        }
+        XDestroyImage(image);
+        return true;
+    }
+
+private:
+    Display* display;
+    std::mutex lock;
+
+    // Extracts one channel given its mask and scales it to 0..255
+    static uint8_t scale(unsigned long pixel, unsigned long mask) {
+        if (mask == 0) return 0;
+        int shift = 0;
+        while (((mask >> shift) & 1) == 0) ++shift;
+        unsigned long max = mask >> shift;
+        return static_cast<uint8_t>(((pixel & mask) >> shift) * 255 / max);
+    }
+};
+
+std::unique_ptr<FrameSource> createX11FrameSource() {
+    std::unique_ptr<X11FrameSource> source(new X11FrameSource());
+    if (!source->open()) return std::unique_ptr<FrameSource>();
+    return std::unique_ptr<FrameSource>(source.release());
+}
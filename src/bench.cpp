@@ -0,0 +1,392 @@
+// tcp_bench: load generator for tcp_server.
+//
+// Opens N connections, sends a weighted mix of commands and measures the time
+// until each command is acknowledged ("Command received." or "Busy: ...").
+//
+//   closed loop (default): every connection keeps --pipeline commands in flight
+//                          and sends the next one as soon as one is answered
+//   open loop (--rate R) : R commands per second in total are sent on a fixed
+//                          schedule whether or not replies came back; latency is
+//                          measured from the scheduled send time, so a stalled
+//                          server shows up as latency instead of being hidden
+//
+// Run the server with --mock so no browser / xdotool / gnome-screenshot is needed:
+//   ./tcp_server --mock &
+//   ./tcp_bench --connections 16 --duration 10 --mix "vol+:4,vol-:4,vol get:1"
+//
+// --binary sends the same mix over the binary protocol (see BinaryProtocol.hpp):
+// every connection switches with "binary", the command names are resolved to
+// opcodes once, and replies are matched to commands by request id.
+
+#include "../header/LatencyHistogram.hpp"
+#include "../header/BinaryProtocol.hpp"
+#include "../header/BenchClient.hpp"
+#include "../header/Config.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = Config().port;
+    int connections = 4;
+    double duration = 5.0;       // seconds of measurement
+    double warmup = 1.0;         // seconds before measurement starts
+    double rate = 0.0;           // total commands per second, 0 = closed loop
+    int pipeline = 1;            // commands in flight per connection (closed loop)
+    std::string mix = "vol+:1,vol-:1";
+    bool binary = false;         // use the binary protocol
+};
+
+struct MixEntry {
+    std::string line;            // command including the trailing "\n"
+    int weight;
+    uint32_t opcode = 0;         // binary: resolved command
+    std::vector<std::string> args;
+};
+
+// State of one benchmark connection
+struct BenchConnection {
+    int fd = -1;
+    std::deque<uint64_t> inFlight;   // send (or scheduled) times, oldest first
+    std::deque<uint64_t> ids;        // binary: request id of each inFlight entry
+    uint64_t nextId = 1;
+    std::string outbox;              // bytes not yet accepted by the socket
+    std::string partial;             // incomplete reply line
+    uint64_t nextSend = 0;           // open loop: scheduled time of the next command
+    bool wantWrite = false;
+};
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --host ADDR          server address (127.0.0.1)\n"
+              << "  --port N             server port (" << Config().port << ")\n"
+              << "  --config FILE        take the port from the server's configuration file\n"
+              << "  --connections N      concurrent connections (4)\n"
+              << "  --duration S         measured seconds (5)\n"
+              << "  --warmup S           seconds before measuring (1)\n"
+              << "  --rate R             open loop: total commands/s (0 = closed loop)\n"
+              << "  --pipeline N         closed loop: commands in flight per connection (1)\n"
+              << "  --mix \"cmd:w,...\"    weighted command mix (\"vol+:1,vol-:1\")\n"
+              << "  --binary             use the binary protocol\n";
+}
+
+static bool parseOptions(int argc, char* argv[], Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help") return false;
+        if (arg == "--binary") {
+            opt.binary = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--host") opt.host = value;
+        else if (arg == "--port") opt.port = atoi(value.c_str());
+        else if (arg == "--config") {
+            if (!BenchClient::portFromConfig(value, opt.port)) return false;
+        }
+        else if (arg == "--connections") opt.connections = atoi(value.c_str());
+        else if (arg == "--duration") opt.duration = atof(value.c_str());
+        else if (arg == "--warmup") opt.warmup = atof(value.c_str());
+        else if (arg == "--rate") opt.rate = atof(value.c_str());
+        else if (arg == "--pipeline") opt.pipeline = atoi(value.c_str());
+        else if (arg == "--mix") opt.mix = value;
+        else {
+            std::cerr << "Unknown option " << arg << "\n";
+            return false;
+        }
+    }
+    return opt.connections > 0 && opt.pipeline > 0 && opt.duration > 0;
+}
+
+// Parses "vol+:4,vol-:4,vol get:1" into weighted entries
+static std::vector<MixEntry> parseMix(const std::string& mix) {
+    std::vector<MixEntry> entries;
+    size_t pos = 0;
+    while (pos <= mix.size()) {
+        size_t comma = mix.find(',', pos);
+        std::string item = mix.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        size_t colon = item.rfind(':');
+        MixEntry entry;
+        entry.line = (colon == std::string::npos ? item : item.substr(0, colon)) + "\n";
+        entry.weight = colon == std::string::npos ? 1 : atoi(item.c_str() + colon + 1);
+        if (entry.line.size() > 1 && entry.weight > 0) entries.push_back(entry);
+        if (comma == std::string::npos) break;
+        pos = comma + 1;
+    }
+    return entries;
+}
+
+// Picks a command from the mix (xorshift: cheap and good enough here)
+static const MixEntry& pickCommand(const std::vector<MixEntry>& mix, int totalWeight, uint64_t& seed) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    int r = static_cast<int>(seed % totalWeight);
+    for (size_t i = 0; i < mix.size(); ++i) {
+        if (r < mix[i].weight) return mix[i];
+        r -= mix[i].weight;
+    }
+    return mix.back();
+}
+
+// Queues one command of the mix on a connection; returns the request id (0 for text)
+static uint64_t queueCommand(BenchConnection& c, const MixEntry& entry, bool binary) {
+    if (!binary) {
+        c.outbox += entry.line;
+        return 0;
+    }
+    uint64_t id = c.nextId++;
+    BinaryProtocol::appendRequest(c.outbox, entry.opcode, id, entry.args);
+    return id;
+}
+
+// Switches a (still blocking) connection to the binary protocol and returns
+// the server's "opcode name" table
+static bool negotiateBinary(int fd, std::string& table) {
+    std::string hello = "binary\n";
+    BinaryProtocol::appendRequest(hello, BinaryProtocol::OP_LIST, 0, std::vector<std::string>());
+    if (send(fd, hello.data(), hello.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(hello.size())) return false;
+
+    std::string in;
+    char buffer[4096];
+    for (;;) {
+        size_t nl = in.find('\n');
+        if (nl != std::string::npos) {
+            std::string_view payload;
+            size_t used = 0;
+            if (BinaryProtocol::nextFrame(std::string_view(in).substr(nl + 1), payload, used)) {
+                uint64_t id = 0;
+                BinaryProtocol::Status status;
+                std::string_view text;
+                if (!BinaryProtocol::decodeResponse(payload, id, status, text)) return false;
+                table.assign(text.data(), text.size());
+                return status == BinaryProtocol::STATUS_OK;
+            }
+        }
+        ssize_t got = read(fd, buffer, sizeof(buffer));
+        if (got <= 0) return false;
+        in.append(buffer, got);
+    }
+}
+
+// Resolves every mix entry to the longest command name its words start with
+static bool resolveOpcodes(std::vector<MixEntry>& mix, const std::string& table) {
+    for (size_t i = 0; i < mix.size(); ++i) {
+        std::string line = mix[i].line.substr(0, mix[i].line.size() - 1);
+        size_t bestLength = 0;
+        size_t pos = 0, nl;
+        while ((nl = table.find('\n', pos)) != std::string::npos) {
+            std::string entry = table.substr(pos, nl - pos);
+            pos = nl + 1;
+            size_t space = entry.find(' ');
+            std::string name = entry.substr(space + 1);
+            bool matches = line.compare(0, name.size(), name) == 0 &&
+                           (line.size() == name.size() || line[name.size()] == ' ');
+            if (matches && name.size() > bestLength) {
+                bestLength = name.size();
+                mix[i].opcode = static_cast<uint32_t>(atoi(entry.c_str()));
+            }
+        }
+        if (bestLength == 0) {
+            std::cerr << "Unknown command in mix: " << line << "\n";
+            return false;
+        }
+        mix[i].args.clear();
+        size_t start = bestLength;
+        while ((start = line.find_first_not_of(' ', start)) != std::string::npos) {
+            size_t end = line.find(' ', start);
+            mix[i].args.push_back(line.substr(start, end == std::string::npos ? std::string::npos : end - start));
+            start = end;
+        }
+    }
+    return true;
+}
+
+static int connectTo(const Options& opt, std::string* table) {
+    int fd = BenchClient::connectTo(opt.host, opt.port);
+    if (fd < 0) return -1;
+    if (opt.binary && !negotiateBinary(fd, *table)) {
+        close(fd);
+        return -1;
+    }
+    BenchClient::setNonBlocking(fd);
+    return fd;
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<MixEntry> mix = parseMix(opt.mix);
+    int totalWeight = 0;
+    for (size_t i = 0; i < mix.size(); ++i) totalWeight += mix[i].weight;
+    if (mix.empty()) {
+        std::cerr << "Empty command mix\n";
+        return 1;
+    }
+
+    // 1. Open the connections
+    int epfd = epoll_create1(0);
+    std::vector<BenchConnection> conns(opt.connections);
+    for (int i = 0; i < opt.connections; ++i) {
+        std::string table;
+        conns[i].fd = connectTo(opt, &table);
+        if (conns[i].fd < 0) {
+            std::cerr << "Connection " << i << " failed: " << strerror(errno) << "\n";
+            return 1;
+        }
+        if (opt.binary && i == 0 && !resolveOpcodes(mix, table)) return 1;
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u32 = i;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, conns[i].fd, &ev);
+    }
+
+    // 2. Run: warmup, then measurement
+    bool openLoop = opt.rate > 0;
+    uint64_t interval = openLoop ? static_cast<uint64_t>(1e9 * opt.connections / opt.rate) : 0;
+    uint64_t start = BenchClient::nowNs();
+    uint64_t measureFrom = start + static_cast<uint64_t>(opt.warmup * 1e9);
+    uint64_t stopAt = measureFrom + static_cast<uint64_t>(opt.duration * 1e9);
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+
+    LatencyHistogram latency;
+    uint64_t sent = 0, acked = 0, busy = 0;
+    bool failed = false;
+
+    for (int i = 0; i < opt.connections; ++i) {
+        conns[i].nextSend = start + (openLoop ? interval * i / opt.connections : 0);
+    }
+
+    char buffer[16384];
+    struct epoll_event events[64];
+    while (!failed) {
+        uint64_t now = BenchClient::nowNs();
+        if (now >= stopAt) break;
+
+        // Send what is due
+        uint64_t nextWake = stopAt;
+        for (size_t i = 0; i < conns.size(); ++i) {
+            BenchConnection& c = conns[i];
+            if (openLoop) {
+                while (c.nextSend <= now) {
+                    c.ids.push_back(queueCommand(c, pickCommand(mix, totalWeight, seed), opt.binary));
+                    c.inFlight.push_back(c.nextSend);  // scheduled time: no coordinated omission
+                    if (c.nextSend >= measureFrom && c.nextSend < stopAt) ++sent;
+                    c.nextSend += interval;
+                }
+                if (c.nextSend < nextWake) nextWake = c.nextSend;
+            } else {
+                while (static_cast<int>(c.inFlight.size()) < opt.pipeline) {
+                    c.ids.push_back(queueCommand(c, pickCommand(mix, totalWeight, seed), opt.binary));
+                    c.inFlight.push_back(now);
+                    if (now >= measureFrom) ++sent;
+                }
+            }
+            if (!BenchClient::flush(c.fd, c.outbox)) failed = true;
+            bool wantWrite = !c.outbox.empty();
+            if (wantWrite != c.wantWrite) {
+                struct epoll_event ev;
+                memset(&ev, 0, sizeof(ev));
+                ev.events = EPOLLIN | (wantWrite ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+                ev.data.u32 = static_cast<uint32_t>(i);
+                epoll_ctl(epfd, EPOLL_CTL_MOD, c.fd, &ev);
+                c.wantWrite = wantWrite;
+            }
+        }
+
+        // Open loop sends are often less than a millisecond apart: wait the exact time
+        int n = BenchClient::waitEvents(epfd, events, 64, nextWake > now ? nextWake - now : 0);
+        for (int e = 0; e < n; ++e) {
+            BenchConnection& c = conns[events[e].data.u32];
+            if (events[e].events & EPOLLOUT && !BenchClient::flush(c.fd, c.outbox)) failed = true;
+            if (!(events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) continue;
+
+            ssize_t got = read(c.fd, buffer, sizeof(buffer));
+            if (got <= 0) {
+                if (got < 0 && errno == EAGAIN) continue;
+                std::cerr << "Server closed a connection\n";
+                failed = true;
+                break;
+            }
+
+            c.partial.append(buffer, got);
+            uint64_t arrived = BenchClient::nowNs();
+
+            // 3b. Binary: every response completes the command with its request id
+            if (opt.binary) {
+                std::string_view rest(c.partial);
+                std::string_view payload;
+                size_t used = 0;
+                while (BinaryProtocol::nextFrame(rest, payload, used)) {
+                    rest.remove_prefix(used);
+                    uint64_t id = 0;
+                    BinaryProtocol::Status status;
+                    std::string_view text;
+                    if (!BinaryProtocol::decodeResponse(payload, id, status, text)) continue;
+
+                    size_t k = 0;
+                    while (k < c.ids.size() && c.ids[k] != id) ++k;
+                    if (k == c.ids.size()) continue;
+                    uint64_t sentAt = c.inFlight[k];
+                    c.ids.erase(c.ids.begin() + k);
+                    c.inFlight.erase(c.inFlight.begin() + k);
+                    if (sentAt < measureFrom || sentAt >= stopAt) continue;
+                    if (status == BinaryProtocol::STATUS_BUSY) ++busy;
+                    ++acked;
+                    latency.record(arrived - sentAt);
+                }
+                c.partial.erase(0, c.partial.size() - rest.size());
+                continue;
+            }
+
+            // 3. Every "Command received." / "Busy:" line completes the oldest command
+            size_t lineStart = 0, nl;
+            while ((nl = c.partial.find('\n', lineStart)) != std::string::npos) {
+                BenchClient::Answer answer =
+                    BenchClient::answerOf(std::string_view(c.partial).substr(lineStart, nl - lineStart));
+                lineStart = nl + 1;
+                if (answer == BenchClient::ANSWER_NONE || c.inFlight.empty()) continue;
+
+                uint64_t sentAt = c.inFlight.front();
+                c.inFlight.pop_front();
+                c.ids.pop_front();
+                if (sentAt < measureFrom || sentAt >= stopAt) continue;
+                if (answer == BenchClient::ANSWER_BUSY) ++busy;
+                ++acked;
+                latency.record(arrived - sentAt);
+            }
+            c.partial.erase(0, lineStart);
+        }
+    }
+
+    for (size_t i = 0; i < conns.size(); ++i) close(conns[i].fd);
+    close(epfd);
+
+    // 4. Report
+    double seconds = opt.duration;
+    std::cout << "mode:        " << (openLoop ? "open loop" : "closed loop")
+              << (opt.binary ? ", binary protocol" : "") << "\n"
+              << "connections: " << opt.connections << "\n"
+              << "sent:        " << sent << "\n"
+              << "answered:    " << acked << " (busy " << busy << ")\n"
+              << "throughput:  " << static_cast<uint64_t>(acked / seconds) << " commands/s\n"
+              << "latency:     " << latency.summary() << "\n";
+    return failed ? 1 : 0;
+}
@@ -4,13 +4,34 @@
 #include <sys/socket.h>          // For socket functions
 #include <arpa/inet.h>           // For inet_pton()
 #include <netinet/in.h>          // For sockaddr_in structure
+#include <string>
+#include <cstdlib>               // For atoi()
+#include "../header/Config.hpp"
 
-#define PORT 8080                // Must match the server port
+int main(int argc, char* argv[]) {
+    // Server port: --port=N, or the port of the server's --config=PATH file (default 8080)
+    int port = Config().port;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--port=") == 0) {
+            port = atoi(arg.c_str() + 7);
+        } else if (arg.compare(0, 9, "--config=") == 0) {
+            Config config;
+            std::string error;
+            if (!Config::load(arg.substr(9), config, error)) {
+                std::cerr << "Configuration error: " << error << std::endl;
+                return -1;
+            }
+            port = config.port;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--port=N | --config=PATH]" << std::endl;
+            return -1;
+        }
+    }
 
-int main() {
     int sock = 0;                           // Socket file descriptor
     struct sockaddr_in serv_addr;          // Server address structure
-    const char *message = "Hello from client";  // Message to send
+    const char *message = "Hello from client\n";  // Message to send (one newline-terminated command)
     char buffer[1024] = {0};               // Buffer to receive server response
 
     // 1. Create a socket
@@ -22,7 +43,7 @@ int main() {
 
     // 2. Set server address info
     serv_addr.sin_family = AF_INET;             // IPv4
-    serv_addr.sin_port = htons(PORT);           // Port in network byte order
+    serv_addr.sin_port = htons(port);           // Port in network byte order
 
     // 3. Convert IPv4 address from text to binary (127.0.0.1 = localhost)
     if (inet_pton(AF_INET, "127.0.0.1", &serv_addr.sin_addr) <= 0) {
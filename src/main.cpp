@@ -1,260 +1,369 @@
 #include "../header/TCPServer.hpp"
+#include "../header/ReactorGroup.hpp"
+#include "../header/CommandRegistry.hpp"
+#include "../header/Commands.hpp"
+#include "../header/CommandDispatcher.hpp"
+#include "../header/ThreadPool.hpp"
+#include "../header/ProcessLauncher.hpp"
+#include "../header/ProcessControl.hpp"
+#include "../header/VolumeBackend.hpp"
+#include "../header/MetricsServer.hpp"
+#include "../header/Logger.hpp"
+#include "../header/Config.hpp"
+#include "../header/ConfigStore.hpp"
+#include "../header/ScreenshotService.hpp"
+#include "../header/ServerLifecycle.hpp"
+#include "../header/InputSink.hpp"
+#include "../header/InputChannel.hpp"
+#include "../header/TrafficCapture.hpp"
 #include <iostream>
-#include <cstdlib>  // For system()
-#include <algorithm>  // For std::remove
 #include <string>     // For std::string
-#include <unistd.h>
-#include <sys/types.h>
-#include <sys/wait.h>
-
-void toLowerCase(std::string& clientMsg) {
-    std::transform(clientMsg.begin(), clientMsg.end(), clientMsg.begin(), ::tolower);
+#include <algorithm>  // For std::max
+#include <thread>
+#include <memory>
+#include <vector>
+#include <cstdlib>    // For atoi()
+#include <set>
+#include <signal.h>   // For pthread_sigmask()
+
+// Prints the command line options
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [--config=PATH] [--port=N] [--volume=alsa|xdotool|mock] [--mock] [--metrics-port=N]\n"
+              << "       [--threads=N] [--pin-cpus] [--browser=PATH] [--warm-browsers] [--screenshot-source=x11|file:PATH|test]\n"
+              << "       [--io-backend=epoll|io_uring] [--input-backend=uinput|mock|off] [--input-udp-port=N]\n"
+              << "       [--capture=PATH]\n"
+              << "       [--log-file=PATH] [--log-format=text|json] [--log-level=debug|info|warn|error] [--log-rate=N]\n"
+              << "  --config         configuration file (apps, port, limits), reloaded on change and on SIGHUP\n"
+              << "  --port           command port (default 8080)\n"
+              << "  --mock           mock handlers: start no browsers or tools, in-memory volume and input (for benchmarks)\n"
+              << "  --metrics-port   admin port serving Prometheus metrics (default 9100, 0 = off)\n"
+              << "  --threads        reactor threads sharing the port via SO_REUSEPORT (default 1, 0 = one per CPU)\n"
+              << "  --pin-cpus       pin reactor thread i to CPU i\n"
+              << "  --browser        browser executable for the app windows (default google-chrome)\n"
+              << "  --warm-browsers  keep a hidden browser per app running so \"open\" is fast\n"
+              << "  --screenshot-source  where screenshots come from (default: X display, test pattern with --mock)\n"
+              << "  --io-backend     client socket I/O (default epoll; io_uring needs Linux 6.0, else epoll is used)\n"
+              << "  --input-backend  remote mouse / keyboard (default uinput when available, mock with --mock)\n"
+              << "  --input-udp-port UDP port for remote input messages (default 0 = off)\n"
+              << "  --capture        record what clients send to PATH, for tcp_replay\n"
+              << "  --log-file       append the log to PATH instead of stdout\n"
+              << "  --log-rate       lines per second each log statement may write (default 100, 0 = unlimited)\n"
+              << "Options given on the command line override the configuration file.\n";
 }
 
-void openFacebookLinux() {
-    pid_t pid = fork();
-
-    if (pid == 0) {
-        // Child process: Launch the browser
-        execlp("google-chrome", "google-chrome",
-               "--user-data-dir=/tmp/fb_session",
-               "--app=https://facebook.com",
-               "--kiosk",
-               "--disable-gpu",               // Optional: helps reduce GPU warnings
-               (char *)NULL);
-
-        // If execlp fails
-        std::cerr << "Failed to launch browser\n";
-        exit(1);
-    } else if (pid < 0) {
-        std::cerr << "Fork failed\n";
+// Applies one command line option that overrides a configuration file setting.
+// Returns false if "arg" is not such an option.
+static bool applyOverride(Config& config, const std::string& arg) {
+    if (arg.compare(0, 7, "--port=") == 0) {
+        config.port = atoi(arg.c_str() + 7);
+    } else if (arg.compare(0, 15, "--metrics-port=") == 0) {
+        config.metricsPort = atoi(arg.c_str() + 15);
+    } else if (arg.compare(0, 10, "--threads=") == 0) {
+        config.threads = atoi(arg.c_str() + 10);
+    } else if (arg.compare(0, 10, "--browser=") == 0) {
+        config.browser = arg.substr(10);
+    } else if (arg == "--warm-browsers") {
+        config.warmBrowsers = true;
+    } else if (arg == "--pin-cpus") {
+        config.pinCpus = true;
+    } else if (arg.compare(0, 20, "--screenshot-source=") == 0) {
+        config.screenshotSource = arg.substr(20);
+    } else if (arg.compare(0, 13, "--io-backend=") == 0) {
+        config.ioBackend = arg.substr(13);
+    } else if (arg.compare(0, 16, "--input-backend=") == 0) {
+        config.inputBackend = arg.substr(16);
+    } else if (arg.compare(0, 17, "--input-udp-port=") == 0) {
+        config.inputUdpPort = atoi(arg.c_str() + 17);
+    } else if (arg.compare(0, 10, "--capture=") == 0) {
+        config.captureFile = arg.substr(10);
     } else {
-        std::cout << "Facebook should be launching in the background.\n";
+        return false;
     }
+    return true;
 }
 
-void openYoutubeLinux() {
-    pid_t pid = fork();
-
-    if (pid == 0) {
-        // Child process: Launch the browser
-        execlp("google-chrome", "google-chrome",
-               "--user-data-dir=/tmp/youtube_session",  // You can change the session directory
-               "--app=https://www.youtube.com/",             // Change URL to YouTube
-               "--kiosk",
-               "--disable-gpu",                        // Optional: helps reduce GPU warnings
-               (char *)NULL);
-
-        // If execlp fails
-        std::cerr << "Failed to launch browser\n";
-        exit(1);
-    } else if (pid < 0) {
-        std::cerr << "Fork failed\n";
-    } else {
-        std::cout << "YouTube should be launching in the background.\n";
+// Reads the configuration file (built-in defaults without one) and applies
+// the command line overrides on top
+static bool loadConfig(const std::string& path, const std::vector<std::string>& overrides, Config& config) {
+    Config loaded = Config::defaults();
+    std::string error;
+    if (!path.empty() && !Config::load(path, loaded, error)) {
+        LOG_ERROR("Configuration error: ", error);
+        return false;
     }
+    for (size_t i = 0; i < overrides.size(); ++i) applyOverride(loaded, overrides[i]);
+    config = loaded;
+    return true;
 }
 
-void openGitHUbLInux()
-{
-    pid_t pid = fork();
-    if(pid == 0)
-    {
-        // Child process: Launch the browser
-        execlp("google-chrome", "google-chrome",
-               "--user-data-dir=/tmp/github_session",  // You can change the session directory
-               "--app=https://github.com",             // Change URL to GitHub
-               "--kiosk",
-               "--disable-gpu",                        // Optional: helps reduce GPU warnings
-               (char *)NULL);
-
-        // If execlp fails
-        std::cerr << "Failed to launch browser\n";
-        exit(1);
-
-    }
-    else if (pid < 0)
-    {
-        std::cerr << "Fork failed\n";
-    }
-    else
-    {
-        std::cout << "GitHub should be launching in the background.\n";
+int main(int argc, char* argv[]) {
+    // Command line options
+    std::string volumeKind;  // "" = best available
+    bool mock = false;
+    std::string configPath;  // "" = built-in defaults
+    std::vector<std::string> overrides;
+    std::string logFile;     // "" = stdout
+    Logger::Format logFormat = Logger::FORMAT_TEXT;
+    Logger::Level logLevel = Logger::LEVEL_INFO;
+    int logRate = 100;
+    bool validOption = true;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        Config scratch;
+        if (applyOverride(scratch, arg)) {
+            overrides.push_back(arg);
+        } else if (arg.compare(0, 9, "--volume=") == 0) {
+            volumeKind = arg.substr(9);
+        } else if (arg.compare(0, 9, "--config=") == 0) {
+            configPath = arg.substr(9);
+        } else if (arg.compare(0, 11, "--log-file=") == 0) {
+            logFile = arg.substr(11);
+        } else if (arg.compare(0, 13, "--log-format=") == 0) {
+            validOption = Logger::parseFormat(arg.substr(13), logFormat);
+        } else if (arg.compare(0, 12, "--log-level=") == 0) {
+            validOption = Logger::parseLevel(arg.substr(12), logLevel);
+        } else if (arg.compare(0, 11, "--log-rate=") == 0) {
+            logRate = atoi(arg.c_str() + 11);
+        } else if (arg == "--mock") {
+            mock = true;
+            volumeKind = "mock";
+        } else {
+            validOption = false;
+        }
+        if (!validOption) {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
     }
-}
-
-
-
-// Function to increase the volume by 5%
-void increaseVolume() {
-    std::cout << "Increasing volume..." << std::endl;
-    system("xdotool key XF86AudioRaiseVolume");
-}
-
-void decreaseVolume() {
-    std::cout << "Decreasing volume..." << std::endl;
-    system("xdotool key XF86AudioLowerVolume");
-}
 
+    // SIGCHLD, SIGHUP, SIGTERM and SIGINT are read through signalfds (launcher,
+    // config store, lifecycle). Block them before the first thread starts so
+    // every thread inherits the mask; otherwise a SIGHUP delivered to such a
+    // thread would kill the process.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGCHLD);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    // Asynchronous logger: LOG_* calls only queue a record, a thread writes them out
+    Logger& logger = Logger::instance();
+    logger.setLevel(logLevel);
+    logger.setRateLimit(logRate < 0 ? 0 : logRate);
+    if (!logger.start(logFile, logFormat)) return 1;
+
+    // Settings from the configuration file and the command line
+    Config config;
+    if (!loadConfig(configPath, overrides, config)) return 1;
+
+    // Received bytes of every client, for tcp_replay (declared before the
+    // reactors: closing their connections still records)
+    TrafficCapture capture;
+    if (!config.captureFile.empty()) {
+        std::string error;
+        if (!capture.open(config.captureFile, static_cast<uint64_t>(config.captureLimitMb) * 1024 * 1024, error)) {
+            LOG_ERROR("Capture file: ", error);
+            return 1;
+        }
+        LOG_INFO("Recording client traffic to ", config.captureFile);
+    }
 
-void openGmailLinux() {
-    pid_t pid = fork();
+    // Reactor threads, each with its own listening socket on the command port
+    ReactorGroup reactors(config.port, config.threads);
+    reactors.setPinning(config.pinCpus);
 
-    if (pid == 0) {
-        // Child process: Launch the browser
-        execlp("google-chrome", "google-chrome",
-               "--user-data-dir=/tmp/gmail_session",          // Session directory
-               "--app=https://mail.google.com/mail",          // Gmail URL
-               "--start-fullscreen",                          // Allows fullscreen with minimize
-               "--disable-gpu",                               // Optional GPU flag
-               (char *)NULL);
+    // A server already running with the same handoff socket gives us its
+    // listening sockets (and then drains and exits): no connection is refused
+    std::vector<int> inherited;
+    ServerLifecycle::inherit(config.handoffSocket, inherited);
 
-        // If execlp fails
-        std::cerr << "Failed to launch browser\n";
-        exit(1);
-    } else if (pid < 0) {
-        std::cerr << "Fork failed\n";
-    } else {
-        std::cout << "Gmail should be launching in the background.\n";
+    // Client socket I/O through io_uring where the kernel supports it
+    for (size_t i = 0; i < reactors.size(); ++i) {
+        reactors.shard(i).setIoBackend(config.ioBackend == "io_uring" ? TcpServer::IO_URING : TcpServer::IO_EPOLL);
     }
-}
 
-
-int main() {
-    // Create the server instance, listening on port 8080
-    TcpServer server(8080);
-
-    // Start the server (sets up socket, binds, listens, and accepts client)
-    if (!server.start()) {
-        std::cerr << "Failed to start server.\n";
+    // Start the servers (sets up sockets, binds, listens, and creates the event loops)
+    if (!reactors.start(inherited)) {
+        LOG_ERROR("Failed to start server.");
         return 1;
     }
 
-    bool youtubeMode = false;
-
-    while (true) {
-        // Receive data from the client
-        std::string clientMsg = server.receiveData();
-
-        // Clean up newline and carriage return characters from client message
-        clientMsg.erase(std::remove(clientMsg.begin(), clientMsg.end(), '\n'), clientMsg.end());
-        clientMsg.erase(std::remove(clientMsg.begin(), clientMsg.end(), '\r'), clientMsg.end());
-
-        std::cout << "Client: " << clientMsg << std::endl;
+    // Once-per-process descriptors (metrics, SIGCHLD, kill timer) live on shard 0
+    TcpServer& server = reactors.shard(0);
+    for (size_t i = 0; i < reactors.size(); ++i) {
+        TcpServer& shard = reactors.shard(i);
+        shard.setOutboxLimit(config.outboxLimit);
+        shard.setIdleTimeout(config.idleTimeout);
+        shard.setNoDelay(config.tcpNoDelay);
+        shard.setKeepAlive(config.keepAlive);
+        if (capture.active()) shard.setCapture(&capture);
+    }
 
-        // Convert the message to lowercase to handle case-insensitive input
-        toLowerCase(clientMsg);
+    // Graceful shutdown on SIGTERM / SIGINT / "exit", listening socket handoff on restart
+    ServerLifecycle lifecycle(reactors);
+    lifecycle.setDrainTimeout(config.drainTimeout);
+    if (!lifecycle.attach(server, config.handoffSocket)) {
+        LOG_ERROR("Failed to set up shutdown handling.");
+        return 1;
+    }
 
-        if (clientMsg == "open facebook") {
-            std::cout << "Opening Facebook..." << std::endl;
+    // Prometheus metrics on the admin port (same event loop)
+    MetricsServer metrics(config.metricsPort);
+    if (config.metricsPort > 0 && !metrics.attach(server)) {
+        LOG_ERROR("Failed to start metrics endpoint.");
+        return 1;
+    }
 
-            #ifdef _WIN32
-                system("start https://www.facebook.com");
-            #elif __APPLE__
-                system("open https://www.facebook.com");
-            #elif __linux__
-                openFacebookLinux();
-            #endif
-        }
-        else if (clientMsg == "close facebook") {
-            std::cout << "Closing Facebook..." << std::endl;
+    // Which apps are open (updated by the open / close commands and on child exit)
+    AppRegistry apps;
 
-            #ifdef __linux__
-                system("pkill -f '/tmp/fb_session'");
-            #endif
-        }
-        else if (clientMsg == "open youtube") {
-            std::cout << "Opening Youtube..." << std::endl;
+    // Starts browsers / tools and reaps them when they exit
+    ProcessLauncher launcher;
+    if (!launcher.attach(server)) {
+        LOG_ERROR("Failed to set up process launcher.");
+        return 1;
+    }
+    launcher.setDryRun(mock);
+
+    // Browser app windows; in warm mode a hidden instance per app waits for "open"
+    BrowserPool browsers(launcher);
+    browsers.setWarm(config.warmBrowsers);
+
+    launcher.setExitHandler([&apps, &browsers](pid_t pid, const std::string& session, int status) {
+        LOG_INFO("Process ", pid, " (", session, ") exited with status ", status);
+        apps.exited(pid, session, status);
+        browsers.onExit(pid, session, status);
+    });
+
+    // Closes launched programs with kill() instead of pkill
+    ProcessControl control(launcher);
+    if (!control.attach(server)) {
+        LOG_ERROR("Failed to set up process control.");
+        return 1;
+    }
 
-            #ifdef _WIN32
-                system("start https://www.Youtube.com");
-            #elif __APPLE__
-                system("open https://www.Youtube.com");
-            #elif __linux__
-                openYoutubeLinux();
-            #endif
-            youtubeMode = true;
-            server.sendData("YouTube opened. You can now search songs using: play <song name>\n");
-        }
-        else if (clientMsg == "close youtube") {
-            std::cout << "Closing Youtube..." << std::endl;
+    // Volume control (ALSA mixer when available)
+    std::unique_ptr<VolumeBackend> volume = createVolumeBackend(volumeKind, launcher);
+    if (!volume) {
+        LOG_ERROR("Failed to set up volume control.");
+        return 1;
+    }
+    LOG_INFO("Volume backend: ", volume->name());
 
-            #ifdef __linux__
-                system("pkill -f '/tmp/youtube_session'");
-            #endif
-        }
-        else if (clientMsg == "vol+") {
-            increaseVolume();
-        }
-        else if (clientMsg == "vol-") {
-            decreaseVolume();
+    // Screenshots: captured and encoded in-process, sent back to the client
+    std::unique_ptr<FrameSource> frames =
+        createFrameSource(config.screenshotSource.empty() && mock ? "test" : config.screenshotSource);
+    if (!frames) {
+        LOG_ERROR("Failed to set up screenshot source.");
+        return 1;
+    }
+    ScreenshotService screenshots(std::move(frames));
+    LOG_INFO("Screenshot source: ", screenshots.sourceName());
+
+    // Remote mouse / keyboard through a persistent uinput device
+    std::string inputKind = config.inputBackend.empty() && mock ? "mock" : config.inputBackend;
+    std::unique_ptr<InputSink> input;
+    if (inputKind != "off") {
+        input = createInputSink(inputKind);
+        if (!input && !inputKind.empty()) {
+            LOG_ERROR("Failed to set up remote input.");
+            return 1;
         }
-        else if (clientMsg == "open github")
-        {
-            std::cout << "Opening GitHub..." << std::endl;
-
-            #ifdef _WIN32
-                system("start https://www.github.com");
-            #elif __APPLE__
-                system("open https://www.github.com");
-            #elif __linux__
-                openGitHUbLInux();
-            #endif
+    }
+    LOG_INFO("Input backend: ", input ? input->name() : "off");
+    std::unique_ptr<InputChannel> udpInput;
+    if (config.inputUdpPort > 0) {
+        if (input) udpInput.reset(new InputChannel(*input));
+        if (!udpInput || !udpInput->attach(server, config.inputUdpPort)) {
+            LOG_ERROR("Failed to open the remote input port.");
+            return 1;
         }
-        else if (clientMsg == "close github")
-        {
-            std::cout << "Closing GitHub..." << std::endl;
+    }
 
-            #ifdef _WIN32
-                system("taskkill /F /IM chrome.exe");
-            #elif __APPLE__
-                system("pkill -f 'Google Chrome'");
-            #elif __linux__
-                system("pkill -f '/tmp/github_session'");
-            #endif
+    // Workers for slow commands (screenshot) and stream frames; at most
+    // worker_queue jobs wait in the queue
+    ThreadPool pool(std::max(2u, std::thread::hardware_concurrency()), config.workerQueue);
+    ScreenStreamer streamer(screenshots.frameSource(), pool);
+
+    // All commands the clients can send (see Commands.cpp), rebuilt and
+    // republished as a whole whenever the configuration is reloaded
+    CommandServices services{launcher, control, *volume, apps, browsers, screenshots, streamer, input.get(), mock,
+                             [&lifecycle]() { lifecycle.shutdown("exit command"); }};
+    ConfigStore store;
+    std::shared_ptr<RuntimeConfig> runtime = std::make_shared<RuntimeConfig>();
+    runtime->config = config;
+    registerBuiltinCommands(runtime->commands, services, runtime->config);
+    store.publish(runtime);
+    browsers.warmAll();
+
+    // Reload on SIGHUP / file change: a broken file keeps the running configuration
+    ConfigStore::ReloadHandler reload = [&store, &services, &browsers, &lifecycle, configPath, overrides]() {
+        Config next;
+        if (!loadConfig(configPath, overrides, next)) {
+            LOG_WARN("Keeping the current configuration.");
+            return;
         }
-        else if (clientMsg == "screenshot") {
-            std::cout << "Taking screenshot..." << std::endl;
-
-            // Save the screenshot to a file
-            system("gnome-screenshot -f ~/Desktop/screenshot.png");
-
-            server.sendData("Screenshot taken and saved to ~/Desktop/screenshot.png\n");
+        store.refresh();  // runs between batches: no snapshot references are held here
+        const Config& running = store.current().config;
+        if (next.port != running.port || next.metricsPort != running.metricsPort || next.threads != running.threads ||
+            next.pinCpus != running.pinCpus || next.warmBrowsers != running.warmBrowsers ||
+            next.workerQueue != running.workerQueue || next.outboxLimit != running.outboxLimit ||
+            next.idleTimeout != running.idleTimeout || next.tcpNoDelay != running.tcpNoDelay ||
+            next.keepAlive != running.keepAlive || next.handoffSocket != running.handoffSocket ||
+            next.ioBackend != running.ioBackend || next.screenshotSource != running.screenshotSource ||
+            next.inputBackend != running.inputBackend || next.inputUdpPort != running.inputUdpPort ||
+            next.captureFile != running.captureFile || next.captureLimitMb != running.captureLimitMb) {
+            LOG_WARN("Port, thread, queue, connection, screenshot source, input and capture settings only change after a restart.");
         }
-        else if (clientMsg == "open gmail") {
-            std::cout << "Opening Gmail..." << std::endl;
-
-            #ifdef _WIN32
-                system("start https://www.github.com");
-            #elif __APPLE__
-                system("open https://www.github.com");
-            #elif __linux__
-                openGmailLinux();
-            #endif        
-            }
-        else if (clientMsg == "close gmail") {
-            std::cout << "Closing Gmail..." << std::endl;
+        std::shared_ptr<RuntimeConfig> rebuilt = std::make_shared<RuntimeConfig>();
+        rebuilt->config = next;
+        registerBuiltinCommands(rebuilt->commands, services, rebuilt->config);
+        store.publish(rebuilt);
+        lifecycle.setDrainTimeout(next.drainTimeout);
+        browsers.warmAll();
+        LOG_INFO("Configuration reloaded (", next.apps.size(), " apps, version ", store.version(), ").");
+    };
+    if (!store.attach(server, configPath, reload)) {
+        LOG_ERROR("Failed to set up configuration reload.");
+        return 1;
+    }
 
-            #ifdef _WIN32
-                system("taskkill /F /IM chrome.exe");
-            #elif __APPLE__
-                system("pkill -f 'Google Chrome'");
-            #elif __linux__
-                system("pkill -f '/tmp/gmail_session'");
-            #endif
-        }
+    // Called by each event loop for every message its clients send
+    // (one call per newline-terminated command, without the "\n" / "\r\n").
+    // One dispatcher per reactor thread; worker limits are shared.
+    CommandDispatcher::InFlightTable inFlight;
+    CommandDispatcher::RateTable rates;
+    std::vector<std::unique_ptr<CommandDispatcher> > dispatchers;
+    for (size_t i = 0; i < reactors.size(); ++i) {
+        TcpServer& shard = reactors.shard(i);
+        dispatchers.push_back(std::unique_ptr<CommandDispatcher>(new CommandDispatcher(shard, store, pool, inFlight, rates)));
+        CommandDispatcher& dispatcher = *dispatchers.back();
+        if (input) dispatcher.setInputSink(*input);
+        shard.setMessageHandler([&dispatcher](TcpServer::ConnectionId client, std::string_view frame) {
+            dispatcher.onFrame(client, frame);
+        });
+        shard.setBatchEndHandler([&dispatcher](TcpServer::ConnectionId client) {
+            dispatcher.onBatchEnd(client);
+        });
+        shard.setDisconnectHandler([&dispatcher, &streamer, &shard](TcpServer::ConnectionId client) {
+            dispatcher.onDisconnect(client);
+            streamer.onDisconnect(shard, client);
+        });
+        shard.setDrainHandler([&dispatcher, &streamer, &shard]() {
+            streamer.stopAll(shard);
+            return dispatcher.idle();
+        });
+        streamer.addShard(shard, dispatcher);
+    }
 
-        else if (clientMsg == "exit") {
-            std::cout << "Shutting down server." << std::endl;
-            break; // Exit the loop and end the server
-        }
-        else {
-            std::cout << "Unknown command." << std::endl;
-        }
+    // Serve every connected client until "exit", SIGTERM or a replacement process
+    reactors.run();
 
-        // Send a response back to the client
-        server.sendData("Command received.\n");
-    }
+    // A drain that timed out leaves worker jobs behind; they refer to the
+    // dispatchers and the streamer, so the pool stops before those are destroyed
+    pool.shutdown();
 
     return 0; // Destructor will automatically close the sockets when exiting
 }
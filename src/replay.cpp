@@ -0,0 +1,539 @@
+// tcp_replay: feeds a traffic capture back to tcp_server.
+//
+// The server records what its clients send with --capture=PATH (see
+// TrafficCapture.hpp). tcp_replay opens one connection per recorded client and
+// sends the recorded bytes again, at the recorded times or faster, and
+// measures the time until each command is answered:
+//
+//   --speed 1 (default) : original timing; --speed 4 replays four times as fast.
+//                         Latency is measured from the scheduled send time, so
+//                         a stalled server shows up as latency.
+//   --speed 0           : as fast as possible; every connection keeps at most
+//                         --pipeline commands in flight and sends the next
+//                         recorded bytes as soon as there is room.
+//
+// Run the server with --mock so replayed "open" / "screenshot" commands start
+// nothing:
+//   ./tcp_server --capture=/tmp/day.pccap              (record a day, stop with "exit")
+//   ./tcp_server --mock &
+//   ./tcp_replay --capture /tmp/day.pccap --speed 0 --save old.hist
+//   (rebuild, restart the server)
+//   ./tcp_replay --capture /tmp/day.pccap --speed 0 --baseline old.hist
+//
+// With --baseline the percentiles (and at --speed 0 the throughput) are
+// compared with a histogram saved by --save; if p50, p90, p99 or the
+// throughput got worse by more than --tolerance percent the exit status is 2.
+//
+// Text commands (newline-terminated, or length-prefixed after "framed") are
+// answered by a "Command received." or "Busy:" line; "binary", "input" and
+// "framed" switch the connection like the server does, binary requests are
+// matched by request id and input messages get no answer.
+
+#include "../header/LatencyHistogram.hpp"
+#include "../header/BinaryProtocol.hpp"
+#include "../header/TrafficCapture.hpp"
+#include "../header/BenchClient.hpp"
+#include "../header/Config.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/prctl.h>
+
+// A connection whose recorded client left is closed this long after its last
+// bytes were sent even if answers are missing
+static const uint64_t CLOSE_WAIT_NS = 5000000000ULL;
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = Config().port;
+    std::string capture;
+    double speed = 1.0;          // 0 = as fast as possible
+    int pipeline = 16;           // --speed 0: commands in flight per connection
+    std::string save;            // write the latency histogram here
+    std::string baseline;        // compare with this saved histogram
+    double tolerance = 10.0;     // percent
+};
+
+// What the replayed client sends / the server answers on one connection
+enum Protocol { PROTOCOL_TEXT, PROTOCOL_BINARY, PROTOCOL_INPUT, PROTOCOL_FRAMED };
+
+// Recorded bytes waiting for their time (or for pipeline room)
+struct Chunk {
+    uint64_t due;                // scheduled send time
+    std::string_view data;
+    bool close;                  // the recorded client closed here
+};
+
+// State of one replayed client
+struct ReplayConnection {
+    int fd = -1;
+    std::deque<Chunk> chunks;
+    std::string outbox;          // bytes not yet accepted by the socket
+    bool wantWrite = false;
+
+    Protocol sending = PROTOCOL_TEXT;    // protocol of the bytes we send
+    Protocol receiving = PROTOCOL_TEXT;  // protocol of the bytes we receive
+    std::string line;                    // text: line not complete yet
+    std::string request;                 // binary / framed: frame being sent
+    std::deque<uint64_t> inFlight;       // text: send times, oldest first
+    std::unordered_map<uint64_t, uint64_t> requests;  // binary: request id -> send time
+    std::string partial;                 // incomplete answer
+
+    bool closing = false;        // recorded close reached, waiting for the answers
+    uint64_t closeBy = 0;
+
+    size_t pending() const { return inFlight.size() + requests.size(); }
+};
+
+struct Totals {
+    uint64_t sent = 0;
+    uint64_t bytes = 0;
+    uint64_t answered = 0;
+    uint64_t busy = 0;
+    uint64_t unanswered = 0;
+    uint64_t skipped = 0;        // "exit" commands not sent
+};
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " --capture FILE [options]\n"
+              << "  --capture FILE       traffic recorded by tcp_server --capture=FILE\n"
+              << "  --host ADDR          server address (127.0.0.1)\n"
+              << "  --port N             server port (" << Config().port << ")\n"
+              << "  --config FILE        take the port from the server's configuration file\n"
+              << "  --speed X            1 = recorded timing, 2 = twice as fast, 0 = as fast as possible (1)\n"
+              << "  --pipeline N         --speed 0: commands in flight per connection (16)\n"
+              << "  --save FILE          write the latency histogram to FILE\n"
+              << "  --baseline FILE      compare with a histogram saved by --save\n"
+              << "  --tolerance PCT      allowed change against the baseline (10)\n";
+}
+
+static bool parseOptions(int argc, char* argv[], Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help") return false;
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--host") opt.host = value;
+        else if (arg == "--port") opt.port = atoi(value.c_str());
+        else if (arg == "--config") {
+            if (!BenchClient::portFromConfig(value, opt.port)) return false;
+        }
+        else if (arg == "--capture") opt.capture = value;
+        else if (arg == "--speed") opt.speed = atof(value.c_str());
+        else if (arg == "--pipeline") opt.pipeline = atoi(value.c_str());
+        else if (arg == "--save") opt.save = value;
+        else if (arg == "--baseline") opt.baseline = value;
+        else if (arg == "--tolerance") opt.tolerance = atof(value.c_str());
+        else {
+            std::cerr << "Unknown option " << arg << "\n";
+            return false;
+        }
+    }
+    return !opt.capture.empty() && opt.speed >= 0 && opt.pipeline > 0 && opt.tolerance >= 0;
+}
+
+// Helper comparing a command line with a command name (case-insensitive, like the server)
+static bool isCommand(const std::string& line, const char* name) {
+    size_t length = strlen(name);
+    size_t end = line.size();
+    while (end > 0 && (line[end - 1] == ' ' || line[end - 1] == '\t')) --end;
+    if (end != length) return false;
+    for (size_t i = 0; i < length; ++i) {
+        if (tolower(static_cast<unsigned char>(line[i])) != name[i]) return false;
+    }
+    return true;
+}
+
+// Helper queuing one complete text command ("wire" is how it was framed)
+static void queueCommand(ReplayConnection& c, const std::string& command, std::string_view wire, uint64_t sentAt,
+                         Totals& totals) {
+    if (isCommand(command, "exit")) {
+        ++totals.skipped;
+        return;
+    }
+    c.outbox.append(wire.data(), wire.size());
+    totals.bytes += wire.size();
+    if (isCommand(command, "binary")) {
+        c.sending = PROTOCOL_BINARY;
+    } else if (isCommand(command, "input")) {
+        c.sending = PROTOCOL_INPUT;
+    } else if (isCommand(command, "framed")) {
+        c.sending = PROTOCOL_FRAMED;
+    } else {
+        c.inFlight.push_back(sentAt);
+        ++totals.sent;
+    }
+}
+
+// Queues recorded bytes for sending and notes their commands, so the answers
+// can be timed
+/*
+    Follows the framing the server applies to the same bytes: text lines until
+    "binary", "input" or "framed", then binary request frames, input messages
+    or length-prefixed commands. Text is queued a whole command at a time.
+    "exit" is left out so a capture that ended with it does not stop the
+    server under test.
+*/
+static void queueBytes(ReplayConnection& c, std::string_view data, uint64_t sentAt, Totals& totals) {
+    for (size_t i = 0; i < data.size(); ++i) {
+        if (c.sending == PROTOCOL_FRAMED) {
+            std::string_view rest = data.substr(i);
+            c.request.append(rest.data(), rest.size());
+            size_t used = 0;
+            while (c.sending == PROTOCOL_FRAMED && c.request.size() - used >= 4) {
+                const unsigned char* header = reinterpret_cast<const unsigned char*>(c.request.data() + used);
+                size_t length = (static_cast<size_t>(header[0]) << 24) | (header[1] << 16) | (header[2] << 8) | header[3];
+                if (c.request.size() - used - 4 < length) break;
+                queueCommand(c, c.request.substr(used + 4, length), std::string_view(c.request).substr(used, 4 + length),
+                             sentAt, totals);
+                used += 4 + length;
+            }
+            std::string after = c.request.substr(used);
+            c.request.clear();
+            if (c.sending == PROTOCOL_FRAMED) c.request = after;
+            else queueBytes(c, after, sentAt, totals);   // switched again by a framed "binary" / "input"
+            return;
+        }
+        if (c.sending != PROTOCOL_TEXT) {
+            std::string_view rest = data.substr(i);
+            c.outbox.append(rest.data(), rest.size());
+            totals.bytes += rest.size();
+            if (c.sending == PROTOCOL_INPUT) return;
+
+            c.request.append(rest.data(), rest.size());
+            std::string_view frames(c.request);
+            std::string_view payload;
+            size_t used = 0;
+            while (BinaryProtocol::nextFrame(frames, payload, used)) {
+                frames.remove_prefix(used);
+                BinaryProtocol::Request request;
+                BinaryProtocol::decodeRequest(payload, request);
+                c.requests[request.id] = sentAt;
+                ++totals.sent;
+            }
+            c.request.erase(0, c.request.size() - frames.size());
+            return;
+        }
+
+        char ch = data[i];
+        c.line += ch;
+        if (ch != '\n') continue;
+
+        size_t length = c.line.size() - 1;
+        if (length > 0 && c.line[length - 1] == '\r') --length;
+        queueCommand(c, c.line.substr(0, length), c.line, sentAt, totals);
+        c.line.clear();
+    }
+}
+
+// Matches the answers in c.partial with the commands in flight
+static void readAnswers(ReplayConnection& c, uint64_t arrived, LatencyHistogram& latency, Totals& totals) {
+    size_t lineStart = 0, nl;
+    while (c.receiving == PROTOCOL_TEXT && (nl = c.partial.find('\n', lineStart)) != std::string::npos) {
+        std::string_view line = std::string_view(c.partial).substr(lineStart, nl - lineStart);
+        BenchClient::Answer answer = BenchClient::answerOf(line);
+        if (line.compare(0, 24, "Binary protocol enabled.") == 0) c.receiving = PROTOCOL_BINARY;
+        lineStart = nl + 1;
+        if (answer == BenchClient::ANSWER_NONE || c.inFlight.empty()) continue;
+
+        latency.record(arrived - c.inFlight.front());
+        c.inFlight.pop_front();
+        ++totals.answered;
+        if (answer == BenchClient::ANSWER_BUSY) ++totals.busy;
+    }
+    if (c.receiving == PROTOCOL_TEXT) {
+        c.partial.erase(0, lineStart);
+        return;
+    }
+
+    std::string_view rest(c.partial);
+    rest.remove_prefix(lineStart);
+    std::string_view payload;
+    size_t used = 0;
+    while (BinaryProtocol::nextFrame(rest, payload, used)) {
+        rest.remove_prefix(used);
+        uint64_t id = 0;
+        BinaryProtocol::Status status;
+        std::string_view text;
+        if (!BinaryProtocol::decodeResponse(payload, id, status, text) || status == BinaryProtocol::STATUS_MORE) continue;
+
+        std::unordered_map<uint64_t, uint64_t>::iterator it = c.requests.find(id);
+        if (it == c.requests.end()) continue;
+        latency.record(arrived - it->second);
+        c.requests.erase(it);
+        ++totals.answered;
+        if (status == BinaryProtocol::STATUS_BUSY) ++totals.busy;
+    }
+    c.partial.erase(0, c.partial.size() - rest.size());
+}
+
+// Saves a histogram as "bucket count" lines after a short header
+static bool saveHistogram(const std::string& path, const LatencyHistogram& latency, double seconds, double speed) {
+    std::ofstream out(path.c_str());
+    out << "# tcp_replay latency histogram\n"
+        << "seconds " << seconds << "\n"
+        << "speed " << speed << "\n";
+    const std::vector<uint64_t>& buckets = latency.buckets();
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        if (buckets[i] > 0) out << "bucket " << i << " " << buckets[i] << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+// Loads a histogram written by saveHistogram(); values are the bucket bounds
+static bool loadHistogram(const std::string& path, LatencyHistogram& latency, double& seconds, double& speed) {
+    std::ifstream in(path.c_str());
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        fields >> key;
+        if (key == "seconds") {
+            fields >> seconds;
+        } else if (key == "speed") {
+            fields >> speed;
+        } else if (key == "bucket") {
+            int bucket = -1;
+            uint64_t count = 0;
+            fields >> bucket >> count;
+            latency.addToBucket(bucket, count, count * LatencyHistogram::bucketUpperBound(bucket));
+        }
+    }
+    return true;
+}
+
+// Helper printing one row of the baseline comparison; true if it got worse
+// by more than "tolerance" percent ("higherIsBetter" for throughput)
+static bool compareRow(const char* name, double before, double after, const char* unit, double tolerance,
+                       bool higherIsBetter) {
+    double change = before > 0 ? (after - before) / before * 100.0 : 0.0;
+    bool worse = higherIsBetter ? change < -tolerance : change > tolerance;
+    char row[160];
+    snprintf(row, sizeof(row), "  %-11s %12.1f%-4s %12.1f%-4s %+8.1f%%%s\n", name, before, unit, after, unit, change,
+             worse ? "  worse" : "");
+    std::cout << row;
+    return worse;
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // 1. Load the capture
+    std::string contents;
+    std::vector<TrafficCapture::Record> records;
+    std::string error;
+    if (!TrafficCapture::load(opt.capture, contents, records, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    uint64_t recordedUs = records.empty() ? 0 : records.back().timeUs;
+
+    // 2. Replay: connect, send and close at the scheduled times, read answers.
+    // Latency counts from the scheduled time, so wake up on time: the default
+    // 50 us timer slack would show up in every measurement.
+    prctl(PR_SET_TIMERSLACK, 1UL);
+    bool maxSpeed = opt.speed == 0;
+    int epfd = epoll_create1(0);
+    std::unordered_map<uint64_t, ReplayConnection> conns;   // by stream number
+    std::unordered_map<int, uint64_t> streams;              // fd -> stream number
+    LatencyHistogram latency;
+    Totals totals;
+    bool failed = false;
+    size_t next = 0;
+    uint64_t start = BenchClient::nowNs();
+
+    char buffer[16384];
+    struct epoll_event events[64];
+    while (!failed && (next < records.size() || !conns.empty())) {
+        uint64_t now = BenchClient::nowNs();
+
+        // Records that are due: new connections, bytes and closes in recorded order
+        while (next < records.size()) {
+            const TrafficCapture::Record& record = records[next];
+            uint64_t due = maxSpeed ? start : start + static_cast<uint64_t>(record.timeUs * 1000.0 / opt.speed);
+            if (due > now) break;
+            ++next;
+
+            if (record.type == TrafficCapture::RECORD_OPEN) {
+                ReplayConnection& c = conns[record.stream];
+                c.fd = BenchClient::connectTo(opt.host, opt.port);
+                if (c.fd < 0) {
+                    std::cerr << "Connection failed: " << strerror(errno) << "\n";
+                    failed = true;
+                    break;
+                }
+                BenchClient::setNonBlocking(c.fd);
+                streams[c.fd] = record.stream;
+                struct epoll_event ev;
+                memset(&ev, 0, sizeof(ev));
+                ev.events = EPOLLIN;
+                ev.data.fd = c.fd;
+                epoll_ctl(epfd, EPOLL_CTL_ADD, c.fd, &ev);
+                continue;
+            }
+            std::unordered_map<uint64_t, ReplayConnection>::iterator it = conns.find(record.stream);
+            if (it == conns.end()) continue;  // the server closed it already
+            Chunk chunk = { due, record.data, record.type == TrafficCapture::RECORD_CLOSE };
+            it->second.chunks.push_back(chunk);
+        }
+        if (next == records.size()) {
+            // Clients still connected when the recording ended leave now
+            for (std::unordered_map<uint64_t, ReplayConnection>::iterator it = conns.begin(); it != conns.end(); ++it) {
+                ReplayConnection& c = it->second;
+                if (!c.closing && (c.chunks.empty() || !c.chunks.back().close)) {
+                    Chunk chunk = { now, std::string_view(), true };
+                    c.chunks.push_back(chunk);
+                }
+            }
+        }
+
+        // Send what is due (at full speed: while the pipeline has room)
+        std::vector<uint64_t> finished;
+        for (std::unordered_map<uint64_t, ReplayConnection>::iterator it = conns.begin(); it != conns.end(); ++it) {
+            ReplayConnection& c = it->second;
+            while (!c.chunks.empty() && !c.closing &&
+                   (!maxSpeed || static_cast<int>(c.pending()) < opt.pipeline || c.chunks.front().close)) {
+                Chunk& chunk = c.chunks.front();
+                if (chunk.close) {
+                    c.closing = true;
+                    c.closeBy = now + CLOSE_WAIT_NS;
+                } else {
+                    queueBytes(c, chunk.data, maxSpeed ? now : chunk.due, totals);
+                }
+                c.chunks.pop_front();
+            }
+            if (!BenchClient::flush(c.fd, c.outbox)) {
+                std::cerr << "Sending failed: " << strerror(errno) << "\n";
+                finished.push_back(it->first);
+                continue;
+            }
+            if (c.closing && c.outbox.empty() && (c.pending() == 0 || now >= c.closeBy)) {
+                finished.push_back(it->first);
+                continue;
+            }
+            bool wantWrite = !c.outbox.empty();
+            if (wantWrite != c.wantWrite) {
+                struct epoll_event ev;
+                memset(&ev, 0, sizeof(ev));
+                ev.events = EPOLLIN | (wantWrite ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+                ev.data.fd = c.fd;
+                epoll_ctl(epfd, EPOLL_CTL_MOD, c.fd, &ev);
+                c.wantWrite = wantWrite;
+            }
+        }
+        for (size_t i = 0; i < finished.size(); ++i) {
+            ReplayConnection& c = conns[finished[i]];
+            totals.unanswered += c.pending();
+            streams.erase(c.fd);
+            close(c.fd);
+            conns.erase(finished[i]);
+        }
+
+        // Wait for answers until the next record is due (at most 10 ms while
+        // closing connections wait for theirs)
+        uint64_t wake = now + 10000000ULL;
+        if (next < records.size() && !maxSpeed) {
+            uint64_t due = start + static_cast<uint64_t>(records[next].timeUs * 1000.0 / opt.speed);
+            if (due < wake) wake = due;
+        } else if (next < records.size()) {
+            wake = now;
+        }
+        int n = BenchClient::waitEvents(epfd, events, 64, wake > now ? wake - now : 0);
+        for (int e = 0; e < n; ++e) {
+            std::unordered_map<int, uint64_t>::iterator stream = streams.find(events[e].data.fd);
+            if (stream == streams.end()) continue;
+            ReplayConnection& c = conns[stream->second];
+            // A send that fails means the server closed the connection, as a read of 0 does
+            bool lost = (events[e].events & EPOLLOUT) && !BenchClient::flush(c.fd, c.outbox);
+            if (!lost) {
+                if (!(events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) continue;
+                ssize_t got = read(c.fd, buffer, sizeof(buffer));
+                if (got < 0 && errno == EAGAIN) continue;
+                if (got > 0) {
+                    c.partial.append(buffer, got);
+                    readAnswers(c, BenchClient::nowNs(), latency, totals);
+                    continue;
+                }
+            }
+
+            // Closed by the server ("exit", idle timeout, frame too large)
+            totals.unanswered += c.pending();
+            uint64_t number = stream->second;
+            streams.erase(stream);
+            close(c.fd);
+            conns.erase(number);
+        }
+    }
+    double seconds = (BenchClient::nowNs() - start) / 1e9;
+    for (std::unordered_map<uint64_t, ReplayConnection>::iterator it = conns.begin(); it != conns.end(); ++it) {
+        close(it->second.fd);
+    }
+    close(epfd);
+
+    // 3. Report
+    char speed[32];
+    snprintf(speed, sizeof(speed), "%gx speed", opt.speed);
+    std::cout << "capture:     " << opt.capture << " (" << records.size() << " records, "
+              << recordedUs / 1e6 << " s recorded)\n"
+              << "mode:        " << (maxSpeed ? "full speed, pipeline " + std::to_string(opt.pipeline) : speed) << "\n"
+              << "sent:        " << totals.sent << " commands, " << totals.bytes << " bytes"
+              << (totals.skipped > 0 ? " (\"exit\" left out)" : "") << "\n"
+              << "answered:    " << totals.answered << " (busy " << totals.busy << ", unanswered "
+              << totals.unanswered << ")\n"
+              << "elapsed:     " << seconds << " s\n"
+              << "throughput:  " << static_cast<uint64_t>(totals.answered / seconds) << " commands/s\n"
+              << "latency:     " << latency.summary() << "\n";
+
+    if (!opt.save.empty() && !saveHistogram(opt.save, latency, seconds, opt.speed)) {
+        std::cerr << "Cannot write " << opt.save << "\n";
+        failed = true;
+    }
+
+    // 4. Compare with the baseline build
+    bool regressed = false;
+    if (!opt.baseline.empty()) {
+        LatencyHistogram before;
+        double beforeSeconds = 0, beforeSpeed = -1;
+        if (!loadHistogram(opt.baseline, before, beforeSeconds, beforeSpeed) || before.count() == 0) {
+            std::cerr << "Cannot read the baseline " << opt.baseline << "\n";
+            return 1;
+        }
+        std::cout << "baseline:    " << opt.baseline << "\n"
+                  << "                   baseline          current     change\n";
+        const double percentiles[] = { 50, 90, 99, 99.9 };
+        const char* names[] = { "p50", "p90", "p99", "p99.9" };
+        // p99.9 is shown but not judged: a handful of slow samples moves it
+        for (size_t i = 0; i < 4; ++i) {
+            bool worse = compareRow(names[i], before.percentile(percentiles[i]) / 1000.0,
+                                    latency.percentile(percentiles[i]) / 1000.0, "us", opt.tolerance, false);
+            if (percentiles[i] < 99.9) regressed |= worse;
+        }
+        // Throughput only means something when both runs went as fast as they could
+        if (maxSpeed && beforeSpeed == 0 && beforeSeconds > 0) {
+            regressed |= compareRow("throughput", before.count() / beforeSeconds, totals.answered / seconds, "/s",
+                                    opt.tolerance, true);
+        }
+        if (regressed) std::cout << "Slower than the baseline by more than " << opt.tolerance << "%.\n";
+    }
+    if (failed) return 1;
+    return regressed ? 2 : 0;
+}
@@ -0,0 +1,211 @@
+#include "Check.hpp"
+#include "../header/BinaryProtocol.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Helper building a request payload from raw parts
+static std::string payload(uint64_t opcode, uint64_t id, uint64_t argc, const std::string& args) {
+    std::string out;
+    BinaryProtocol::putVarint(out, opcode);
+    BinaryProtocol::putVarint(out, id);
+    BinaryProtocol::putVarint(out, argc);
+    return out + args;
+}
+
+// Helper encoding one ARG_SINT argument
+static std::string sint(int64_t value) {
+    std::string out(1, static_cast<char>(BinaryProtocol::ARG_SINT));
+    BinaryProtocol::putVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    return out;
+}
+
+TEST(BinaryProtocol_varintRoundTrip) {
+    const uint64_t values[] = { 0, 1, 127, 128, 300, 16383, 16384, 0xFFFFFFFFULL, 0x7FFFFFFFFFFFFFFFULL,
+                                0xFFFFFFFFFFFFFFFFULL };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+        std::string encoded;
+        BinaryProtocol::putVarint(encoded, values[i]);
+        CHECK(encoded.size() <= BinaryProtocol::MAX_VARINT);
+        encoded += "rest";
+        std::string_view in(encoded);
+        uint64_t value = 1;
+        CHECK(BinaryProtocol::getVarint(in, value));
+        CHECK(value == values[i]);
+        CHECK(in == "rest");
+    }
+}
+
+TEST(BinaryProtocol_varintMalformed) {
+    uint64_t value = 0;
+
+    // Cut short: continuation bit on the last byte
+    std::string_view truncated("\x80\x80", 2);
+    CHECK(!BinaryProtocol::getVarint(truncated, value));
+    CHECK(truncated.size() == 2);  // nothing consumed
+
+    std::string_view empty;
+    CHECK(!BinaryProtocol::getVarint(empty, value));
+
+    // Eleven bytes: longer than any 64-bit value
+    std::string tooLong(10, '\x80');
+    tooLong += '\x01';
+    std::string_view in(tooLong);
+    CHECK(!BinaryProtocol::getVarint(in, value));
+
+    // Ten bytes whose last one carries more than the 64th bit overflow
+    std::string overflow(9, '\xFF');
+    overflow += '\x02';
+    in = overflow;
+    CHECK(!BinaryProtocol::getVarint(in, value));
+
+    std::string largest(9, '\xFF');
+    largest += '\x01';
+    in = largest;
+    CHECK(BinaryProtocol::getVarint(in, value));
+    CHECK(value == 0xFFFFFFFFFFFFFFFFULL);
+}
+
+TEST(BinaryProtocol_requestRoundTrip) {
+    std::string frame;
+    std::vector<std::string> args = { "50", "007", "hello world", "", "18446744073709551615" };
+    BinaryProtocol::appendRequest(frame, 7, 42, args);
+
+    std::string_view body;
+    size_t used = 0;
+    CHECK(BinaryProtocol::nextFrame(frame, body, used));
+    CHECK(used == frame.size());
+
+    BinaryProtocol::Request request;
+    CHECK(BinaryProtocol::decodeRequest(body, request));
+    CHECK(request.opcode == 7);
+    CHECK(request.id == 42);
+    CHECK(request.args.size() == args.size());
+    for (size_t i = 0; i < args.size() && i < request.args.size(); ++i) CHECK(request.args[i] == args[i]);
+    CHECK(request.argText == "50 007 hello world  18446744073709551615");
+}
+
+TEST(BinaryProtocol_zigzag) {
+    const int64_t values[] = { 0, -1, 1, -2, 2, 1000000, -1000000, INT64_MAX, INT64_MIN };
+    const char* texts[] = { "0", "-1", "1", "-2", "2", "1000000", "-1000000", "9223372036854775807",
+                            "-9223372036854775808" };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+        BinaryProtocol::Request request;
+        CHECK(BinaryProtocol::decodeRequest(payload(1, 2, 1, sint(values[i])), request));
+        CHECK(request.args.size() == 1 && request.args[0] == texts[i]);
+    }
+
+    // Raw encodings: 0, 1, 2, 3 -> 0, -1, 1, -2
+    std::string raw = payload(1, 2, 4, std::string("\x01\x00\x01\x01\x01\x02\x01\x03", 8));
+    BinaryProtocol::Request request;
+    CHECK(BinaryProtocol::decodeRequest(raw, request));
+    CHECK(request.argText == "0 -1 1 -2");
+}
+
+TEST(BinaryProtocol_argumentLimit) {
+    std::string args;
+    for (size_t i = 0; i < BinaryProtocol::MAX_ARGS + 1; ++i) args += std::string("\x00\x05", 2);
+
+    BinaryProtocol::Request request;
+    CHECK(BinaryProtocol::decodeRequest(payload(1, 9, BinaryProtocol::MAX_ARGS, args.substr(2)), request));
+    CHECK(request.args.size() == BinaryProtocol::MAX_ARGS);
+
+    CHECK(!BinaryProtocol::decodeRequest(payload(1, 9, BinaryProtocol::MAX_ARGS + 1, args), request));
+    CHECK(request.id == 9);       // still known, so the error can be answered
+    CHECK(request.args.empty());
+
+    // An argument count the payload cannot possibly hold
+    CHECK(!BinaryProtocol::decodeRequest(payload(1, 9, 1000000, args), request));
+}
+
+TEST(BinaryProtocol_malformedRequests) {
+    BinaryProtocol::Request request;
+
+    CHECK(!BinaryProtocol::decodeRequest(std::string_view(), request));
+    CHECK(request.id == 0);
+
+    // Opcode only, id cut short
+    CHECK(!BinaryProtocol::decodeRequest(std::string_view("\x01\x80", 2), request));
+
+    // Missing argument count
+    CHECK(!BinaryProtocol::decodeRequest(std::string_view("\x01\x02", 2), request));
+    CHECK(request.id == 2);
+
+    // Fewer arguments than announced
+    CHECK(!BinaryProtocol::decodeRequest(payload(1, 2, 2, std::string("\x00\x05", 2)), request));
+
+    // Unknown argument type
+    CHECK(!BinaryProtocol::decodeRequest(payload(1, 2, 1, std::string("\x07\x05", 2)), request));
+
+    // Type byte without a value
+    CHECK(!BinaryProtocol::decodeRequest(payload(1, 2, 1, std::string("\x00", 1)), request));
+
+    // Bytes argument longer than the rest of the payload
+    CHECK(!BinaryProtocol::decodeRequest(payload(1, 2, 1, std::string("\x02\x05" "abc", 5)), request));
+
+    // Bytes argument with a huge length
+    std::string huge("\x02", 1);
+    BinaryProtocol::putVarint(huge, 0xFFFFFFFFFFFFFFFFULL);
+    CHECK(!BinaryProtocol::decodeRequest(payload(1, 2, 1, huge + "abc"), request));
+
+    // Trailing bytes after the last argument
+    CHECK(!BinaryProtocol::decodeRequest(payload(1, 2, 1, std::string("\x00\x05\x00", 3)), request));
+
+    // Overflowing varint as a number argument
+    std::string overflow("\x00", 1);
+    overflow += std::string(9, '\xFF') + '\x7F';
+    CHECK(!BinaryProtocol::decodeRequest(payload(1, 2, 1, overflow), request));
+
+    // A malformed request leaves nothing behind for the next one
+    CHECK(BinaryProtocol::decodeRequest(payload(3, 4, 0, ""), request));
+    CHECK(request.opcode == 3 && request.id == 4 && request.args.empty() && request.argText.empty());
+}
+
+TEST(BinaryProtocol_frames) {
+    std::string frame;
+    BinaryProtocol::putVarint(frame, 300);
+    frame += std::string(300, 'x');
+
+    std::string_view body;
+    size_t used = 0;
+    for (size_t cut = 0; cut < frame.size(); ++cut) {
+        CHECK(!BinaryProtocol::nextFrame(std::string_view(frame.data(), cut), body, used));
+    }
+    frame += "next";
+    CHECK(BinaryProtocol::nextFrame(frame, body, used));
+    CHECK(body.size() == 300 && used == 302);
+
+    // Empty frame
+    CHECK(BinaryProtocol::nextFrame(std::string_view("\x00", 1), body, used));
+    CHECK(body.empty() && used == 1);
+}
+
+TEST(BinaryProtocol_responseRoundTrip) {
+    std::string out;
+    BinaryProtocol::appendResponse(out, 1000, BinaryProtocol::STATUS_MORE, "part one");
+    BinaryProtocol::appendResponse(out, 1000, BinaryProtocol::STATUS_OK, "");
+    BinaryProtocol::appendResponse(out, 5, BinaryProtocol::STATUS_BUSY, "Busy.\n");
+
+    std::string_view in(out);
+    const uint64_t ids[] = { 1000, 1000, 5 };
+    const BinaryProtocol::Status statuses[] = { BinaryProtocol::STATUS_MORE, BinaryProtocol::STATUS_OK,
+                                                BinaryProtocol::STATUS_BUSY };
+    const char* texts[] = { "part one", "", "Busy.\n" };
+    for (int i = 0; i < 3; ++i) {
+        std::string_view body, text;
+        size_t used = 0;
+        uint64_t id = 0;
+        BinaryProtocol::Status status = BinaryProtocol::STATUS_OK;
+        CHECK(BinaryProtocol::nextFrame(in, body, used));
+        CHECK(BinaryProtocol::decodeResponse(body, id, status, text));
+        CHECK(id == ids[i] && status == statuses[i] && text == texts[i]);
+        in.remove_prefix(used);
+    }
+    CHECK(in.empty());
+
+    // Id only, no status byte
+    std::string_view text;
+    uint64_t id = 0;
+    BinaryProtocol::Status status;
+    CHECK(!BinaryProtocol::decodeResponse(std::string_view("\x05", 1), id, status, text));
+}
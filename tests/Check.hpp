@@ -0,0 +1,49 @@
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+#include <iostream>
+#include <vector>
+
+// A minimal unit test harness (no external framework needed to build).
+//
+//   TEST(BinaryProtocol_varintRoundTrip) {
+//       CHECK(value == 300);
+//   }
+//
+// TEST registers the function at static initialisation; tests/main.cpp runs
+// every test whose name starts with the prefix given on its command line, so
+// each group is its own ctest entry. CHECK reports a failure with its line
+// and lets the test go on.
+struct TestCase {
+    const char* name;
+    void (*run)();
+};
+
+inline std::vector<TestCase>& testCases() {
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+inline int& testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+struct TestRegistrar {
+    TestRegistrar(const char* name, void (*run)()) { testCases().push_back(TestCase{name, run}); }
+};
+
+#define TEST(name) \
+    static void name(); \
+    static TestRegistrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+            ++testFailures(); \
+        } \
+    } while (0)
+
+#endif
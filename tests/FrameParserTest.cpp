@@ -0,0 +1,195 @@
+#include "Check.hpp"
+#include "../header/FrameParser.hpp"
+#include "../header/RingBuffer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Helper writing bytes into a ring the way the server's read() does; returns
+// how many fit
+static size_t feed(RingBuffer& ring, std::string_view bytes) {
+    size_t done = 0;
+    while (done < bytes.size()) {
+        char* span = NULL;
+        size_t room = ring.writableSpan(&span);
+        if (room == 0) break;
+        size_t n = std::min(room, bytes.size() - done);
+        memcpy(span, bytes.data() + done, n);
+        ring.commit(n);
+        done += n;
+    }
+    return done;
+}
+
+// Helper returning the next frame as a string ("<need more>" / "<too large>" otherwise)
+static std::string nextFrame(FrameParser& parser, RingBuffer& ring) {
+    std::string_view frame;
+    FrameParser::Result result = parser.next(ring, frame);
+    if (result == FrameParser::NEED_MORE) return "<need more>";
+    if (result == FrameParser::TOO_LARGE) return "<too large>";
+    return std::string(frame);
+}
+
+TEST(RingBuffer_wraparound) {
+    RingBuffer ring(16, 16);
+    CHECK(feed(ring, "0123456789ab") == 12);
+    ring.consume(10);
+    CHECK(feed(ring, "cdefghijkl") == 10);   // wraps past the end of the array
+    CHECK(ring.size() == 12);
+    CHECK(ring.at(0) == 'a' && ring.at(11) == 'l');
+    CHECK(ring.find('k', 0) == 10);
+    CHECK(ring.find('a', 1) == RingBuffer::npos);
+
+    // A range across the end is rotated into one piece
+    CHECK(std::string_view(ring.contiguous(1, 10), 10) == "bcdefghijk");
+    CHECK(ring.size() == 12 && ring.at(0) == 'a');
+
+    // Full at its maximum: nothing more is accepted
+    CHECK(feed(ring, "mnopqrst") == 4);
+    char* span = NULL;
+    CHECK(ring.writableSpan(&span) == 0);
+}
+
+TEST(RingBuffer_growKeepsOrder) {
+    RingBuffer ring(8, 64);
+    CHECK(feed(ring, "abcdef") == 6);
+    ring.consume(4);
+    CHECK(feed(ring, "ghijklmnopqrstuvwxyz") == 20);  // wraps, then grows twice
+    CHECK(ring.size() == 22);
+    CHECK(ring.allocated() == 32);
+    CHECK(std::string_view(ring.contiguous(0, 22), 22) == "efghijklmnopqrstuvwxyz");
+
+    ring.consume(22);
+    CHECK(ring.size() == 0);
+    char* span = NULL;
+    CHECK(ring.writableSpan(&span) == 32);    // empty: the whole array is one span again
+}
+
+TEST(FrameParser_linesSplitAcrossReads) {
+    RingBuffer ring(16, 1024);
+    FrameParser parser;
+    std::string input = "vol+\r\nopen youtube\nvol-\n";
+    std::string frames;
+    for (size_t i = 0; i < input.size(); ++i) {
+        feed(ring, input.substr(i, 1));
+        for (;;) {
+            std::string frame = nextFrame(parser, ring);
+            if (frame == "<need more>") break;
+            frames += frame + "|";
+        }
+    }
+    CHECK(frames == "vol+|open youtube|vol-|");
+    CHECK(ring.size() == 0);
+}
+
+TEST(FrameParser_linesAcrossWrap) {
+    RingBuffer ring(16, 16);
+    FrameParser parser(FrameParser::NEWLINE, 16);
+    feed(ring, "0123456789\ns");
+    CHECK(nextFrame(parser, ring) == "0123456789");
+    CHECK(nextFrame(parser, ring) == "<need more>");
+    feed(ring, "tatus yt\n");      // the line runs from index 11 to index 3
+    CHECK(ring.at(0) == 's');
+    CHECK(nextFrame(parser, ring) == "status yt");
+    CHECK(nextFrame(parser, ring) == "<need more>");
+}
+
+TEST(FrameParser_oversizeFrames) {
+    RingBuffer ring(64, 1024);
+
+    // A line that keeps growing without a newline
+    FrameParser lines(FrameParser::NEWLINE, 8);
+    feed(ring, "12345678");
+    CHECK(nextFrame(lines, ring) == "<need more>");
+    feed(ring, "9");
+    CHECK(nextFrame(lines, ring) == "<too large>");
+
+    // The newline arrives, but too late
+    RingBuffer ring2(64, 1024);
+    FrameParser lines2(FrameParser::NEWLINE, 4);
+    feed(ring2, "abcdefgh\n");
+    CHECK(nextFrame(lines2, ring2) == "<too large>");
+
+    // Length header above the limit, before any payload arrived
+    RingBuffer ring3(64, 1024);
+    FrameParser lengths(FrameParser::LENGTH_PREFIXED, 100);
+    feed(ring3, std::string("\x00\x00\x00\x65", 4));
+    CHECK(nextFrame(lengths, ring3) == "<too large>");
+
+    // Varint length above the limit, and a header too long to be a length at all
+    RingBuffer ring4(64, 1024);
+    FrameParser varints(FrameParser::VARINT_PREFIXED, 100);
+    feed(ring4, "\x65");
+    CHECK(nextFrame(varints, ring4) == "<too large>");
+
+    RingBuffer ring5(64, 1024);
+    FrameParser varints2(FrameParser::VARINT_PREFIXED, 100);
+    feed(ring5, "\x80\x80\x80\x80\x80\x80");
+    CHECK(nextFrame(varints2, ring5) == "<too large>");
+}
+
+TEST(FrameParser_prefixedSplitAcrossReads) {
+    RingBuffer ring(8, 1024);
+    FrameParser lengths(FrameParser::LENGTH_PREFIXED);
+    std::string input = std::string("\x00\x00\x00\x05hello\x00\x00\x00\x00", 13);
+    std::string frames;
+    for (size_t i = 0; i < input.size(); ++i) {
+        feed(ring, input.substr(i, 1));
+        std::string frame = nextFrame(lengths, ring);
+        if (frame != "<need more>") frames += "[" + frame + "]";
+    }
+    CHECK(frames == "[hello][]");
+
+    // 300-byte varint frame: two header bytes, arriving in pieces
+    RingBuffer ring2(8, 1024);
+    FrameParser varints(FrameParser::VARINT_PREFIXED);
+    std::string frame = "\xAC\x02" + std::string(300, 'z');
+    CHECK(feed(ring2, frame.substr(0, 1)) == 1);
+    CHECK(nextFrame(varints, ring2) == "<need more>");
+    feed(ring2, frame.substr(1, 200));
+    CHECK(nextFrame(varints, ring2) == "<need more>");
+    feed(ring2, frame.substr(201));
+    CHECK(nextFrame(varints, ring2) == std::string(300, 'z'));
+}
+
+TEST(FrameParser_switchToBinaryMidBuffer) {
+    // "binary" and the first binary frames arrive in the same read
+    RingBuffer ring(64, 1024);
+    FrameParser parser;
+    feed(ring, std::string("binary\n\x03" "abc\x02x", 13));
+    CHECK(nextFrame(parser, ring) == "binary");
+    parser.setMode(FrameParser::VARINT_PREFIXED);
+    CHECK(nextFrame(parser, ring) == "abc");
+    CHECK(nextFrame(parser, ring) == "<need more>");
+    feed(ring, "y");
+    CHECK(nextFrame(parser, ring) == "xy");
+}
+
+TEST(FrameParser_switchToInputMidBuffer) {
+    // "input\r\n" followed by one and a half input messages
+    RingBuffer ring(16, 1024);
+    FrameParser parser;
+    feed(ring, std::string("input\r\n\x01\x00\x00\x00\x00\x05\x00\x07\x04\x00", 17));
+    CHECK(nextFrame(parser, ring) == "input");
+    parser.setMode(FrameParser::FIXED_SIZE);
+    CHECK(nextFrame(parser, ring) == std::string("\x01\x00\x00\x00\x00\x05\x00\x07", 8));
+    CHECK(nextFrame(parser, ring) == "<need more>");
+    feed(ring, std::string("\x00\x1e\x00\x00\x00\x01", 6));
+    CHECK(nextFrame(parser, ring) == std::string("\x04\x00\x00\x1e\x00\x00\x00\x01", 8));
+    CHECK(nextFrame(parser, ring) == "<need more>");
+}
+
+TEST(FrameParser_switchBackToLines) {
+    // Binary frame, then text again in the same buffer
+    RingBuffer ring(64, 1024);
+    FrameParser parser;
+    feed(ring, "binary\n\x04");
+    CHECK(nextFrame(parser, ring) == "binary");
+    parser.setMode(FrameParser::VARINT_PREFIXED);
+    feed(ring, "vol+");
+    CHECK(nextFrame(parser, ring) == "vol+");
+    parser.setMode(FrameParser::NEWLINE);
+    feed(ring, "mute\n");
+    CHECK(nextFrame(parser, ring) == "mute");
+}
@@ -0,0 +1,165 @@
+#include "Check.hpp"
+#include "../header/InputChannel.hpp"
+#include "../header/InputSink.hpp"
+#include <memory>
+#include <string>
+
+// Helper adding every MESSAGE_SIZE piece of "messages"; false if one is rejected
+static bool addAll(InputChannel& channel, const std::string& messages) {
+    bool ok = true;
+    for (size_t at = 0; at < messages.size(); at += InputChannel::MESSAGE_SIZE) {
+        ok = channel.add(std::string_view(messages).substr(at, InputChannel::MESSAGE_SIZE)) && ok;
+    }
+    return ok;
+}
+
+// Helper packing a move or wheel turn into a message value
+static int32_t pair(int16_t first, int16_t second) {
+    return static_cast<int32_t>((static_cast<uint32_t>(static_cast<uint16_t>(first)) << 16) |
+                                static_cast<uint16_t>(second));
+}
+
+// Helper building the mock sink's status line for the given totals
+static std::string mockStatus(int events, int reports, int writes, int x, int y, int wheel, int presses) {
+    return "Input: mock, " + std::to_string(events) + " events in " + std::to_string(reports) + " reports, " +
+           std::to_string(writes) + " writes, pointer " + std::to_string(x) + "," + std::to_string(y) + ", wheel " +
+           std::to_string(wheel) + ", " + std::to_string(presses) + " presses\n";
+}
+
+TEST(InputChannel_movesMerged) {
+    std::unique_ptr<InputSink> sink = createInputSink("mock");
+    CHECK(sink != NULL);
+    InputChannel channel(*sink);
+
+    std::string messages;
+    for (int i = 0; i < 10; ++i) InputChannel::encode(messages, InputChannel::KIND_MOVE, 0, pair(3, -2));
+    InputChannel::encode(messages, InputChannel::KIND_WHEEL, 0, pair(1, 0));
+    InputChannel::encode(messages, InputChannel::KIND_WHEEL, 0, pair(1, 0));
+    CHECK(addAll(channel, messages));
+    CHECK(sink->status() == mockStatus(0, 0, 0, 0, 0, 0, 0));   // nothing written before flush()
+
+    // One write of one report: REL_X, REL_Y, REL_WHEEL, SYN
+    channel.flush();
+    CHECK(sink->status() == mockStatus(4, 1, 1, 30, -20, 2, 0));
+
+    // Nothing pending: flush() writes nothing
+    channel.flush();
+    CHECK(sink->status() == mockStatus(4, 1, 1, 30, -20, 2, 0));
+
+    // Moves that cancel out produce no report
+    messages.clear();
+    InputChannel::encode(messages, InputChannel::KIND_MOVE, 0, pair(5, 5));
+    InputChannel::encode(messages, InputChannel::KIND_MOVE, 0, pair(-5, -5));
+    CHECK(addAll(channel, messages));
+    channel.flush();
+    CHECK(sink->status() == mockStatus(4, 1, 1, 30, -20, 2, 0));
+}
+
+TEST(InputChannel_buttonEndsMotion) {
+    std::unique_ptr<InputSink> sink = createInputSink("mock");
+    InputChannel channel(*sink);
+
+    // A drag: move, press, move, release; the moves around the press stay apart
+    std::string messages;
+    InputChannel::encode(messages, InputChannel::KIND_MOVE, 0, pair(4, 0));
+    InputChannel::encode(messages, InputChannel::KIND_MOVE, 0, pair(4, 0));
+    InputChannel::encode(messages, InputChannel::KIND_BUTTON, 0, 1);
+    InputChannel::encode(messages, InputChannel::KIND_MOVE, 0, pair(0, 7));
+    InputChannel::encode(messages, InputChannel::KIND_BUTTON, 0, 0);
+    CHECK(addAll(channel, messages));
+    channel.flush();
+    // REL_X+SYN, BTN_LEFT+SYN, REL_Y+SYN, BTN_LEFT+SYN, all in one write
+    CHECK(sink->status() == mockStatus(8, 4, 1, 8, 7, 0, 1));
+
+    // A key ends the motion the same way
+    messages.clear();
+    InputChannel::encode(messages, InputChannel::KIND_MOVE, 0, pair(1, 1));
+    InputChannel::encode(messages, InputChannel::KIND_KEY, KEY_A, 1);
+    InputChannel::encode(messages, InputChannel::KIND_KEY, KEY_A, 0);
+    CHECK(addAll(channel, messages));
+    channel.flush();
+    CHECK(sink->status() == mockStatus(8 + 3 + 4, 4 + 3, 2, 9, 8, 0, 2));
+}
+
+TEST(InputChannel_malformedRejected) {
+    std::unique_ptr<InputSink> sink = createInputSink("mock");
+    InputChannel channel(*sink);
+
+    std::string good;
+    InputChannel::encode(good, InputChannel::KIND_KEY, KEY_A, 1);
+    CHECK(channel.add(good));
+
+    // Wrong size
+    CHECK(!channel.add(std::string_view(good).substr(0, InputChannel::MESSAGE_SIZE - 1)));
+    CHECK(!channel.add(good + good));
+    CHECK(!channel.add(std::string_view()));
+
+    // Second byte not zero
+    std::string reserved = good;
+    reserved[1] = 1;
+    CHECK(!channel.add(reserved));
+
+    // Unknown kinds
+    std::string kind;
+    InputChannel::encode(kind, static_cast<InputChannel::Kind>(0), 0, 0);
+    CHECK(!channel.add(kind));
+    kind.clear();
+    InputChannel::encode(kind, static_cast<InputChannel::Kind>(5), 0, 0);
+    CHECK(!channel.add(kind));
+
+    // Codes and values out of range for their kind
+    const struct { InputChannel::Kind kind; uint16_t code; int32_t value; } bad[] = {
+        { InputChannel::KIND_MOVE, 1, pair(1, 1) },
+        { InputChannel::KIND_WHEEL, 3, pair(1, 0) },
+        { InputChannel::KIND_BUTTON, BTN_EXTRA - BTN_LEFT + 1, 1 },
+        { InputChannel::KIND_BUTTON, 0, 2 },
+        { InputChannel::KIND_BUTTON, 0, -1 },
+        { InputChannel::KIND_KEY, 0, 1 },
+        { InputChannel::KIND_KEY, InputSink::MAX_KEY + 1, 1 },
+        { InputChannel::KIND_KEY, KEY_A, 3 },
+        { InputChannel::KIND_KEY, KEY_A, -1 },
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+        std::string message;
+        InputChannel::encode(message, bad[i].kind, bad[i].code, bad[i].value);
+        CHECK(!channel.add(message));
+    }
+
+    // Only the good message was queued
+    channel.flush();
+    CHECK(sink->status() == mockStatus(2, 1, 1, 0, 0, 0, 1));
+}
+
+TEST(InputChannel_releaseAll) {
+    std::unique_ptr<InputSink> sink = createInputSink("mock");
+    InputChannel channel(*sink);
+
+    // Hold two keys and a button; a third key is pressed and released
+    std::string messages;
+    InputChannel::encode(messages, InputChannel::KIND_KEY, KEY_LEFTSHIFT, 1);
+    InputChannel::encode(messages, InputChannel::KIND_KEY, KEY_A, 1);
+    InputChannel::encode(messages, InputChannel::KIND_KEY, KEY_A, 2);
+    InputChannel::encode(messages, InputChannel::KIND_KEY, KEY_B, 1);
+    InputChannel::encode(messages, InputChannel::KIND_KEY, KEY_B, 0);
+    InputChannel::encode(messages, InputChannel::KIND_BUTTON, 1, 1);
+    InputChannel::encode(messages, InputChannel::KIND_MOVE, 0, pair(2, 2));
+    CHECK(addAll(channel, messages));
+    channel.flush();
+    CHECK(sink->status() == mockStatus(15, 7, 1, 2, 2, 0, 4));
+
+    // Key-ups for KEY_LEFTSHIFT, KEY_A and BTN_RIGHT in one report
+    channel.releaseAll();
+    CHECK(sink->status() == mockStatus(15 + 4, 8, 2, 2, 2, 0, 4));
+
+    // Nothing held any more
+    channel.releaseAll();
+    CHECK(sink->status() == mockStatus(15 + 4, 8, 2, 2, 2, 0, 4));
+
+    // Pending motion is written before the releases
+    messages.clear();
+    InputChannel::encode(messages, InputChannel::KIND_KEY, KEY_C, 1);
+    InputChannel::encode(messages, InputChannel::KIND_MOVE, 0, pair(-2, 0));
+    CHECK(addAll(channel, messages));
+    channel.releaseAll();
+    CHECK(sink->status() == mockStatus(19 + 2 + 2 + 2, 8 + 3, 3, 0, 2, 0, 5));
+}
@@ -0,0 +1,21 @@
+#include "Check.hpp"
+#include <cstring>
+
+// Runs the tests whose name starts with argv[1] (all of them without one)
+int main(int argc, char* argv[]) {
+    const char* prefix = argc > 1 ? argv[1] : "";
+    int ran = 0;
+    for (size_t i = 0; i < testCases().size(); ++i) {
+        const TestCase& test = testCases()[i];
+        if (strncmp(test.name, prefix, strlen(prefix)) != 0) continue;
+        int before = testFailures();
+        test.run();
+        std::cout << (testFailures() == before ? "ok      " : "FAILED  ") << test.name << std::endl;
+        ++ran;
+    }
+    if (ran == 0) {
+        std::cerr << "No tests match \"" << prefix << "\"" << std::endl;
+        return 1;
+    }
+    return testFailures() == 0 ? 0 : 1;
+}